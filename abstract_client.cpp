@@ -2129,10 +2129,20 @@ void AbstractClient::endMoveResize()
     updateCursor();
 }
 
+void AbstractClient::setDecoration(KDecoration2::Decoration *decoration)
+{
+    m_decoration.decoration = decoration;
+    if (decoration) {
+        connect(decoration, &KDecoration2::Decoration::resizeOnlyBordersChanged, this, &Toplevel::inputGeometryChanged);
+    }
+    emit inputGeometryChanged();
+}
+
 void AbstractClient::destroyDecoration()
 {
     delete m_decoration.decoration;
     m_decoration.decoration = nullptr;
+    emit inputGeometryChanged();
 }
 
 bool AbstractClient::decorationHasAlpha() const
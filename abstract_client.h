@@ -1170,9 +1170,7 @@ protected:
         s_haveResizeEffect = false;
     }
 
-    void setDecoration(KDecoration2::Decoration *decoration) {
-        m_decoration.decoration = decoration;
-    }
+    void setDecoration(KDecoration2::Decoration *decoration);
     virtual void destroyDecoration();
     void startDecorationDoubleClickTimer();
     void invalidateDecorationDoubleClickTimer();
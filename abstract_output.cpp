@@ -114,4 +114,14 @@ bool AbstractOutput::setGammaRamp(const GammaRamp &gamma)
     return false;
 }
 
+bool AbstractOutput::isFramePending() const
+{
+    return false;
+}
+
+bool AbstractOutput::isVrrActive() const
+{
+    return false;
+}
+
 } // namespace KWin
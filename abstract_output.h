@@ -175,6 +175,23 @@ public:
      */
     virtual bool setGammaRamp(const GammaRamp &gamma);
 
+    /**
+     * Returns whether a frame has been submitted to this output that has not been
+     * presented yet. While a frame is pending the output cannot accept a new one, the
+     * Compositor defers the damage on this output until the frame has been presented.
+     *
+     * Default implementation returns @c false.
+     */
+    virtual bool isFramePending() const;
+
+    /**
+     * Returns whether the output uses a variable refresh rate, it then refreshes as soon
+     * as a frame is presented instead of at fixed intervals.
+     *
+     * Default implementation returns @c false.
+     */
+    virtual bool isVrrActive() const;
+
 private:
     Q_DISABLE_COPY(AbstractOutput)
 };
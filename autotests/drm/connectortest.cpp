@@ -0,0 +1,98 @@
+/********************************************************************
+ KWin - the KDE window manager
+ This file is part of the KDE project.
+
+Copyright (C) 2020 The KWin developers <kwin@kde.org>
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*********************************************************************/
+#include "mock_drm.h"
+#include "../../plugins/platforms/drm/drm_object_connector.h"
+#include <QtTest>
+
+using KWin::DrmConnector;
+
+static const int s_fd = 31;
+
+class ConnectorTest : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void initTestCase();
+    void testInit();
+    void testVrrCapable_data();
+    void testVrrCapable();
+};
+
+void ConnectorTest::initTestCase()
+{
+    MockDrm::addDrmModeProperties(s_fd, QVector<_drmModeProperty>{
+        _drmModeProperty{
+            1,
+            0,
+            "CRTC_ID\0",
+            0,
+            nullptr,
+            0,
+            nullptr,
+            0,
+            nullptr
+        },
+        _drmModeProperty{
+            2,
+            DRM_MODE_PROP_RANGE | DRM_MODE_PROP_IMMUTABLE,
+            "vrr_capable\0",
+            0,
+            nullptr,
+            0,
+            nullptr,
+            0,
+            nullptr
+        }
+    });
+    MockDrm::addDrmModeObjectProperties(s_fd, 10, {1, 2}, {5, 1});
+    MockDrm::addDrmModeObjectProperties(s_fd, 11, {1, 2}, {5, 0});
+    // a driver without adaptive sync support
+    MockDrm::addDrmModeObjectProperties(s_fd, 12, {1}, {0});
+}
+
+void ConnectorTest::testInit()
+{
+    DrmConnector connector(10, s_fd);
+    QVERIFY(connector.atomicInit());
+    QCOMPARE(connector.id(), 10u);
+    QCOMPARE(connector.value(int(DrmConnector::PropertyIndex::CrtcId)), uint64_t(5));
+    QCOMPARE(connector.value(int(DrmConnector::PropertyIndex::VrrCapable)), uint64_t(1));
+}
+
+void ConnectorTest::testVrrCapable_data()
+{
+    QTest::addColumn<quint32>("connectorId");
+    QTest::addColumn<bool>("expected");
+
+    QTest::newRow("capable") << 10u << true;
+    QTest::newRow("not capable") << 11u << false;
+    QTest::newRow("no property") << 12u << false;
+}
+
+void ConnectorTest::testVrrCapable()
+{
+    QFETCH(quint32, connectorId);
+    DrmConnector connector(connectorId, s_fd);
+    QVERIFY(connector.atomicInit());
+    QTEST(connector.isVrrCapable(), "expected");
+}
+
+QTEST_GUILESS_MAIN(ConnectorTest)
+#include "connectortest.moc"
@@ -19,11 +19,27 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 *********************************************************************/
 #include "mock_drm.h"
 
+#include <xf86drm.h>
+
+#include <cerrno>
+
 #include <QMap>
 #include <QVector>
 
 static QMap<int, QVector<_drmModeProperty>> s_drmProperties{};
 
+struct MockPlane {
+    uint32_t possibleCrtcs;
+    QVector<uint32_t> formats;
+};
+static QMap<int, QMap<uint32_t, MockPlane>> s_drmPlanes{};
+
+struct MockObjectProperties {
+    QVector<uint32_t> propertyIds;
+    QVector<uint64_t> values;
+};
+static QMap<int, QMap<uint32_t, MockObjectProperties>> s_drmObjectProperties{};
+
 namespace MockDrm
 {
 
@@ -32,6 +48,17 @@ void addDrmModeProperties(int fd, const QVector<_drmModeProperty> &properties)
     s_drmProperties.insert(fd, properties);
 }
 
+void addDrmModePlane(int fd, uint32_t planeId, uint32_t possibleCrtcs, const QVector<uint32_t> &formats)
+{
+    s_drmPlanes[fd].insert(planeId, MockPlane{possibleCrtcs, formats});
+}
+
+void addDrmModeObjectProperties(int fd, uint32_t objectId, const QVector<uint32_t> &propertyIds, const QVector<uint64_t> &values)
+{
+    Q_ASSERT(propertyIds.size() == values.size());
+    s_drmObjectProperties[fd].insert(objectId, MockObjectProperties{propertyIds, values});
+}
+
 }
 
 int drmModeAtomicAddProperty(drmModeAtomicReqPtr req, uint32_t object_id, uint32_t property_id, uint64_t value)
@@ -76,3 +103,95 @@ void drmModeFreeProperty(drmModePropertyPtr ptr)
 {
     delete ptr;
 }
+
+drmModePlanePtr drmModeGetPlane(int fd, uint32_t plane_id)
+{
+    auto it = s_drmPlanes.constFind(fd);
+    if (it == s_drmPlanes.constEnd()) {
+        return nullptr;
+    }
+    auto it2 = it->constFind(plane_id);
+    if (it2 == it->constEnd()) {
+        return nullptr;
+    }
+
+    auto *plane = new _drmModePlane{};
+    plane->plane_id = plane_id;
+    plane->possible_crtcs = it2->possibleCrtcs;
+    plane->count_formats = it2->formats.count();
+    plane->formats = const_cast<uint32_t *>(it2->formats.constData());
+
+    return plane;
+}
+
+void drmModeFreePlane(drmModePlanePtr ptr)
+{
+    delete ptr;
+}
+
+drmModeObjectPropertiesPtr drmModeObjectGetProperties(int fd, uint32_t object_id, uint32_t object_type)
+{
+    Q_UNUSED(object_type)
+    auto it = s_drmObjectProperties.constFind(fd);
+    if (it == s_drmObjectProperties.constEnd()) {
+        return nullptr;
+    }
+    auto it2 = it->constFind(object_id);
+    if (it2 == it->constEnd()) {
+        return nullptr;
+    }
+
+    auto *properties = new _drmModeObjectProperties;
+    properties->count_props = it2->propertyIds.count();
+    properties->props = const_cast<uint32_t *>(it2->propertyIds.constData());
+    properties->prop_values = const_cast<uint64_t *>(it2->values.constData());
+
+    return properties;
+}
+
+void drmModeFreeObjectProperties(drmModeObjectPropertiesPtr ptr)
+{
+    delete ptr;
+}
+
+int drmIoctl(int fd, unsigned long request, void *arg)
+{
+    Q_UNUSED(fd)
+    Q_UNUSED(request)
+    Q_UNUSED(arg)
+    errno = EINVAL;
+    return -1;
+}
+
+int drmModeAddFB(int fd, uint32_t width, uint32_t height, uint8_t depth, uint8_t bpp, uint32_t pitch, uint32_t bo_handle, uint32_t *buf_id)
+{
+    Q_UNUSED(fd)
+    Q_UNUSED(width)
+    Q_UNUSED(height)
+    Q_UNUSED(depth)
+    Q_UNUSED(bpp)
+    Q_UNUSED(pitch)
+    Q_UNUSED(bo_handle)
+    Q_UNUSED(buf_id)
+    errno = EINVAL;
+    return -1;
+}
+
+int drmModeRmFB(int fd, uint32_t bufferId)
+{
+    Q_UNUSED(fd)
+    Q_UNUSED(bufferId)
+    return 0;
+}
+
+drmModeConnectorPtr drmModeGetConnector(int fd, uint32_t connectorId)
+{
+    Q_UNUSED(fd)
+    Q_UNUSED(connectorId)
+    return nullptr;
+}
+
+void drmModeFreeConnector(drmModeConnectorPtr ptr)
+{
+    Q_UNUSED(ptr)
+}
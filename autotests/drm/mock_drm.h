@@ -28,5 +28,7 @@ namespace MockDrm
 {
 
 void addDrmModeProperties(int fd, const QVector<_drmModeProperty> &properties);
+void addDrmModePlane(int fd, uint32_t planeId, uint32_t possibleCrtcs, const QVector<uint32_t> &formats);
+void addDrmModeObjectProperties(int fd, uint32_t objectId, const QVector<uint32_t> &propertyIds, const QVector<uint64_t> &values);
 
 }
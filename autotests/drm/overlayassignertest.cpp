@@ -0,0 +1,297 @@
+/********************************************************************
+ KWin - the KDE window manager
+ This file is part of the KDE project.
+
+Copyright (C) 2020 The KWin developers <kwin@kde.org>
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*********************************************************************/
+#include "mock_drm.h"
+#include "../../plugins/platforms/drm/drm_buffer.h"
+#include "../../plugins/platforms/drm/drm_object_plane.h"
+#include "../../plugins/platforms/drm/drm_overlay_assigner.h"
+#include <QtTest>
+
+#include <drm_fourcc.h>
+
+#include <memory>
+#include <vector>
+
+using KWin::DrmOverlayAssigner;
+using KWin::DrmPlane;
+
+using Property = DrmPlane::PropertyIndex;
+
+static const int s_fd = 31;
+static const uint32_t s_crtcId = 7;
+
+class MockBuffer : public KWin::DrmBuffer
+{
+public:
+    MockBuffer(uint32_t id, const QSize &size)
+        : DrmBuffer(s_fd)
+    {
+        m_bufferId = id;
+        m_size = size;
+    }
+};
+
+class OverlayAssignerTest : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void initTestCase();
+    void init();
+    void cleanup();
+    void testNoLayers();
+    void testFormats();
+    void testGeometry();
+    void testFailedTest();
+    void testNotEnoughPlanes();
+    void testInvalidLayers();
+    void testUnassign();
+
+private:
+    DrmPlane *plane(uint32_t id) const;
+
+    drm_mode_property_enum m_typeEnums[3] = {
+        {0, "Overlay"},
+        {1, "Primary"},
+        {2, "Cursor"}
+    };
+    drm_mode_property_enum m_rotationEnums[1] = {
+        {0, "rotate-0"}
+    };
+    std::vector<std::unique_ptr<DrmPlane>> m_planes;
+    std::vector<std::unique_ptr<MockBuffer>> m_buffers;
+};
+
+static _drmModeProperty property(uint32_t id, const char *name, uint32_t flags = 0,
+                                 int enumCount = 0, drm_mode_property_enum *enums = nullptr)
+{
+    _drmModeProperty property{};
+    property.prop_id = id;
+    property.flags = flags;
+    qstrncpy(property.name, name, DRM_PROP_NAME_LEN);
+    property.count_enums = enumCount;
+    property.enums = enums;
+    return property;
+}
+
+void OverlayAssignerTest::initTestCase()
+{
+    MockDrm::addDrmModeProperties(s_fd, QVector<_drmModeProperty>{
+        property(1, "type", DRM_MODE_PROP_ENUM, 3, m_typeEnums),
+        property(2, "SRC_X"),
+        property(3, "SRC_Y"),
+        property(4, "SRC_W"),
+        property(5, "SRC_H"),
+        property(6, "CRTC_X"),
+        property(7, "CRTC_Y"),
+        property(8, "CRTC_W"),
+        property(9, "CRTC_H"),
+        property(10, "FB_ID"),
+        property(11, "CRTC_ID"),
+        property(12, "rotation", DRM_MODE_PROP_BITMASK, 1, m_rotationEnums)
+    });
+    const QVector<uint32_t> propertyIds{1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12};
+    // all overlay planes, not attached to any CRTC
+    const QVector<uint64_t> values{0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1};
+    MockDrm::addDrmModeObjectProperties(s_fd, 50, propertyIds, values);
+    MockDrm::addDrmModeObjectProperties(s_fd, 51, propertyIds, values);
+    MockDrm::addDrmModeObjectProperties(s_fd, 52, propertyIds, values);
+    MockDrm::addDrmModePlane(s_fd, 50, 1, {DRM_FORMAT_XRGB8888, DRM_FORMAT_ARGB8888});
+    MockDrm::addDrmModePlane(s_fd, 51, 1, {DRM_FORMAT_NV12, DRM_FORMAT_XRGB8888});
+    MockDrm::addDrmModePlane(s_fd, 52, 1, {DRM_FORMAT_ARGB8888});
+}
+
+void OverlayAssignerTest::init()
+{
+    for (uint32_t id : {50, 51, 52}) {
+        auto plane = std::make_unique<DrmPlane>(id, s_fd);
+        QVERIFY(plane->atomicInit());
+        QCOMPARE(plane->type(), DrmPlane::TypeIndex::Overlay);
+        m_planes.push_back(std::move(plane));
+    }
+}
+
+void OverlayAssignerTest::cleanup()
+{
+    // the planes don't own their next buffers in this test
+    for (const auto &plane : m_planes) {
+        plane->setNext(nullptr);
+    }
+    m_planes.clear();
+    m_buffers.clear();
+}
+
+DrmPlane *OverlayAssignerTest::plane(uint32_t id) const
+{
+    for (const auto &plane : m_planes) {
+        if (plane->id() == id) {
+            return plane.get();
+        }
+    }
+    return nullptr;
+}
+
+static DrmOverlayAssigner::Layer layer(std::vector<std::unique_ptr<MockBuffer>> &buffers, uint32_t format, const QRect &geometry)
+{
+    buffers.push_back(std::make_unique<MockBuffer>(100 + buffers.size(), geometry.size()));
+    return DrmOverlayAssigner::Layer{buffers.back().get(), format, geometry};
+}
+
+void OverlayAssignerTest::testNoLayers()
+{
+    DrmOverlayAssigner assigner(s_crtcId, {plane(50), plane(51), plane(52)});
+    int testCount = 0;
+    const auto assignment = assigner.assign({}, [&testCount] (const QVector<DrmPlane *> &) {
+        testCount++;
+        return true;
+    });
+    QVERIFY(assignment.isEmpty());
+    QCOMPARE(testCount, 0);
+    for (uint32_t id : {50, 51, 52}) {
+        QVERIFY(!plane(id)->next());
+        QCOMPARE(plane(id)->value(int(Property::FbId)), uint64_t(0));
+        QCOMPARE(plane(id)->value(int(Property::CrtcId)), uint64_t(0));
+    }
+}
+
+void OverlayAssignerTest::testFormats()
+{
+    DrmOverlayAssigner assigner(s_crtcId, {plane(50), plane(51), plane(52)});
+    const QVector<DrmOverlayAssigner::Layer> layers{
+        layer(m_buffers, DRM_FORMAT_NV12, QRect(0, 0, 640, 480)),
+        layer(m_buffers, DRM_FORMAT_ARGB8888, QRect(640, 0, 320, 240)),
+        layer(m_buffers, DRM_FORMAT_ARGB8888, QRect(640, 240, 320, 240)),
+        layer(m_buffers, DRM_FORMAT_YUYV, QRect(0, 480, 320, 240))
+    };
+    QVector<QVector<DrmPlane *>> testedPlanes;
+    const auto assignment = assigner.assign(layers, [&testedPlanes] (const QVector<DrmPlane *> &planes) {
+        testedPlanes << planes;
+        return true;
+    });
+    QCOMPARE(assignment, QVector<DrmPlane *>({plane(51), plane(50), plane(52), nullptr}));
+    QCOMPARE(plane(51)->next(), layers[0].buffer);
+    QCOMPARE(plane(50)->next(), layers[1].buffer);
+    QCOMPARE(plane(52)->next(), layers[2].buffer);
+    QCOMPARE(plane(51)->value(int(Property::FbId)), uint64_t(layers[0].buffer->bufferId()));
+
+    // every test covers all planes, the unused ones disabled
+    QCOMPARE(testedPlanes.count(), 3);
+    for (const auto &planes : testedPlanes) {
+        QCOMPARE(planes, QVector<DrmPlane *>({plane(50), plane(51), plane(52)}));
+    }
+}
+
+void OverlayAssignerTest::testGeometry()
+{
+    DrmOverlayAssigner assigner(s_crtcId, {plane(50)});
+    const QVector<DrmOverlayAssigner::Layer> layers{
+        layer(m_buffers, DRM_FORMAT_XRGB8888, QRect(100, 200, 640, 480))
+    };
+    const auto assignment = assigner.assign(layers, [] (const QVector<DrmPlane *> &) {
+        return true;
+    });
+    QCOMPARE(assignment, QVector<DrmPlane *>({plane(50)}));
+
+    DrmPlane *p = plane(50);
+    QCOMPARE(p->value(int(Property::SrcX)), uint64_t(0));
+    QCOMPARE(p->value(int(Property::SrcY)), uint64_t(0));
+    QCOMPARE(p->value(int(Property::SrcW)), uint64_t(640) << 16);
+    QCOMPARE(p->value(int(Property::SrcH)), uint64_t(480) << 16);
+    QCOMPARE(p->value(int(Property::CrtcX)), uint64_t(100));
+    QCOMPARE(p->value(int(Property::CrtcY)), uint64_t(200));
+    QCOMPARE(p->value(int(Property::CrtcW)), uint64_t(640));
+    QCOMPARE(p->value(int(Property::CrtcH)), uint64_t(480));
+    QCOMPARE(p->value(int(Property::CrtcId)), uint64_t(s_crtcId));
+}
+
+void OverlayAssignerTest::testFailedTest()
+{
+    // the hardware can't show anything on plane 50, the layer moves on to the next plane
+    DrmOverlayAssigner assigner(s_crtcId, {plane(50), plane(51), plane(52)});
+    const QVector<DrmOverlayAssigner::Layer> layers{
+        layer(m_buffers, DRM_FORMAT_XRGB8888, QRect(0, 0, 640, 480)),
+        layer(m_buffers, DRM_FORMAT_XRGB8888, QRect(640, 0, 640, 480))
+    };
+    DrmPlane *broken = plane(50);
+    const auto assignment = assigner.assign(layers, [broken] (const QVector<DrmPlane *> &) {
+        return broken->value(int(Property::CrtcId)) == 0;
+    });
+    QCOMPARE(assignment, QVector<DrmPlane *>({plane(51), nullptr}));
+    QVERIFY(!plane(50)->next());
+    QCOMPARE(plane(50)->value(int(Property::CrtcId)), uint64_t(0));
+    QCOMPARE(plane(51)->next(), layers[0].buffer);
+}
+
+void OverlayAssignerTest::testNotEnoughPlanes()
+{
+    DrmOverlayAssigner assigner(s_crtcId, {plane(50), plane(51)});
+    QVector<DrmOverlayAssigner::Layer> layers;
+    for (int i = 0; i < 4; ++i) {
+        layers << layer(m_buffers, DRM_FORMAT_XRGB8888, QRect(i * 100, 0, 100, 100));
+    }
+    int testCount = 0;
+    const auto assignment = assigner.assign(layers, [&testCount] (const QVector<DrmPlane *> &) {
+        testCount++;
+        return true;
+    });
+    QCOMPARE(assignment, QVector<DrmPlane *>({plane(50), plane(51), nullptr, nullptr}));
+    QCOMPARE(testCount, 2);
+}
+
+void OverlayAssignerTest::testInvalidLayers()
+{
+    DrmOverlayAssigner assigner(s_crtcId, {plane(50)});
+    m_buffers.push_back(std::make_unique<MockBuffer>(0, QSize(100, 100)));
+    const QVector<DrmOverlayAssigner::Layer> layers{
+        // importing the client buffer failed
+        DrmOverlayAssigner::Layer{m_buffers.back().get(), DRM_FORMAT_XRGB8888, QRect(0, 0, 100, 100)},
+        DrmOverlayAssigner::Layer{nullptr, DRM_FORMAT_XRGB8888, QRect(0, 0, 100, 100)},
+        layer(m_buffers, DRM_FORMAT_XRGB8888, QRect())
+    };
+    int testCount = 0;
+    const auto assignment = assigner.assign(layers, [&testCount] (const QVector<DrmPlane *> &) {
+        testCount++;
+        return true;
+    });
+    QCOMPARE(assignment, QVector<DrmPlane *>({nullptr, nullptr, nullptr}));
+    QCOMPARE(testCount, 0);
+}
+
+void OverlayAssignerTest::testUnassign()
+{
+    DrmOverlayAssigner assigner(s_crtcId, {plane(50), plane(51)});
+    auto alwaysWorks = [] (const QVector<DrmPlane *> &) {
+        return true;
+    };
+    const QVector<DrmOverlayAssigner::Layer> layers{
+        layer(m_buffers, DRM_FORMAT_XRGB8888, QRect(0, 0, 100, 100)),
+        layer(m_buffers, DRM_FORMAT_XRGB8888, QRect(100, 0, 100, 100))
+    };
+    QCOMPARE(assigner.assign(layers, alwaysWorks), QVector<DrmPlane *>({plane(50), plane(51)}));
+
+    // the first layer went away, the second one takes the first plane and the other one is disabled
+    QCOMPARE(assigner.assign({layers[1]}, alwaysWorks), QVector<DrmPlane *>({plane(50)}));
+    QCOMPARE(plane(50)->next(), layers[1].buffer);
+    QCOMPARE(plane(50)->value(int(Property::CrtcX)), uint64_t(100));
+    QVERIFY(!plane(51)->next());
+    QCOMPARE(plane(51)->value(int(Property::FbId)), uint64_t(0));
+    QCOMPARE(plane(51)->value(int(Property::CrtcId)), uint64_t(0));
+}
+
+QTEST_GUILESS_MAIN(OverlayAssignerTest)
+#include "overlayassignertest.moc"
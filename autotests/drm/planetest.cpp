@@ -0,0 +1,144 @@
+/********************************************************************
+ KWin - the KDE window manager
+ This file is part of the KDE project.
+
+Copyright (C) 2020 The KWin developers <kwin@kde.org>
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*********************************************************************/
+#include "mock_drm.h"
+#include "../../plugins/platforms/drm/drm_object_plane.h"
+#include <QtTest>
+
+#include <drm_fourcc.h>
+
+using KWin::DrmPlane;
+
+Q_DECLARE_METATYPE(DrmPlane::Transformations)
+
+static const int s_fd = 30;
+static const uint32_t s_planeId = 40;
+
+class PlaneTest : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void initTestCase();
+    void testInit();
+    void testCanScanout_data();
+    void testCanScanout();
+
+private:
+    drm_mode_property_enum m_typeEnums[3] = {
+        {0, "Overlay"},
+        {1, "Primary"},
+        {2, "Cursor"}
+    };
+    drm_mode_property_enum m_rotationEnums[4] = {
+        {0, "rotate-0"},
+        {1, "rotate-90"},
+        {2, "rotate-180"},
+        {3, "rotate-270"}
+    };
+};
+
+void PlaneTest::initTestCase()
+{
+    MockDrm::addDrmModeProperties(s_fd, QVector<_drmModeProperty>{
+        _drmModeProperty{
+            1,
+            DRM_MODE_PROP_ENUM,
+            "type\0",
+            0,
+            nullptr,
+            3,
+            m_typeEnums,
+            0,
+            nullptr
+        },
+        _drmModeProperty{
+            2,
+            0,
+            "FB_ID\0",
+            0,
+            nullptr,
+            0,
+            nullptr,
+            0,
+            nullptr
+        },
+        _drmModeProperty{
+            3,
+            DRM_MODE_PROP_BITMASK,
+            "rotation\0",
+            0,
+            nullptr,
+            4,
+            m_rotationEnums,
+            0,
+            nullptr
+        }
+    });
+    // a primary plane, not rotated
+    MockDrm::addDrmModeObjectProperties(s_fd, s_planeId, {1, 2, 3}, {1, 0, 1 << 0});
+    MockDrm::addDrmModePlane(s_fd, s_planeId, 0b11, {DRM_FORMAT_XRGB8888, DRM_FORMAT_ARGB8888});
+}
+
+void PlaneTest::testInit()
+{
+    DrmPlane plane(s_planeId, s_fd);
+    QVERIFY(plane.atomicInit());
+    QCOMPARE(plane.id(), s_planeId);
+    QCOMPARE(plane.type(), DrmPlane::TypeIndex::Primary);
+    QVERIFY(plane.isCrtcSupported(0));
+    QVERIFY(plane.isCrtcSupported(1));
+    QVERIFY(!plane.isCrtcSupported(2));
+    QCOMPARE(plane.formats(), QVector<uint32_t>({DRM_FORMAT_XRGB8888, DRM_FORMAT_ARGB8888}));
+    QCOMPARE(plane.transformation(), DrmPlane::Transformations(DrmPlane::Transformation::Rotate0));
+    QVERIFY(plane.supportedTransformations().testFlag(DrmPlane::Transformation::Rotate90));
+}
+
+void PlaneTest::testCanScanout_data()
+{
+    QTest::addColumn<quint32>("format");
+    QTest::addColumn<QSize>("size");
+    QTest::addColumn<DrmPlane::Transformations>("transformation");
+    QTest::addColumn<bool>("expected");
+
+    const DrmPlane::Transformations normal(DrmPlane::Transformation::Rotate0);
+
+    QTest::newRow("xrgb") << quint32(DRM_FORMAT_XRGB8888) << QSize(1920, 1080) << normal << true;
+    QTest::newRow("argb") << quint32(DRM_FORMAT_ARGB8888) << QSize(1920, 1080) << normal << true;
+    QTest::newRow("unsupported format") << quint32(DRM_FORMAT_NV12) << QSize(1920, 1080) << normal << false;
+    QTest::newRow("smaller") << quint32(DRM_FORMAT_XRGB8888) << QSize(1280, 720) << normal << false;
+    QTest::newRow("larger") << quint32(DRM_FORMAT_XRGB8888) << QSize(3840, 2160) << normal << false;
+    QTest::newRow("rotated") << quint32(DRM_FORMAT_XRGB8888) << QSize(1920, 1080)
+                             << DrmPlane::Transformations(DrmPlane::Transformation::Rotate90) << false;
+}
+
+void PlaneTest::testCanScanout()
+{
+    DrmPlane plane(s_planeId, s_fd);
+    QVERIFY(plane.atomicInit());
+
+    QFETCH(DrmPlane::Transformations, transformation);
+    plane.setTransformation(transformation);
+
+    QFETCH(quint32, format);
+    QFETCH(QSize, size);
+    QTEST(plane.canScanout(format, size, QSize(1920, 1080)), "expected");
+}
+
+QTEST_GUILESS_MAIN(PlaneTest)
+#include "planetest.moc"
@@ -0,0 +1,235 @@
+/********************************************************************
+KWin - the KDE window manager
+This file is part of the KDE project.
+
+Copyright (C) 2020 The KWin developers <kwin@kde.org>
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*********************************************************************/
+#include "generic_scene_opengl_test.h"
+
+#include "composite.h"
+#include "scene.h"
+#include "xdgshellclient.h"
+#include "wayland_server.h"
+
+#include <KWayland/Client/shm_pool.h>
+#include <KWayland/Client/subsurface.h>
+#include <KWayland/Client/surface.h>
+#include <KWayland/Client/xdgshell.h>
+
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+#include <memory>
+#include <vector>
+
+namespace KWin
+{
+
+/**
+ * Paints a fixed number of frames with a set of synthetic clients on the virtual
+ * platform and records how long the Scene spent in each stage of every frame.
+ *
+ * The timings are written as JSON to the file named by KWIN_BENCHMARK_OUTPUT, or to
+ * the log if it is not set. KWIN_BENCHMARK_FRAMES overrides the number of frames.
+ *
+ * The benchmark is not part of the test run, start benchmarkCompositing manually.
+ */
+class CompositingBenchmark : public GenericSceneOpenGLTest
+{
+    Q_OBJECT
+public:
+    CompositingBenchmark() : GenericSceneOpenGLTest(QByteArrayLiteral("O2")) {
+        // read by the Scene once the compositor starts
+        qputenv("KWIN_FRAME_TIMINGS", QByteArrayLiteral("1"));
+    }
+private Q_SLOTS:
+    void init();
+    void cleanupTestCase();
+    void benchmarkPaint_data();
+    void benchmarkPaint();
+
+private:
+    QJsonArray m_results;
+};
+
+struct BenchmarkClient {
+    QScopedPointer<KWayland::Client::Surface> surface;
+    QScopedPointer<KWayland::Client::XdgShellSurface> shellSurface;
+    QVector<KWayland::Client::Surface *> subSurfaceSurfaces;
+    QVector<KWayland::Client::SubSurface *> subSurfaces;
+    XdgShellClient *client = nullptr;
+
+    ~BenchmarkClient() {
+        qDeleteAll(subSurfaces);
+        qDeleteAll(subSurfaceSurfaces);
+    }
+};
+
+static void commitFrame(KWayland::Client::Surface *surface, const QSize &size, const QString &damage, int frame)
+{
+    using namespace KWayland::Client;
+    QImage image(size, QImage::Format_ARGB32_Premultiplied);
+    image.fill(QColor::fromHsv((frame * 7) % 360, 255, 255, 200));
+    surface->attachBuffer(Test::waylandShmPool()->createBuffer(image));
+    if (damage == QLatin1String("full")) {
+        surface->damage(QRect(QPoint(0, 0), size));
+    } else {
+        // a small area moving over the surface, like a blinking cursor or a progress bar
+        const QSize damageSize = size.boundedTo(QSize(64, 64));
+        const int columns = qMax(1, size.width() / damageSize.width());
+        const int rows = qMax(1, size.height() / damageSize.height());
+        const int cell = frame % (columns * rows);
+        surface->damage(QRect(QPoint((cell % columns) * damageSize.width(), (cell / columns) * damageSize.height()), damageSize));
+    }
+    surface->commit(Surface::CommitFlag::None);
+}
+
+void CompositingBenchmark::init()
+{
+    QVERIFY(Test::setupWaylandConnection());
+}
+
+void CompositingBenchmark::cleanupTestCase()
+{
+    const QByteArray json = QJsonDocument(m_results).toJson();
+    const QString outputPath = qEnvironmentVariable("KWIN_BENCHMARK_OUTPUT");
+    if (outputPath.isEmpty()) {
+        qInfo().noquote() << json;
+        return;
+    }
+    QFile output(outputPath);
+    QVERIFY(output.open(QIODevice::WriteOnly | QIODevice::Truncate));
+    output.write(json);
+}
+
+void CompositingBenchmark::benchmarkPaint_data()
+{
+    QTest::addColumn<int>("clientCount");
+    QTest::addColumn<QSize>("bufferSize");
+    QTest::addColumn<QString>("damage");
+    QTest::addColumn<qreal>("opacity");
+    QTest::addColumn<int>("subSurfaceCount");
+
+    QTest::newRow("idle") << 4 << QSize(640, 480) << QStringLiteral("none") << 1.0 << 0;
+    QTest::newRow("single fullscreen") << 1 << QSize(1280, 1024) << QStringLiteral("full") << 1.0 << 0;
+    QTest::newRow("partial damage") << 8 << QSize(640, 480) << QStringLiteral("partial") << 1.0 << 0;
+    QTest::newRow("full damage") << 8 << QSize(640, 480) << QStringLiteral("full") << 1.0 << 0;
+    QTest::newRow("translucent") << 8 << QSize(640, 480) << QStringLiteral("full") << 0.8 << 0;
+    QTest::newRow("subsurfaces") << 4 << QSize(640, 480) << QStringLiteral("partial") << 1.0 << 8;
+    QTest::newRow("many small") << 32 << QSize(200, 150) << QStringLiteral("partial") << 1.0 << 0;
+}
+
+void CompositingBenchmark::benchmarkPaint()
+{
+    using namespace KWayland::Client;
+
+    QFETCH(int, clientCount);
+    QFETCH(QSize, bufferSize);
+    QFETCH(QString, damage);
+    QFETCH(qreal, opacity);
+    QFETCH(int, subSurfaceCount);
+
+    bool ok = false;
+    int frameCount = qEnvironmentVariableIntValue("KWIN_BENCHMARK_FRAMES", &ok);
+    if (!ok || frameCount <= 0) {
+        frameCount = 60;
+    }
+
+    const QSize subSurfaceSize = bufferSize / 4;
+    std::vector<std::unique_ptr<BenchmarkClient>> clients;
+    for (int i = 0; i < clientCount; ++i) {
+        auto client = std::make_unique<BenchmarkClient>();
+        client->surface.reset(Test::createSurface());
+        QVERIFY(!client->surface.isNull());
+        client->shellSurface.reset(Test::createXdgShellStableSurface(client->surface.data()));
+        QVERIFY(!client->shellSurface.isNull());
+        for (int j = 0; j < subSurfaceCount; ++j) {
+            Surface *surface = Test::createSurface();
+            QVERIFY(surface);
+            client->subSurfaceSurfaces << surface;
+            SubSurface *subSurface = Test::createSubSurface(surface, client->surface.data());
+            QVERIFY(subSurface);
+            subSurface->setPosition(QPoint((j * 16) % bufferSize.width(), (j * 16) % bufferSize.height()));
+            client->subSurfaces << subSurface;
+            Test::render(surface, subSurfaceSize, Qt::green);
+        }
+        client->client = Test::renderAndWaitForShown(client->surface.data(), bufferSize, Qt::blue);
+        QVERIFY(client->client);
+        client->client->setOpacity(opacity);
+        clients.push_back(std::move(client));
+    }
+
+    QSignalSpy swapSpy(Compositor::self(), &Compositor::bufferSwapCompleted);
+    QVERIFY(swapSpy.isValid());
+    // get rid of the damage caused by mapping the windows
+    Compositor::self()->addRepaintFull();
+    QVERIFY(swapSpy.wait());
+
+    QJsonArray frames;
+    QBENCHMARK_ONCE {
+        for (int frame = 0; frame < frameCount; ++frame) {
+            if (damage != QLatin1String("none")) {
+                for (const auto &client : clients) {
+                    for (Surface *surface : client->subSurfaceSurfaces) {
+                        commitFrame(surface, subSurfaceSize, damage, frame);
+                    }
+                    commitFrame(client->surface.data(), bufferSize, damage, frame);
+                }
+                // the server handles the requests in order, once the last client is damaged all are
+                QSignalSpy damagedSpy(clients.back()->client, &XdgShellClient::damaged);
+                QVERIFY(damagedSpy.isValid());
+                QVERIFY(damagedSpy.wait());
+            }
+            Compositor::self()->addRepaintFull();
+            QVERIFY(swapSpy.wait());
+
+            // the previous frame is presented when the next one starts
+            const Scene::FrameTimings &timings = Compositor::self()->scene()->lastFrameTimings();
+            frames.append(QJsonObject{
+                {QStringLiteral("paint"), timings.paint},
+                {QStringLiteral("effectsPrePaint"), timings.effectsPrePaint},
+                {QStringLiteral("effectsPaint"), timings.effectsPaint},
+                {QStringLiteral("textureUpload"), timings.textureUpload},
+                {QStringLiteral("swap"), timings.swap}
+            });
+        }
+    }
+
+    m_results.append(QJsonObject{
+        {QStringLiteral("name"), QString::fromUtf8(QTest::currentDataTag())},
+        {QStringLiteral("clients"), clientCount},
+        {QStringLiteral("bufferWidth"), bufferSize.width()},
+        {QStringLiteral("bufferHeight"), bufferSize.height()},
+        {QStringLiteral("damage"), damage},
+        {QStringLiteral("opacity"), opacity},
+        {QStringLiteral("subSurfaces"), subSurfaceCount},
+        {QStringLiteral("unit"), QStringLiteral("ns")},
+        {QStringLiteral("frames"), frames}
+    });
+
+    for (auto &client : clients) {
+        XdgShellClient *window = client->client;
+        client.reset();
+        QVERIFY(Test::waitForWindowDestroyed(window));
+    }
+}
+
+}
+
+WAYLANDTEST_MAIN(KWin::CompositingBenchmark)
+#include "compositing_benchmark.moc"
@@ -17,6 +17,8 @@ GNU General Public License for more details.
 You should have received a copy of the GNU General Public License
 along with this program.  If not, see <http://www.gnu.org/licenses/>.
 *********************************************************************/
+#include "payload.h"
+
 #include <QClipboard>
 #include <QGuiApplication>
 #include <QPainter>
@@ -27,16 +29,20 @@ class Window : public QRasterWindow
 {
     Q_OBJECT
 public:
-    explicit Window();
+    explicit Window(const QString &text);
     ~Window() override;
 
 protected:
     void paintEvent(QPaintEvent *event) override;
     void focusInEvent(QFocusEvent *event) override;
+
+private:
+    QString m_text;
 };
 
-Window::Window()
+Window::Window(const QString &text)
     : QRasterWindow()
+    , m_text(text)
 {
 }
 
@@ -53,15 +59,17 @@ void Window::focusInEvent(QFocusEvent *event)
 {
     QRasterWindow::focusInEvent(event);
     // TODO: make it work without singleshot
-    QTimer::singleShot(100,[] {
-        qApp->clipboard()->setText(QStringLiteral("test"));
+    QTimer::singleShot(100, this, [this] {
+        qApp->clipboard()->setText(m_text);
     });
 }
 
 int main(int argc, char *argv[])
 {
     QGuiApplication app(argc, argv);
-    QScopedPointer<Window> w(new Window);
+    // optionally the size of the copied text in bytes
+    const QString text = argc > 1 ? payload(QByteArray(argv[1]).toInt()) : QStringLiteral("test");
+    QScopedPointer<Window> w(new Window(text));
     w->setGeometry(QRect(0, 0, 100, 200));
     w->show();
 
@@ -17,6 +17,8 @@ GNU General Public License for more details.
 You should have received a copy of the GNU General Public License
 along with this program.  If not, see <http://www.gnu.org/licenses/>.
 *********************************************************************/
+#include "payload.h"
+
 #include <QClipboard>
 #include <QGuiApplication>
 #include <QPainter>
@@ -51,9 +53,11 @@ void Window::paintEvent(QPaintEvent *event)
 int main(int argc, char *argv[])
 {
     QGuiApplication app(argc, argv);
+    // optionally the size of the expected text in bytes
+    const QString text = argc > 1 ? payload(QByteArray(argv[1]).toInt()) : QStringLiteral("test");
     QObject::connect(app.clipboard(), &QClipboard::changed, &app,
-        [] {
-            if (qApp->clipboard()->text() == QLatin1String("test")) {
+        [text] {
+            if (qApp->clipboard()->text() == text) {
                 QTimer::singleShot(100, qApp, &QCoreApplication::quit);
             }
         }
@@ -0,0 +1,41 @@
+/********************************************************************
+KWin - the KDE window manager
+This file is part of the KDE project.
+
+Copyright (C) 2020 The KWin developers <kwin@kde.org>
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*********************************************************************/
+#ifndef KWIN_TEST_HELPER_PAYLOAD_H
+#define KWIN_TEST_HELPER_PAYLOAD_H
+
+#include <QString>
+
+/**
+ * Clipboard text of @p size characters shared by the copy and paste helpers,
+ * so the transfer test can compare what was offered with what was received.
+ */
+inline QString payload(int size)
+{
+    // a pattern which doesn't repeat with any chunk size, so lost or reordered chunks are noticed
+    QString text;
+    text.reserve(size + 16);
+    for (int i = 0; text.size() < size; ++i) {
+        text += QString::number(i) + QLatin1Char(' ');
+    }
+    text.truncate(size);
+    return text;
+}
+
+#endif
@@ -0,0 +1,283 @@
+/********************************************************************
+ KWin - the KDE window manager
+ This file is part of the KDE project.
+
+Copyright (C) 2020 The KWin developers <kwin@kde.org>
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*********************************************************************/
+
+#include "kwin_wayland_test.h"
+
+#include "cursor.h"
+#include "hit_test_index.h"
+#include "platform.h"
+#include "screens.h"
+#include "wayland_server.h"
+#include "workspace.h"
+#include "xdgshellclient.h"
+
+#include <KWayland/Client/surface.h>
+#include <KWayland/Client/xdgshell.h>
+
+namespace KWin
+{
+
+static const QString s_socketName = QStringLiteral("wayland_test_kwin_hit_test_index-0");
+
+static bool acceptAll(Toplevel *)
+{
+    return true;
+}
+
+class HitTestIndexTest : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void initTestCase();
+    void init();
+    void cleanup();
+
+    void testInsertMoveRemove();
+    void testSpanningCells();
+    void testLargeWindow();
+    void testNegativeCoordinates();
+    void testMultipleScreens();
+    void testStackingOrder();
+
+private:
+    XdgShellClient *createWindow(const QSize &size);
+
+    QVector<KWayland::Client::Surface *> m_surfaces;
+    QVector<KWayland::Client::XdgShellSurface *> m_shellSurfaces;
+};
+
+void HitTestIndexTest::initTestCase()
+{
+    qRegisterMetaType<KWin::AbstractClient *>();
+    qRegisterMetaType<KWin::XdgShellClient *>();
+    QSignalSpy workspaceCreatedSpy(kwinApp(), &Application::workspaceCreated);
+    QVERIFY(workspaceCreatedSpy.isValid());
+    kwinApp()->platform()->setInitialWindowSize(QSize(1280, 1024));
+    QVERIFY(waylandServer()->init(s_socketName.toLocal8Bit()));
+    QMetaObject::invokeMethod(kwinApp()->platform(), "setVirtualOutputs", Qt::DirectConnection, Q_ARG(int, 2));
+
+    kwinApp()->start();
+    QVERIFY(workspaceCreatedSpy.wait());
+    QCOMPARE(screens()->count(), 2);
+    QCOMPARE(screens()->geometry(0), QRect(0, 0, 1280, 1024));
+    QCOMPARE(screens()->geometry(1), QRect(1280, 0, 1280, 1024));
+    waylandServer()->initWorkspace();
+}
+
+void HitTestIndexTest::init()
+{
+    QVERIFY(Test::setupWaylandConnection());
+
+    screens()->setCurrent(0);
+    Cursor::setPos(QPoint(640, 512));
+}
+
+void HitTestIndexTest::cleanup()
+{
+    qDeleteAll(m_shellSurfaces);
+    m_shellSurfaces.clear();
+    qDeleteAll(m_surfaces);
+    m_surfaces.clear();
+    Test::destroyWaylandConnection();
+}
+
+XdgShellClient *HitTestIndexTest::createWindow(const QSize &size)
+{
+    using namespace KWayland::Client;
+    Surface *surface = Test::createSurface();
+    m_surfaces << surface;
+    m_shellSurfaces << Test::createXdgShellStableSurface(surface);
+    return Test::renderAndWaitForShown(surface, size, Qt::blue);
+}
+
+void HitTestIndexTest::testInsertMoveRemove()
+{
+    // this test verifies that moving a window updates the cells it is found in
+    // and that a removed window isn't found any more
+    XdgShellClient *client = createWindow(QSize(100, 50));
+    QVERIFY(client);
+    client->move(QPoint(10, 10));
+    QCOMPARE(client->inputGeometry(), QRect(10, 10, 100, 50));
+
+    HitTestIndex index;
+    index.rebuild(workspace()->stackingOrder());
+    QVERIFY(index.isValid());
+    QCOMPARE(index.findTopmost(QPoint(10, 10), acceptAll), client);
+    QCOMPARE(index.findTopmost(QPoint(109, 59), acceptAll), client);
+    QVERIFY(!index.findTopmost(QPoint(110, 60), acceptAll));
+
+    // moving into another cell is applied without a rebuild
+    client->move(QPoint(600, 600));
+    QVERIFY(index.isValid());
+    QVERIFY(!index.findTopmost(QPoint(20, 20), acceptAll));
+    QCOMPARE(index.findTopmost(QPoint(620, 620), acceptAll), client);
+
+    // a window which isn't in the list any more is not found
+    QList<Toplevel *> windows = workspace()->stackingOrder();
+    windows.removeOne(client);
+    index.update(windows);
+    QVERIFY(!index.findTopmost(QPoint(620, 620), acceptAll));
+
+    // a destroyed window invalidates the index
+    index.update(workspace()->stackingOrder());
+    QCOMPARE(index.findTopmost(QPoint(620, 620), acceptAll), client);
+    delete m_shellSurfaces.takeLast();
+    delete m_surfaces.takeLast();
+    QVERIFY(Test::waitForWindowDestroyed(client));
+    QVERIFY(!index.isValid());
+    index.update(workspace()->stackingOrder());
+    QVERIFY(index.isValid());
+    QVERIFY(!index.findTopmost(QPoint(620, 620), acceptAll));
+}
+
+void HitTestIndexTest::testSpanningCells()
+{
+    // this test verifies that a window is found in all cells it intersects, but only
+    // at the positions it covers
+    XdgShellClient *client = createWindow(QSize(600, 400));
+    QVERIFY(client);
+    client->move(QPoint(200, 200));
+
+    HitTestIndex index;
+    index.rebuild(workspace()->stackingOrder());
+    QCOMPARE(index.findTopmost(QPoint(200, 200), acceptAll), client);
+    QCOMPARE(index.findTopmost(QPoint(500, 300), acceptAll), client);
+    QCOMPARE(index.findTopmost(QPoint(799, 599), acceptAll), client);
+    // same cells, but outside of the window
+    QVERIFY(!index.findTopmost(QPoint(199, 300), acceptAll));
+    QVERIFY(!index.findTopmost(QPoint(800, 300), acceptAll));
+    QVERIFY(!index.findTopmost(QPoint(500, 600), acceptAll));
+
+    // moving the window removes it from the cells it doesn't intersect any more
+    client->move(QPoint(0, 0));
+    QCOMPARE(index.findTopmost(QPoint(10, 10), acceptAll), client);
+    QVERIFY(!index.findTopmost(QPoint(700, 500), acceptAll));
+}
+
+void HitTestIndexTest::testLargeWindow()
+{
+    // this test verifies that a window covering too many cells for the grid is found,
+    // also together with a window in the grid
+    XdgShellClient *large = createWindow(QSize(70000, 16));
+    QVERIFY(large);
+    large->move(QPoint(-1000, 10));
+    XdgShellClient *small = createWindow(QSize(100, 50));
+    QVERIFY(small);
+    small->move(QPoint(100, 0));
+
+    HitTestIndex index;
+    index.rebuild(workspace()->stackingOrder());
+    QCOMPARE(index.findTopmost(QPoint(-900, 15), acceptAll), large);
+    QCOMPARE(index.findTopmost(QPoint(60000, 15), acceptAll), large);
+    QVERIFY(!index.findTopmost(QPoint(60000, 30), acceptAll));
+    // the small window is above the large one
+    QCOMPARE(index.findTopmost(QPoint(150, 15), acceptAll), small);
+    QCOMPARE(index.findTopmost(QPoint(150, 15), [small] (Toplevel *t) { return t != small; }), large);
+
+    workspace()->raiseClient(large);
+    index.update(workspace()->stackingOrder());
+    QCOMPARE(index.findTopmost(QPoint(150, 15), acceptAll), large);
+    QCOMPARE(index.findTopmost(QPoint(150, 40), acceptAll), small);
+}
+
+void HitTestIndexTest::testNegativeCoordinates()
+{
+    // this test verifies that windows left of and above the origin are found, the cells
+    // of negative coordinates must not overlap with the ones of positive coordinates
+    XdgShellClient *client = createWindow(QSize(100, 50));
+    QVERIFY(client);
+    client->move(QPoint(-150, -80));
+
+    HitTestIndex index;
+    index.rebuild(workspace()->stackingOrder());
+    QCOMPARE(index.findTopmost(QPoint(-150, -80), acceptAll), client);
+    QCOMPARE(index.findTopmost(QPoint(-51, -31), acceptAll), client);
+    QVERIFY(!index.findTopmost(QPoint(-50, -30), acceptAll));
+    QVERIFY(!index.findTopmost(QPoint(150, 80), acceptAll));
+
+    // spanning the origin
+    client->move(QPoint(-50, -25));
+    QCOMPARE(index.findTopmost(QPoint(-1, -1), acceptAll), client);
+    QCOMPARE(index.findTopmost(QPoint(0, 0), acceptAll), client);
+    QCOMPARE(index.findTopmost(QPoint(49, 24), acceptAll), client);
+    QVERIFY(!index.findTopmost(QPoint(-100, -60), acceptAll));
+}
+
+void HitTestIndexTest::testMultipleScreens()
+{
+    // this test verifies windows on the second screen and across both screens
+    XdgShellClient *across = createWindow(QSize(100, 50));
+    QVERIFY(across);
+    across->move(QPoint(1250, 500));
+    XdgShellClient *second = createWindow(QSize(100, 50));
+    QVERIFY(second);
+    second->move(QPoint(2400, 900));
+
+    HitTestIndex index;
+    index.rebuild(workspace()->stackingOrder());
+    QCOMPARE(index.findTopmost(QPoint(1260, 510), acceptAll), across);
+    QCOMPARE(index.findTopmost(QPoint(1300, 510), acceptAll), across);
+    QCOMPARE(index.findTopmost(QPoint(2450, 920), acceptAll), second);
+    QVERIFY(!index.findTopmost(QPoint(2350, 920), acceptAll));
+
+    // moving the window to the other screen
+    second->move(QPoint(200, 900));
+    QVERIFY(!index.findTopmost(QPoint(2450, 920), acceptAll));
+    QCOMPARE(index.findTopmost(QPoint(250, 920), acceptAll), second);
+}
+
+void HitTestIndexTest::testStackingOrder()
+{
+    // this test verifies that the topmost window is found after restacking
+    XdgShellClient *client1 = createWindow(QSize(100, 50));
+    QVERIFY(client1);
+    XdgShellClient *client2 = createWindow(QSize(100, 50));
+    QVERIFY(client2);
+    client1->move(QPoint(300, 300));
+    client2->move(QPoint(350, 300));
+
+    HitTestIndex index;
+    index.update(workspace()->stackingOrder());
+    QCOMPARE(index.findTopmost(QPoint(360, 310), acceptAll), client2);
+    QCOMPARE(index.findTopmost(QPoint(310, 310), acceptAll), client1);
+    QCOMPARE(index.findTopmost(QPoint(440, 310), acceptAll), client2);
+
+    workspace()->raiseClient(client1);
+    // the list changed, the index needs to be updated
+    QVERIFY(index.windows() != workspace()->stackingOrder());
+    index.update(workspace()->stackingOrder());
+    QCOMPARE(index.findTopmost(QPoint(360, 310), acceptAll), client1);
+    QCOMPARE(index.findTopmost(QPoint(440, 310), acceptAll), client2);
+
+    // geometry changes after restacking still apply
+    client1->move(QPoint(400, 300));
+    QCOMPARE(index.findTopmost(QPoint(360, 310), acceptAll), client2);
+    QCOMPARE(index.findTopmost(QPoint(440, 310), acceptAll), client1);
+
+    workspace()->lowerClient(client1);
+    index.update(workspace()->stackingOrder());
+    QCOMPARE(index.findTopmost(QPoint(440, 310), acceptAll), client2);
+    QCOMPARE(index.findTopmost(QPoint(440, 310), [client2] (Toplevel *t) { return t != client2; }), client1);
+}
+
+}
+
+WAYLANDTEST_MAIN(KWin::HitTestIndexTest)
+#include "hit_test_index_test.moc"
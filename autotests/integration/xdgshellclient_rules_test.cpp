@@ -220,6 +220,8 @@ private Q_SLOTS:
     void testInactiveOpacityForceTemporarily();
 
     void testMatchAfterNameChange();
+    void testMatchTitleRegExp();
+    void testMatchOrder();
 };
 
 void TestXdgShellClientRules::initTestCase()
@@ -4540,5 +4542,78 @@ void TestXdgShellClientRules::testMatchAfterNameChange()
     QCOMPARE(c->keepAbove(), true);
 }
 
+void TestXdgShellClientRules::testMatchTitleRegExp()
+{
+    KSharedConfig::Ptr config = KSharedConfig::openConfig(QString(), KConfig::SimpleConfig);
+    config->group("General").writeEntry("count", 1);
+
+    KConfigGroup group = config->group("1");
+    group.writeEntry("above", true);
+    group.writeEntry("aboverule", int(Rules::Force));
+    group.writeEntry("wmclass", "org.kde.foo");
+    group.writeEntry("wmclasscomplete", false);
+    group.writeEntry("wmclassmatch", int(Rules::ExactMatch));
+    group.writeEntry("title", "^Foo.*Bar$");
+    group.writeEntry("titlematch", int(Rules::RegExpMatch));
+    group.sync();
+
+    RuleBook::self()->setConfig(config);
+    workspace()->slotReconfigure();
+
+    XdgShellClient *client;
+    Surface *surface;
+    XdgShellSurface *shellSurface;
+    std::tie(client, surface, shellSurface) = createWindow(Test::XdgShellSurfaceType::XdgShellStable, "org.kde.foo");
+    QVERIFY(client);
+    QCOMPARE(client->keepAbove(), false);
+
+    // the rules are matched again when the caption changes
+    QSignalSpy captionChangedSpy(client, &AbstractClient::captionChanged);
+    QVERIFY(captionChangedSpy.isValid());
+    shellSurface->setTitle(QStringLiteral("Foo and Bar"));
+    QVERIFY(captionChangedSpy.wait());
+    QTRY_COMPARE(client->keepAbove(), true);
+
+    delete shellSurface;
+    delete surface;
+    QVERIFY(Test::waitForWindowDestroyed(client));
+}
+
+void TestXdgShellClientRules::testMatchOrder()
+{
+    // The rules are looked up by window class, but the first rule in the
+    // rule book still has to win over later ones.
+    KSharedConfig::Ptr config = KSharedConfig::openConfig(QString(), KConfig::SimpleConfig);
+    config->group("General").writeEntry("count", 2);
+
+    KConfigGroup group = config->group("1");
+    group.writeEntry("above", true);
+    group.writeEntry("aboverule", int(Rules::Force));
+    group.writeEntry("wmclass", "kde");
+    group.writeEntry("wmclasscomplete", false);
+    group.writeEntry("wmclassmatch", int(Rules::SubstringMatch));
+    group = config->group("2");
+    group.writeEntry("above", false);
+    group.writeEntry("aboverule", int(Rules::Force));
+    group.writeEntry("wmclass", "org.kde.foo");
+    group.writeEntry("wmclasscomplete", false);
+    group.writeEntry("wmclassmatch", int(Rules::ExactMatch));
+    config->sync();
+
+    RuleBook::self()->setConfig(config);
+    workspace()->slotReconfigure();
+
+    XdgShellClient *client;
+    Surface *surface;
+    XdgShellSurface *shellSurface;
+    std::tie(client, surface, shellSurface) = createWindow(Test::XdgShellSurfaceType::XdgShellStable, "org.kde.foo");
+    QVERIFY(client);
+    QCOMPARE(client->keepAbove(), true);
+
+    delete shellSurface;
+    delete surface;
+    QVERIFY(Test::waitForWindowDestroyed(client));
+}
+
 WAYLANDTEST_MAIN(TestXdgShellClientRules)
 #include "xdgshellclient_rules_test.moc"
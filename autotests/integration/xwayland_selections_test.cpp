@@ -98,9 +98,15 @@ void XwaylandSelectionsTest::testSync_data()
 {
     QTest::addColumn<QString>("copyPlatform");
     QTest::addColumn<QString>("pastePlatform");
-
-    QTest::newRow("x11->wayland") << QStringLiteral("xcb") << QStringLiteral("wayland");
-    QTest::newRow("wayland->x11") << QStringLiteral("wayland") << QStringLiteral("xcb");
+    QTest::addColumn<int>("size");
+
+    QTest::newRow("x11->wayland") << QStringLiteral("xcb") << QStringLiteral("wayland") << 0;
+    QTest::newRow("wayland->x11") << QStringLiteral("wayland") << QStringLiteral("xcb") << 0;
+    // large enough for incremental transfers in several chunks
+    QTest::newRow("x11->wayland 4MB") << QStringLiteral("xcb") << QStringLiteral("wayland") << 4 * 1024 * 1024;
+    QTest::newRow("wayland->x11 4MB") << QStringLiteral("wayland") << QStringLiteral("xcb") << 4 * 1024 * 1024;
+    QTest::newRow("x11->wayland 16MB") << QStringLiteral("xcb") << QStringLiteral("wayland") << 16 * 1024 * 1024;
+    QTest::newRow("wayland->x11 16MB") << QStringLiteral("wayland") << QStringLiteral("xcb") << 16 * 1024 * 1024;
 }
 
 void XwaylandSelectionsTest::testSync()
@@ -119,6 +125,9 @@ void XwaylandSelectionsTest::testSync()
     QVERIFY(clipboardChangedSpy.isValid());
 
     QProcessEnvironment environment = QProcessEnvironment::systemEnvironment();
+    // without a size the helpers use a short default text
+    QFETCH(int, size);
+    const QStringList arguments = size > 0 ? QStringList{QString::number(size)} : QStringList{};
 
     // start the copy process
     QFETCH(QString, copyPlatform);
@@ -128,6 +137,7 @@ void XwaylandSelectionsTest::testSync()
     m_copyProcess->setProcessEnvironment(environment);
     m_copyProcess->setProcessChannelMode(QProcess::ForwardedChannels);
     m_copyProcess->setProgram(copy);
+    m_copyProcess->setArguments(arguments);
     m_copyProcess->start();
     QVERIFY(m_copyProcess->waitForStarted());
 
@@ -163,6 +173,7 @@ void XwaylandSelectionsTest::testSync()
     m_pasteProcess->setProcessEnvironment(environment);
     m_pasteProcess->setProcessChannelMode(QProcess::ForwardedChannels);
     m_pasteProcess->setProgram(paste);
+    m_pasteProcess->setArguments(arguments);
     m_pasteProcess->start();
     QVERIFY(m_pasteProcess->waitForStarted());
 
@@ -185,7 +196,10 @@ void XwaylandSelectionsTest::testSync()
         QVERIFY(clientActivatedSpy.wait());
     }
     QTRY_COMPARE(workspace()->activeClient(), pasteClient);
-    QVERIFY(finishedSpy.wait());
+    // reports how long the transfer takes once the paste client got focus
+    QBENCHMARK_ONCE {
+        QVERIFY(finishedSpy.wait(30000));
+    }
     QCOMPARE(finishedSpy.first().first().toInt(), 0);
     delete m_pasteProcess;
     m_pasteProcess = nullptr;
@@ -0,0 +1,110 @@
+/********************************************************************
+ KWin - the KDE window manager
+ This file is part of the KDE project.
+
+Copyright (C) 2020 The KWin developers <kwin@kde.org>
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*********************************************************************/
+#include "../../libinput/ringbuffer.h"
+
+#include <QtTest>
+#include <QThread>
+
+using KWin::LibInput::RingBuffer;
+
+class TestRingBuffer : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void testEmpty();
+    void testFull();
+    void testWrapAround();
+    void testThreads();
+};
+
+void TestRingBuffer::testEmpty()
+{
+    RingBuffer<int, 4> buffer;
+    QVERIFY(!buffer.front());
+    int value = 0;
+    QVERIFY(!buffer.pop(&value));
+    QCOMPARE(buffer.capacity(), std::size_t(4));
+}
+
+void TestRingBuffer::testFull()
+{
+    RingBuffer<int, 4> buffer;
+    for (int i = 0; i < 4; ++i) {
+        QVERIFY(buffer.push(i));
+    }
+    QVERIFY(!buffer.push(4));
+    QCOMPARE(*buffer.front(), 0);
+
+    int value = -1;
+    QVERIFY(buffer.pop(&value));
+    QCOMPARE(value, 0);
+    // there is room again
+    QVERIFY(buffer.push(4));
+    QVERIFY(!buffer.push(5));
+}
+
+void TestRingBuffer::testWrapAround()
+{
+    RingBuffer<int, 4> buffer;
+    int value = -1;
+    for (int i = 0; i < 10; ++i) {
+        QVERIFY(buffer.push(i));
+        QVERIFY(buffer.push(i + 100));
+        QCOMPARE(*buffer.front(), i);
+        QVERIFY(buffer.pop(&value));
+        QCOMPARE(value, i);
+        QVERIFY(buffer.pop(&value));
+        QCOMPARE(value, i + 100);
+    }
+    QVERIFY(!buffer.front());
+}
+
+void TestRingBuffer::testThreads()
+{
+    static const int count = 100000;
+    RingBuffer<int, 64> buffer;
+    QScopedPointer<QThread> producer(QThread::create([&buffer] {
+        for (int i = 0; i < count;) {
+            if (buffer.push(i)) {
+                ++i;
+            } else {
+                QThread::yieldCurrentThread();
+            }
+        }
+    }));
+    producer->start();
+
+    // the values have to arrive complete and in order
+    int expected = 0;
+    while (expected < count) {
+        int value;
+        if (buffer.pop(&value)) {
+            QCOMPARE(value, expected);
+            ++expected;
+        } else {
+            QThread::yieldCurrentThread();
+        }
+    }
+    QVERIFY(producer->wait());
+    QVERIFY(!buffer.front());
+}
+
+QTEST_GUILESS_MAIN(TestRingBuffer)
+#include "ringbuffer_test.moc"
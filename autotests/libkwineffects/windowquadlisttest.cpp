@@ -18,8 +18,13 @@ You should have received a copy of the GNU General Public License
 along with this program.  If not, see <http://www.gnu.org/licenses/>.
 *********************************************************************/
 #include <kwineffects.h>
+#include <QMatrix4x4>
 #include <QTest>
 
+#include <epoxy/gl.h>
+
+#include <cstring>
+
 Q_DECLARE_METATYPE(KWin::WindowQuadList)
 
 class WindowQuadListTest : public QObject
@@ -30,6 +35,8 @@ private Q_SLOTS:
     void testMakeGrid();
     void testMakeRegularGrid_data();
     void testMakeRegularGrid();
+    void testMakeInterleavedArrays_data();
+    void testMakeInterleavedArrays();
 
 private:
     KWin::WindowQuad makeQuad(const QRectF &rect);
@@ -216,6 +223,50 @@ void WindowQuadListTest::testMakeRegularGrid()
     }
 }
 
+void WindowQuadListTest::testMakeInterleavedArrays_data()
+{
+    QTest::addColumn<uint>("type");
+    QTest::addColumn<int>("byteOffset");
+    QTest::addColumn<QVector<int>>("indices");
+
+    const QVector<int> quadIndices{0, 1, 2, 3};
+    const QVector<int> triangleIndices{1, 0, 3, 3, 2, 1};
+
+    // An offset of eight bytes makes the destination unaligned for the SSE2 code path
+    QTest::newRow("quads/aligned") << uint(GL_QUADS) << 0 << quadIndices;
+    QTest::newRow("quads/unaligned") << uint(GL_QUADS) << 8 << quadIndices;
+    QTest::newRow("triangles/aligned") << uint(GL_TRIANGLES) << 0 << triangleIndices;
+    QTest::newRow("triangles/unaligned") << uint(GL_TRIANGLES) << 8 << triangleIndices;
+}
+
+void WindowQuadListTest::testMakeInterleavedArrays()
+{
+    QFETCH(uint, type);
+    QFETCH(int, byteOffset);
+    QFETCH(QVector<int>, indices);
+
+    KWin::WindowQuadList quads;
+    quads << makeQuad(QRectF(0, 0, 10, 20)) << makeQuad(QRectF(10, 20, 30, 40));
+    quads[1][2].move(45, 65);
+
+    QMatrix4x4 textureMatrix;
+    textureMatrix.translate(0.5, 0.25);
+    textureMatrix.scale(0.5, 0.25);
+
+    const int vertexCount = quads.count() * indices.count();
+    alignas(16) char buffer[(12 + 1) * sizeof(KWin::GLVertex2D)];
+    KWin::GLVertex2D *vertices = reinterpret_cast<KWin::GLVertex2D *>(buffer + byteOffset);
+    quads.makeInterleavedArrays(type, vertices, textureMatrix);
+
+    for (int i = 0; i < vertexCount; ++i) {
+        const KWin::WindowVertex &expected = quads[i / indices.count()][indices[i % indices.count()]];
+        KWin::GLVertex2D actual;
+        std::memcpy(&actual, vertices + i, sizeof(actual));
+        QCOMPARE(actual.position, QVector2D(expected.x(), expected.y()));
+        QCOMPARE(actual.texcoord, QVector2D(expected.u() * 0.5 + 0.5, expected.v() * 0.25 + 0.25));
+    }
+}
+
 QTEST_MAIN(WindowQuadListTest)
 
 #include "windowquadlisttest.moc"
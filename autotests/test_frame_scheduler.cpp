@@ -0,0 +1,163 @@
+/********************************************************************
+KWin - the KDE window manager
+This file is part of the KDE project.
+
+Copyright (C) 2020 The KWin developers <kwin@kde.org>
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*********************************************************************/
+#include "../frame_scheduler.h"
+
+#include <QTest>
+
+using namespace KWin;
+
+static qint64 ms(qint64 milli)
+{
+    return milli * 1000 * 1000;
+}
+
+class FrameSchedulerTest : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void init();
+    void testPredictedRenderTime();
+    void testWithoutVBlank();
+    void testRenderStart_data();
+    void testRenderStart();
+    void testSlowFrames();
+    void testMissedVBlank();
+    void testEarlierVBlank();
+    void testReset();
+
+private:
+    FrameScheduler m_scheduler;
+};
+
+void FrameSchedulerTest::init()
+{
+    m_scheduler.reset();
+    m_scheduler.setRefreshInterval(ms(16));
+    m_scheduler.setSafetyMargin(ms(1));
+}
+
+void FrameSchedulerTest::testPredictedRenderTime()
+{
+    // without history a whole refresh cycle is assumed
+    QCOMPARE(m_scheduler.predictedRenderTime(), ms(16));
+
+    m_scheduler.addRenderTime(ms(2));
+    m_scheduler.addRenderTime(ms(5));
+    m_scheduler.addRenderTime(ms(3));
+    QCOMPARE(m_scheduler.predictedRenderTime(), ms(5));
+
+    // the spike is forgotten once enough frames followed
+    for (int i = 0; i < 32; ++i) {
+        m_scheduler.addRenderTime(ms(1));
+    }
+    QCOMPARE(m_scheduler.predictedRenderTime(), ms(1));
+}
+
+void FrameSchedulerTest::testWithoutVBlank()
+{
+    m_scheduler.addRenderTime(ms(2));
+    QVERIFY(!m_scheduler.hasVBlank());
+    QCOMPARE(m_scheduler.nextRenderStart(ms(100)), ms(100));
+}
+
+void FrameSchedulerTest::testRenderStart_data()
+{
+    QTest::addColumn<qint64>("renderTime");
+    QTest::addColumn<qint64>("now");
+    QTest::addColumn<qint64>("expected");
+
+    QTest::newRow("right after vblank") << ms(3) << ms(101) << ms(112);
+    QTest::newRow("late in the cycle") << ms(3) << ms(113) << ms(128);
+    QTest::newRow("start now") << ms(3) << ms(112) << ms(112);
+    QTest::newRow("idle for a while") << ms(3) << ms(500) << ms(512);
+    QTest::newRow("expensive") << ms(12) << ms(101) << ms(103);
+}
+
+void FrameSchedulerTest::testRenderStart()
+{
+    QFETCH(qint64, renderTime);
+    m_scheduler.addRenderTime(renderTime);
+    m_scheduler.notifyVBlank(ms(100));
+    QVERIFY(m_scheduler.hasVBlank());
+
+    QFETCH(qint64, now);
+    QTEST(m_scheduler.nextRenderStart(now), "expected");
+}
+
+void FrameSchedulerTest::testSlowFrames()
+{
+    // a frame taking longer than a refresh cycle can't be delayed
+    m_scheduler.addRenderTime(ms(20));
+    m_scheduler.notifyVBlank(ms(100));
+    QCOMPARE(m_scheduler.nextRenderStart(ms(101)), ms(101));
+}
+
+void FrameSchedulerTest::testMissedVBlank()
+{
+    m_scheduler.addRenderTime(ms(3));
+    m_scheduler.notifyVBlank(ms(100));
+    QCOMPARE(m_scheduler.nextRenderStart(ms(101)), ms(112));
+
+    // the frame is meant for the vblank at 116 but only makes the one at 132
+    m_scheduler.frameSubmitted(ms(112));
+    m_scheduler.notifyVBlank(ms(132));
+    QCOMPARE(m_scheduler.nextRenderStart(ms(133)), ms(142));
+
+    // frames on time let the padding decay again
+    m_scheduler.frameSubmitted(ms(142));
+    m_scheduler.notifyVBlank(ms(148));
+    QVERIFY(m_scheduler.nextRenderStart(ms(149)) > ms(158));
+}
+
+void FrameSchedulerTest::testEarlierVBlank()
+{
+    m_scheduler.addRenderTime(ms(3));
+    m_scheduler.notifyVBlank(ms(100));
+
+    // takes more than a cycle, so the frame is meant for the vblank at 132
+    m_scheduler.addRenderTime(ms(16));
+    m_scheduler.frameSubmitted(ms(101));
+    // a cursor update flips in between, that is not the frame
+    m_scheduler.notifyVBlank(ms(116));
+    m_scheduler.notifyVBlank(ms(132));
+    QCOMPARE(m_scheduler.lastVBlank(), ms(132));
+
+    // no padding was added, so it's still on the limit
+    QCOMPARE(m_scheduler.nextRenderStart(ms(133)), ms(133));
+    for (int i = 0; i < 32; ++i) {
+        m_scheduler.addRenderTime(ms(3));
+    }
+    QCOMPARE(m_scheduler.nextRenderStart(ms(133)), ms(144));
+}
+
+void FrameSchedulerTest::testReset()
+{
+    m_scheduler.addRenderTime(ms(3));
+    m_scheduler.notifyVBlank(ms(100));
+    m_scheduler.reset();
+
+    QVERIFY(!m_scheduler.hasVBlank());
+    QCOMPARE(m_scheduler.predictedRenderTime(), ms(16));
+    QCOMPARE(m_scheduler.refreshInterval(), ms(16));
+    QCOMPARE(m_scheduler.safetyMargin(), ms(1));
+}
+
+QTEST_GUILESS_MAIN(FrameSchedulerTest)
+#include "test_frame_scheduler.moc"
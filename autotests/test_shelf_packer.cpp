@@ -0,0 +1,125 @@
+/********************************************************************
+KWin - the KDE window manager
+This file is part of the KDE project.
+
+Copyright (C) 2020 The KWin developers <kwin@kde.org>
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*********************************************************************/
+#include "../plugins/scenes/opengl/shelf_packer.h"
+
+#include <QTest>
+
+using namespace KWin;
+
+class ShelfPackerTest : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void testInvalidSizes_data();
+    void testInvalidSizes();
+    void testShelves();
+    void testReuse();
+    void testFull();
+    void testReleaseLastShelf();
+    void testGrow();
+};
+
+void ShelfPackerTest::testInvalidSizes_data()
+{
+    QTest::addColumn<QSize>("size");
+
+    QTest::newRow("empty") << QSize();
+    QTest::newRow("no width") << QSize(0, 10);
+    QTest::newRow("too wide") << QSize(101, 10);
+    QTest::newRow("too high") << QSize(10, 101);
+}
+
+void ShelfPackerTest::testInvalidSizes()
+{
+    ShelfPacker packer(QSize(100, 100));
+    QFETCH(QSize, size);
+    QVERIFY(!packer.allocate(size).isValid());
+    QCOMPARE(packer.usedArea(), 0);
+    QCOMPARE(packer.usedHeight(), 0);
+}
+
+void ShelfPackerTest::testShelves()
+{
+    ShelfPacker packer(QSize(100, 100));
+    QCOMPARE(packer.allocate(QSize(60, 20)), QRect(0, 0, 60, 20));
+    QCOMPARE(packer.allocate(QSize(40, 10)), QRect(60, 0, 40, 10));
+    // the first shelf is full
+    QCOMPARE(packer.allocate(QSize(10, 10)), QRect(0, 20, 10, 10));
+    // a lower shelf is preferred if there is room
+    QCOMPARE(packer.allocate(QSize(50, 5)), QRect(10, 20, 50, 5));
+    QCOMPARE(packer.usedArea(), 60 * 20 + 40 * 10 + 10 * 10 + 50 * 5);
+    QCOMPARE(packer.usedHeight(), 30);
+}
+
+void ShelfPackerTest::testReuse()
+{
+    ShelfPacker packer(QSize(100, 100));
+    QVERIFY(packer.allocate(QSize(30, 10)).isValid());
+    const QRect second = packer.allocate(QSize(30, 10));
+    QVERIFY(packer.allocate(QSize(30, 10)).isValid());
+    QCOMPARE(second, QRect(30, 0, 30, 10));
+
+    packer.release(second);
+    QCOMPARE(packer.usedArea(), 2 * 30 * 10);
+    // doesn't fit into the hole
+    QCOMPARE(packer.allocate(QSize(40, 10)), QRect(0, 10, 40, 10));
+    QCOMPARE(packer.allocate(QSize(20, 10)), QRect(30, 0, 20, 10));
+    QCOMPARE(packer.allocate(QSize(10, 10)), QRect(50, 0, 10, 10));
+}
+
+void ShelfPackerTest::testFull()
+{
+    ShelfPacker packer(QSize(100, 30));
+    QVERIFY(packer.allocate(QSize(100, 20)).isValid());
+    QVERIFY(!packer.allocate(QSize(10, 11)).isValid());
+    QCOMPARE(packer.allocate(QSize(10, 10)), QRect(0, 20, 10, 10));
+}
+
+void ShelfPackerTest::testReleaseLastShelf()
+{
+    ShelfPacker packer(QSize(100, 30));
+    QVERIFY(packer.allocate(QSize(100, 10)).isValid());
+    const QRect rect = packer.allocate(QSize(100, 5));
+    QCOMPARE(rect, QRect(0, 10, 100, 5));
+    QVERIFY(!packer.allocate(QSize(100, 16)).isValid());
+
+    // the empty shelf at the end is given back
+    packer.release(rect);
+    QCOMPARE(packer.usedHeight(), 10);
+    QCOMPARE(packer.allocate(QSize(100, 16)), QRect(0, 10, 100, 16));
+
+    packer.clear();
+    QCOMPARE(packer.usedArea(), 0);
+    QCOMPARE(packer.allocate(QSize(100, 30)), QRect(0, 0, 100, 30));
+}
+
+void ShelfPackerTest::testGrow()
+{
+    ShelfPacker packer(QSize(100, 10));
+    QVERIFY(packer.allocate(QSize(100, 10)).isValid());
+    QVERIFY(!packer.allocate(QSize(100, 10)).isValid());
+
+    packer.setSize(QSize(100, 20));
+    QCOMPARE(packer.size(), QSize(100, 20));
+    QCOMPARE(packer.allocate(QSize(100, 10)), QRect(0, 10, 100, 10));
+}
+
+QTEST_GUILESS_MAIN(ShelfPackerTest)
+#include "test_shelf_packer.moc"
@@ -44,6 +44,8 @@ namespace ColorCorrect {
 
 static const int QUICK_ADJUST_DURATION = 2000;
 static const int TEMPERATURE_STEP = 50;
+// in bytes, holds every step of a transition between the extreme temperatures for common lut sizes
+static const int GAMMA_RAMP_CACHE_SIZE = 16 * 1024 * 1024;
 
 static bool checkLocation(double lat, double lng)
 {
@@ -78,8 +80,12 @@ Manager::Manager(QObject *parent)
 
         QDBusConnection::sessionBus().asyncCall(message);
     });
+
+    m_gammaRamps.setMaxCost(GAMMA_RAMP_CACHE_SIZE);
 }
 
+Manager::~Manager() = default;
+
 void Manager::init()
 {
     Settings::instance(kwinApp()->config());
@@ -633,45 +639,59 @@ int Manager::currentTargetTemp() const
     }
 }
 
+const GammaRamp *Manager::gammaRamp(int temperature, int size)
+{
+    const QPair<int, int> key(temperature, size);
+    if (const GammaRamp *ramp = m_gammaRamps.object(key)) {
+        return ramp;
+    }
+
+    GammaRamp *ramp = new GammaRamp(size);
+
+    /*
+     * The gamma calculation below is based on the Redshift app:
+     * https://github.com/jonls/redshift
+     */
+    uint16_t *red = ramp->red();
+    uint16_t *green = ramp->green();
+    uint16_t *blue = ramp->blue();
+
+    // approximate white point
+    float whitePoint[3];
+    float alpha = (temperature % 100) / 100.;
+    int bbCIndex = ((temperature - 1000) / 100) * 3;
+    whitePoint[0] = (1. - alpha) * blackbodyColor[bbCIndex] + alpha * blackbodyColor[bbCIndex + 3];
+    whitePoint[1] = (1. - alpha) * blackbodyColor[bbCIndex + 1] + alpha * blackbodyColor[bbCIndex + 4];
+    whitePoint[2] = (1. - alpha) * blackbodyColor[bbCIndex + 2] + alpha * blackbodyColor[bbCIndex + 5];
+
+    // linear default state scaled by the white point
+    const float step = float(UINT16_MAX + 1) / size;
+    for (int i = 0; i < size; i++) {
+        const uint16_t value = i * step;
+        red[i] = value * whitePoint[0];
+        green[i] = value * whitePoint[1];
+        blue[i] = value * whitePoint[2];
+    }
+
+    const int cost = size * 3 * sizeof(uint16_t);
+    if (cost > m_gammaRamps.maxCost()) {
+        // QCache would drop it right away
+        m_uncachedGammaRamp.reset(ramp);
+        return ramp;
+    }
+    m_gammaRamps.insert(key, ramp, cost);
+    return ramp;
+}
+
 void Manager::commitGammaRamps(int temperature)
 {
     const auto outs = kwinApp()->platform()->outputs();
 
     for (auto *o : outs) {
-        int rampsize = o->gammaRampSize();
-        GammaRamp ramp(rampsize);
-
-        /*
-         * The gamma calculation below is based on the Redshift app:
-         * https://github.com/jonls/redshift
-         */
-        uint16_t *red = ramp.red();
-        uint16_t *green = ramp.green();
-        uint16_t *blue = ramp.blue();
-
-        // linear default state
-        for (int i = 0; i < rampsize; i++) {
-                uint16_t value = (double)i / rampsize * (UINT16_MAX + 1);
-                red[i] = value;
-                green[i] = value;
-                blue[i] = value;
-        }
-
-        // approximate white point
-        float whitePoint[3];
-        float alpha = (temperature % 100) / 100.;
-        int bbCIndex = ((temperature - 1000) / 100) * 3;
-        whitePoint[0] = (1. - alpha) * blackbodyColor[bbCIndex] + alpha * blackbodyColor[bbCIndex + 3];
-        whitePoint[1] = (1. - alpha) * blackbodyColor[bbCIndex + 1] + alpha * blackbodyColor[bbCIndex + 4];
-        whitePoint[2] = (1. - alpha) * blackbodyColor[bbCIndex + 2] + alpha * blackbodyColor[bbCIndex + 5];
-
-        for (int i = 0; i < rampsize; i++) {
-            red[i] = qreal(red[i]) / (UINT16_MAX+1) * whitePoint[0] * (UINT16_MAX+1);
-            green[i] = qreal(green[i]) / (UINT16_MAX+1) * whitePoint[1] * (UINT16_MAX+1);
-            blue[i] = qreal(blue[i]) / (UINT16_MAX+1) * whitePoint[2] * (UINT16_MAX+1);
-        }
+        // outputs with the same ramp size share the ramp
+        const GammaRamp *ramp = gammaRamp(temperature, o->gammaRampSize());
 
-        if (o->setGammaRamp(ramp)) {
+        if (o->setGammaRamp(*ramp)) {
             setCurrentTemperature(temperature);
             m_failedCommitAttempts = 0;
         } else {
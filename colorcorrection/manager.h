@@ -24,6 +24,8 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <kwin_export.h>
 
 #include <QObject>
+#include <QCache>
+#include <QScopedPointer>
 #include <QPair>
 #include <QDateTime>
 
@@ -33,6 +35,7 @@ namespace KWin
 {
 
 class ClockSkewNotifier;
+class GammaRamp;
 class Workspace;
 
 namespace ColorCorrect
@@ -93,6 +96,7 @@ class KWIN_EXPORT Manager : public QObject
 
 public:
     Manager(QObject *parent);
+    ~Manager() override;
     void init();
 
     /**
@@ -273,6 +277,11 @@ private:
     bool daylight() const;
 
     void commitGammaRamps(int temperature);
+    /**
+     * The ramp of @p size entries for @p temperature, computed once and then taken from
+     * the cache. The returned ramp stays valid until the next call.
+     */
+    const GammaRamp *gammaRamp(int temperature, int size);
 
     void setEnabled(bool enabled);
     void setRunning(bool running);
@@ -321,6 +330,11 @@ private:
     int m_failedCommitAttempts = 0;
     int m_inhibitReferenceCount = 0;
 
+    // ramps of the recently used temperatures, by temperature and ramp size, costed in bytes
+    QCache<QPair<int, int>, GammaRamp> m_gammaRamps;
+    // a ramp too large for the cache
+    QScopedPointer<GammaRamp> m_uncachedGammaRamp;
+
     // The Workspace class needs to call initShortcuts during initialization.
     friend class KWin::Workspace;
 };
@@ -19,6 +19,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 *********************************************************************/
 #include "composite.h"
 
+#include "abstract_output.h"
 #include "dbusinterface.h"
 #include "x11client.h"
 #include "decorations/decoratedclient.h"
@@ -50,6 +51,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <KSelectionOwner>
 
 #include <QDateTime>
+#include <QElapsedTimer>
 #include <QFutureWatcher>
 #include <QMenu>
 #include <QOpenGLContext>
@@ -62,6 +64,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <xcb/damage.h>
 
 #include <cstdio>
+#include <time.h>
 
 Q_DECLARE_METATYPE(KWin::X11Compositor::SuspendReason)
 
@@ -117,7 +120,15 @@ private:
 };
 
 static inline qint64 milliToNano(int milli) { return qint64(milli) * 1000 * 1000; }
-static inline qint64 nanoToMilli(int nano) { return nano / (1000*1000); }
+static inline qint64 nanoToMilli(qint64 nano) { return nano / (1000*1000); }
+
+static qint64 monotonicTime()
+{
+    // the time base of the vblank timestamps
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return qint64(ts.tv_sec) * 1000 * 1000 * 1000 + ts.tv_nsec;
+}
 
 Compositor::Compositor(QObject* workspace)
     : QObject(workspace)
@@ -342,6 +353,9 @@ void Compositor::startupWithWorkspace()
         // No vsync - DO NOT set "0", would cause div-by-zero segfaults.
         vBlankInterval = milliToNano(1);
     }
+    m_frameScheduler.reset();
+    m_frameScheduler.setRefreshInterval(m_scene->syncsToVBlank() ? vBlankInterval : 0);
+    m_frameScheduler.setSafetyMargin(options->renderSafetyMargin());
 
     // Sets also the 'effects' pointer.
     kwinApp()->platform()->createEffectsHandler(this, m_scene);
@@ -594,10 +608,29 @@ void Compositor::bufferSwapComplete()
 
     if (m_composeAtSwapCompletion) {
         m_composeAtSwapCompletion = false;
-        performCompositing();
+        if (m_frameScheduler.hasVBlank() && !isVrrActive()) {
+            // Don't start right away, the frame would wait for the vblank after being
+            // painted and show stale input by then.
+            setCompositeTimer();
+        } else {
+            performCompositing();
+        }
     }
 }
 
+void Compositor::notifyVBlank(int screen, qint64 timestamp)
+{
+    if (screen != 0) {
+        return;
+    }
+    m_frameScheduler.notifyVBlank(timestamp);
+}
+
+bool Compositor::isRepaintScheduled() const
+{
+    return compositeTimer.isActive() || m_composeAtSwapCompletion;
+}
+
 void Compositor::performCompositing()
 {
     // If a buffer swap is still pending, we return to the event loop and
@@ -663,6 +696,7 @@ void Compositor::performCompositing()
         // need this anymore and paints normally will also reset the suspended unredirect.
         // Otherwise the window would not be painted normally anyway.
         compositeTimer.stop();
+        emit compositingPassCompleted();
         return;
     }
 
@@ -683,14 +717,51 @@ void Compositor::performCompositing()
         }
     }
 
+    // Collect the repaints of the windows as well, so that every output painted in this
+    // pass gets the complete damage. The Scene resets the repaints of a window while
+    // painting the first output.
     QRegion repaints = repaints_region;
+    for (Toplevel *win : qAsConst(windows)) {
+        repaints |= win->repaints();
+    }
+
+    // Outputs still waiting for their previous frame to be presented cannot take a new
+    // one. Keep their damage for the pass following their page flip instead of holding
+    // back the outputs which are ready.
+    QRegion deferred;
+    const auto outputs = kwinApp()->platform()->enabledOutputs();
+    for (AbstractOutput *output : outputs) {
+        if (output->isFramePending()) {
+            deferred |= repaints & output->geometry();
+        }
+    }
+    repaints -= deferred;
+
     // clear all repaints, so that post-pass can add repaints for the next repaint
-    repaints_region = QRegion();
+    repaints_region = deferred;
+
+    if (repaints.isEmpty() && !deferred.isEmpty()) {
+        // Only outputs with a pending frame are damaged, the next page flip
+        // schedules the repaint.
+        compositeTimer.stop();
+        emit compositingPassCompleted();
+        return;
+    }
 
     if (m_framesToTestForSafety > 0 && (m_scene->compositingType() & OpenGLCompositing)) {
         kwinApp()->platform()->createOpenGLSafePoint(Platform::OpenGLSafePoint::PreFrame);
     }
+    const qint64 frameStart = monotonicTime();
+    QElapsedTimer paintTimer;
+    if (m_scene->recordsFrameTimings()) {
+        paintTimer.start();
+    }
     m_timeSinceLastVBlank = m_scene->paint(repaints, windows);
+    if (paintTimer.isValid()) {
+        m_scene->finishFrameTimings(paintTimer.nsecsElapsed());
+    }
+    m_frameScheduler.addRenderTime(m_timeSinceLastVBlank);
+    m_frameScheduler.frameSubmitted(frameStart);
     if (m_framesToTestForSafety > 0) {
         if (m_scene->compositingType() & OpenGLCompositing) {
             kwinApp()->platform()->createOpenGLSafePoint(Platform::OpenGLSafePoint::PostFrame);
@@ -724,6 +795,7 @@ void Compositor::performCompositing()
     } else {
         scheduleRepaint();
     }
+    emit compositingPassCompleted();
 }
 
 template <class T>
@@ -782,6 +854,7 @@ void Compositor::setCompositeTimer()
     }
 
     uint waitTime = 1;
+    Qt::TimerType timerType = Qt::CoarseTimer;
 
     if (m_scene->blocksForRetrace()) {
 
@@ -811,7 +884,16 @@ void Compositor::setCompositeTimer()
         }
     }
     else { // w/o blocking vsync we just jump to the next demanded tick
-        if (fpsInterval > m_timeSinceLastVBlank) {
+        if (isVrrActive()) {
+            // There is no tick, the output refreshes as soon as the frame arrives. The page
+            // flips keep the frame rate within what the outputs can show.
+            waitTime = 1;
+        } else if (m_frameScheduler.hasVBlank()) {
+            // Start as late as the recent render times allow to still make the next vblank.
+            const qint64 now = monotonicTime();
+            waitTime = nanoToMilli(m_frameScheduler.nextRenderStart(now) - now);
+            timerType = Qt::PreciseTimer;
+        } else if (fpsInterval > m_timeSinceLastVBlank) {
             waitTime = nanoToMilli(fpsInterval - m_timeSinceLastVBlank);
             if (!waitTime) {
                 // Will ensure we don't block out the eventloop - the system's just not faster ...
@@ -838,7 +920,17 @@ void Compositor::setCompositeTimer()
         }
     }
     // Force 4fps minimum:
-    compositeTimer.start(qMin(waitTime, 250u), this);
+    compositeTimer.start(qMin(waitTime, 250u), timerType, this);
+}
+
+bool Compositor::isVrrActive() const
+{
+    const auto outputs = kwinApp()->platform()->enabledOutputs();
+    return std::any_of(outputs.constBegin(), outputs.constEnd(),
+        [] (AbstractOutput *output) {
+            return output->isVrrActive();
+        }
+    );
 }
 
 bool Compositor::isActive()
@@ -20,6 +20,8 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 *********************************************************************/
 #pragma once
 
+#include "frame_scheduler.h"
+
 #include <kwinglobals.h>
 
 #include <QObject>
@@ -72,6 +74,23 @@ public:
      */
     void bufferSwapComplete();
 
+    /**
+     * Notifies the compositor that a frame got presented on @p screen at the vblank at
+     * @p timestamp, in nanoseconds on the CLOCK_MONOTONIC time base.
+     *
+     * Once the platform reports vblanks, the next frame is started as late as possible
+     * while still being presented with the next vblank, instead of right after the swap.
+     * Only the first screen is followed, the refresh interval is taken from it as well.
+     * The outputs refresh independently, so the vblanks of the others don't fit in.
+     */
+    void notifyVBlank(int screen, qint64 timestamp);
+
+    /**
+     * Whether a compositing pass is about to run, either on the composite timer or once
+     * the pending buffer swap completed.
+     */
+    bool isRepaintScheduled() const;
+
     /**
      * Toggles compositing, that is if the Compositor is suspended it will be resumed
      * and if the Compositor is active it will be suspended.
@@ -115,6 +134,10 @@ Q_SIGNALS:
     void aboutToToggleCompositing();
     void sceneCreated();
     void bufferSwapCompleted();
+    /**
+     * Emitted after every compositing pass, also if there was nothing to paint.
+     */
+    void compositingPassCompleted();
 
 protected:
     explicit Compositor(QObject *parent = nullptr);
@@ -146,6 +169,7 @@ private:
     void setupX11Support();
 
     void setCompositeTimer();
+    bool isVrrActive() const;
     bool windowRepaintsPending() const;
 
     void releaseCompositorSelection();
@@ -170,6 +194,7 @@ private:
 
     int m_framesToTestForSafety = 3;
     QElapsedTimer m_monotonicClock;
+    FrameScheduler m_frameScheduler;
 };
 
 class KWIN_EXPORT WaylandCompositor : public Compositor
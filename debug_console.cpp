@@ -42,17 +42,23 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <KWayland/Server/subcompositor_interface.h>
 #include <KWayland/Server/surface_interface.h>
 // frameworks
+#include <KFormat>
 #include <KLocalizedString>
 #include <NETWM>
 // Qt
 #include <QMouseEvent>
 #include <QMetaProperty>
 #include <QMetaType>
+#include <QTimer>
+#include <QTreeWidget>
 
 // xkb
 #include <xkbcommon/xkbcommon.h>
 
+#include <cxxabi.h>
+#include <cstdlib>
 #include <functional>
+#include <typeinfo>
 
 namespace KWin
 {
@@ -601,6 +607,14 @@ DebugConsole::DebugConsole()
                 updateKeyboardTab();
                 connect(input(), &InputRedirection::keyStateChanged, this, &DebugConsole::updateKeyboardTab);
             }
+            // measuring the filters costs time, so only start once the tab is selected
+            if (index == 6 && !m_inputFiltersTimer) {
+                input()->setFilterProfilingEnabled(true);
+                updateInputFiltersTab();
+                m_inputFiltersTimer = new QTimer(this);
+                connect(m_inputFiltersTimer, &QTimer::timeout, this, &DebugConsole::updateInputFiltersTab);
+                m_inputFiltersTimer->start(500);
+            }
         }
     );
 
@@ -610,7 +624,12 @@ DebugConsole::DebugConsole()
     initGLTab();
 }
 
-DebugConsole::~DebugConsole() = default;
+DebugConsole::~DebugConsole()
+{
+    if (m_inputFiltersTimer && input()) {
+        input()->setFilterProfilingEnabled(false);
+    }
+}
 
 void DebugConsole::initGLTab()
 {
@@ -642,6 +661,20 @@ void DebugConsole::initGLTab()
 
     m_ui->platformExtensionsLabel->setText(extensionsString(Compositor::self()->scene()->openGLPlatformInterfaceExtensions()));
     m_ui->openGLExtensionsLabel->setText(extensionsString(openGLExtensions()));
+
+    auto updateStreamingBuffer = [this] {
+        // the streaming buffer is recreated when compositing restarts
+        const GLVertexBuffer *vbo = GLVertexBuffer::streamingBuffer();
+        if (!vbo) {
+            return;
+        }
+        m_ui->streamingBufferPersistentLabel->setText(vbo->isPersistent() ? i18n("yes") : i18n("no"));
+        m_ui->streamingBufferFrameSizeLabel->setText(KFormat().formatByteSize(vbo->lastFrameSize()));
+    };
+    updateStreamingBuffer();
+    QTimer *streamingBufferTimer = new QTimer(this);
+    connect(streamingBufferTimer, &QTimer::timeout, this, updateStreamingBuffer);
+    streamingBufferTimer->start(500);
 }
 
 template <typename T>
@@ -669,6 +702,33 @@ QString stateActiveComponents(xkb_state *state, const T &count, std::function<in
     return text;
 }
 
+static QString filterName(const InputEventFilter *filter)
+{
+    const char *name = typeid(*filter).name();
+    int status = 0;
+    char *demangled = abi::__cxa_demangle(name, nullptr, nullptr, &status);
+    const QString text = QString::fromLatin1(status == 0 ? demangled : name);
+    free(demangled);
+    return text;
+}
+
+void DebugConsole::updateInputFiltersTab()
+{
+    QTreeWidget *view = m_ui->inputFiltersView;
+    view->clear();
+    const auto filters = input()->filters();
+    for (const InputEventFilter *filter : filters) {
+        const auto statistics = input()->filterStatistics(filter);
+        const double timePerCall = statistics.calls ? statistics.time / 1000.0 / statistics.calls : 0.0;
+        auto item = new QTreeWidgetItem(view);
+        item->setText(0, filterName(filter));
+        item->setText(1, filter->isActive() ? i18n("yes") : i18n("no"));
+        item->setText(2, QString::number(statistics.calls));
+        item->setText(3, i18nc("time in milliseconds", "%1 ms", QString::number(statistics.time / 1000000.0, 'f', 2)));
+        item->setText(4, i18nc("time in microseconds", "%1 µs", QString::number(timePerCall, 'f', 2)));
+    }
+}
+
 void DebugConsole::updateKeyboardTab()
 {
     auto xkb = input()->keyboard()->xkb();
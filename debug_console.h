@@ -30,6 +30,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <QVector>
 
 class QTextEdit;
+class QTimer;
 
 namespace Ui
 {
@@ -109,9 +110,11 @@ protected:
 private:
     void initGLTab();
     void updateKeyboardTab();
+    void updateInputFiltersTab();
 
     QScopedPointer<Ui::DebugConsole> m_ui;
     QScopedPointer<DebugConsoleFilter> m_inputFilter;
+    QTimer *m_inputFiltersTimer = nullptr;
 };
 
 class SurfaceTreeModel : public QAbstractItemModel
@@ -536,6 +536,15 @@ void EffectsHandlerImpl::startPaint()
     m_currentPaintEffectFrameIterator = m_activeEffects.constBegin();
 }
 
+bool EffectsHandlerImpl::blocksDirectScanout() const
+{
+    return std::any_of(loaded_effects.constBegin(), loaded_effects.constEnd(),
+        [] (const EffectPair &pair) {
+            return pair.second->isActive() && pair.second->blocksDirectScanout();
+        }
+    );
+}
+
 void EffectsHandlerImpl::slotClientMaximized(KWin::AbstractClient *c, MaximizeMode maxMode)
 {
     bool horizontal = false;
@@ -206,6 +206,11 @@ public:
 
     // internal (used by kwin core or compositing code)
     void startPaint();
+    /**
+     * @returns whether an active effect might change the look of a fullscreen window,
+     * so its buffer must not be presented without compositing
+     */
+    bool blocksDirectScanout() const;
     void grabbedKeyboardEvent(QKeyEvent* e);
     bool hasKeyboardGrab() const;
     void desktopResized(const QSize &size);
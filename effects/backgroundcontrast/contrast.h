@@ -64,6 +64,11 @@ public:
         return 76;
     }
 
+    bool blocksDirectScanout() const override {
+        // adjusts the backdrop of translucent panels and popups, an opaque fullscreen window has no backdrop
+        return false;
+    }
+
     bool eventFilter(QObject *watched, QEvent *event) override;
 
 public Q_SLOTS:
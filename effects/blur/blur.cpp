@@ -107,6 +107,7 @@ bool BlurEffect::renderTargetsValid() const
 
 void BlurEffect::deleteFBOs()
 {
+    m_blurCache.clear();
     qDeleteAll(m_renderTargets);
 
     m_renderTargets.clear();
@@ -335,6 +336,7 @@ void BlurEffect::slotWindowAdded(EffectWindow *w)
 
 void BlurEffect::slotWindowDeleted(EffectWindow *w)
 {
+    m_blurCache.remove(w);
     auto it = windowBlurChangedConnections.find(w);
     if (it == windowBlurChangedConnections.end()) {
         return;
@@ -499,6 +501,8 @@ void BlurEffect::prePaintWindow(EffectWindow* w, WindowPrePaintData& data, int t
     effects->prePaintWindow(w, data, time);
 
     if (!w->isPaintingEnabled()) {
+        // nothing to keep up to date while the window is hidden
+        m_blurCache.remove(w);
         return;
     }
     if (!m_shader || !m_shader->isValid()) {
@@ -528,6 +532,12 @@ void BlurEffect::prePaintWindow(EffectWindow* w, WindowPrePaintData& data, int t
     const QRegion blurArea = blurRegion(w).translated(w->pos()) & screen;
     const QRegion expandedBlur = (w->isDock() ? blurArea : expand(blurArea)) & screen;
 
+    // the cached blur is outdated where anything underneath changed
+    auto cache = m_blurCache.find(w);
+    if (cache != m_blurCache.end() && m_damagedArea.intersects(expandedBlur)) {
+        cache->validRegion -= expand(m_damagedArea & expandedBlur);
+    }
+
     // if this window or a window underneath the blurred area is painted again we have to
     // blur everything
     if (m_paintedArea.intersects(expandedBlur) || data.paint.intersects(blurArea)) {
@@ -607,7 +617,16 @@ void BlurEffect::drawWindow(EffectWindow *w, int mask, const QRegion &region, Wi
         }
 
         if (!shape.isEmpty()) {
-            doBlur(shape, screen, data.opacity(), data.screenProjectionMatrix(), w->isDock(), w->geometry());
+            // The cache holds what got painted to the framebuffer, that only matches
+            // if neither the window nor the screen is transformed.
+            const bool cacheable = !translated && !scaled &&
+                    !(mask & (PAINT_WINDOW_TRANSFORMED | PAINT_SCREEN_TRANSFORMED)) &&
+                    !GLRenderTarget::isRenderTargetBound();
+            if (cacheable) {
+                doCachedBlur(w, shape, screen, data.opacity(), data.screenProjectionMatrix());
+            } else {
+                doBlur(shape, screen, data.opacity(), data.screenProjectionMatrix(), w->isDock(), w->geometry());
+            }
         }
     }
 
@@ -735,6 +754,88 @@ void BlurEffect::doBlur(const QRegion& shape, const QRect& screen, const float o
     vbo->unbindArrays();
 }
 
+void BlurEffect::doCachedBlur(EffectWindow *w, const QRegion &shape, const QRect &screen, const float opacity, const QMatrix4x4 &screenProjection)
+{
+    const QRect rect = blurRegion(w).translated(w->pos()).boundingRect() & effects->virtualScreenGeometry();
+    const qreal scale = GLRenderTarget::virtualScreenScale();
+
+    BlurCache &cache = m_blurCache[w];
+    if (cache.rect != rect || cache.scale != scale) {
+        cache.texture = GLTexture(m_renderTextures.first().internalFormat(), rect.size() * scale);
+        cache.texture.setFilter(GL_NEAREST);
+        cache.texture.setWrapMode(GL_CLAMP_TO_EDGE);
+        cache.texture.setYInverted(false);
+        cache.renderTarget.reset(new GLRenderTarget(cache.texture));
+        cache.rect = rect;
+        cache.scale = scale;
+        cache.validRegion = QRegion();
+    }
+    if (!cache.renderTarget->valid()) {
+        m_blurCache.remove(w);
+        doBlur(shape, screen, opacity, screenProjection, w->isDock(), w->geometry());
+        return;
+    }
+    if (cache.geometry != w->geometry() || cache.opacity != opacity) {
+        cache.geometry = w->geometry();
+        cache.opacity = opacity;
+        cache.validRegion = QRegion();
+    }
+
+    const QRegion cached = shape & cache.validRegion;
+    QRegion missing = shape - cache.validRegion;
+    if (w->isDock() && !missing.isEmpty()) {
+        // the blur of docks is clamped to the painted shape, a part of it would look different
+        missing = shape;
+    }
+
+    if (!missing.isEmpty()) {
+        doBlur(missing, screen, opacity, screenProjection, w->isDock(), w->geometry());
+        for (const QRect &r : missing) {
+            cache.renderTarget->blitFromFramebuffer(r, QRect((r.topLeft() - rect.topLeft()) * scale, r.size() * scale));
+        }
+        cache.validRegion |= missing;
+    }
+
+    const QRegion reused = cached - missing;
+    if (reused.isEmpty()) {
+        return;
+    }
+
+    QVector<float> vertices;
+    QVector<float> texCoords;
+    vertices.reserve(reused.rectCount() * 12);
+    texCoords.reserve(reused.rectCount() * 12);
+    for (const QRect &r : reused) {
+        const float left = r.x();
+        const float top = r.y();
+        const float right = r.x() + r.width();
+        const float bottom = r.y() + r.height();
+        // the texture is not y-inverted, it was blitted from the framebuffer
+        const float u0 = (left - rect.x()) / rect.width();
+        const float u1 = (right - rect.x()) / rect.width();
+        const float v0 = 1.0 - (top - rect.y()) / rect.height();
+        const float v1 = 1.0 - (bottom - rect.y()) / rect.height();
+
+        vertices << right << top << left << top << left << bottom
+                 << left << bottom << right << bottom << right << top;
+        texCoords << u1 << v0 << u0 << v0 << u0 << v1
+                  << u0 << v1 << u1 << v1 << u1 << v0;
+    }
+
+    QMatrix4x4 mvp;
+    mvp.ortho(screen.x(), screen.x() + screen.width(), screen.y() + screen.height(), screen.y(), 0, 65535);
+
+    GLVertexBuffer *vbo = GLVertexBuffer::streamingBuffer();
+    vbo->reset();
+    vbo->setData(vertices.count() / 2, 2, vertices.constData(), texCoords.constData());
+
+    cache.texture.bind();
+    ShaderBinder binder(ShaderTrait::MapTexture);
+    binder.shader()->setUniform(GLShader::ModelViewProjectionMatrix, mvp);
+    vbo->render(GL_TRIANGLES);
+    cache.texture.unbind();
+}
+
 void BlurEffect::upscaleRenderToScreen(GLVertexBuffer *vbo, int vboStart, int blurRectCount, QMatrix4x4 screenProjection, QPoint windowPosition)
 {
     glActiveTexture(GL_TEXTURE0);
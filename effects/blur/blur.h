@@ -25,6 +25,8 @@
 #include <kwinglplatform.h>
 #include <kwinglutils.h>
 
+#include <QHash>
+#include <QSharedPointer>
 #include <QVector>
 #include <QVector2D>
 #include <QStack>
@@ -67,6 +69,11 @@ public:
         return 75;
     }
 
+    bool blocksDirectScanout() const override {
+        // the blur shows through translucent windows only, an opaque fullscreen window hides it
+        return false;
+    }
+
     bool eventFilter(QObject *watched, QEvent *event) override;
 
 public Q_SLOTS:
@@ -86,6 +93,7 @@ private:
     bool shouldBlur(const EffectWindow *w, int mask, const WindowPaintData &data) const;
     void updateBlurRegion(EffectWindow *w) const;
     void doBlur(const QRegion &shape, const QRect &screen, const float opacity, const QMatrix4x4 &screenProjection, bool isDock, QRect windowRect);
+    void doCachedBlur(EffectWindow *w, const QRegion &shape, const QRect &screen, const float opacity, const QMatrix4x4 &screenProjection);
     void uploadRegion(QVector2D *&map, const QRegion &region, const int downSampleIterations);
     void uploadGeometry(GLVertexBuffer *vbo, const QRegion &blurRegion, const QRegion &windowRegion);
     void generateNoiseTexture();
@@ -131,6 +139,22 @@ private:
     QVector <BlurValuesStruct> blurStrengthValues;
 
     QMap <EffectWindow*, QMetaObject::Connection> windowBlurChangedConnections;
+
+    /**
+     * The blurred background behind a window, as it got painted to the screen.
+     * It stays valid as long as nothing underneath the window changes.
+     */
+    struct BlurCache {
+        GLTexture texture;
+        QSharedPointer<GLRenderTarget> renderTarget;
+        QRect rect; // area covered by the texture
+        QRect geometry; // window geometry the blur was rendered for
+        qreal scale = 1.0;
+        float opacity = 1.0;
+        QRegion validRegion; // the part of rect holding the current blurred background
+    };
+
+    QHash <const EffectWindow*, BlurCache> m_blurCache;
     KWayland::Server::BlurManagerInterface *m_blurManager = nullptr;
 };
 
@@ -325,6 +325,9 @@ bool CubeEffect::loadShader()
         cylinderShader->setUniform("sampler", 0);
         QRect rect = effects->clientArea(FullArea, activeScreen, effects->currentDesktop());
         cylinderShader->setUniform("width", (float)rect.width() * 0.5f);
+        m_cylinderXCoordLocation = cylinderShader->uniformLocation("xCoord");
+        m_cylinderCubeAngleLocation = cylinderShader->uniformLocation("cubeAngle");
+        m_cylinderTimeLineLocation = cylinderShader->uniformLocation("timeLine");
     }
 
     sphereShader = ShaderManager::instance()->generateShaderFromResources(ShaderTrait::MapTexture | ShaderTrait::AdjustSaturation | ShaderTrait::Modulate, QStringLiteral("sphere.vert"), QString());
@@ -338,6 +341,9 @@ bool CubeEffect::loadShader()
         sphereShader->setUniform("width", (float)rect.width() * 0.5f);
         sphereShader->setUniform("height", (float)rect.height() * 0.5f);
         sphereShader->setUniform("u_offset", QVector2D(0, 0));
+        m_sphereOffsetLocation = sphereShader->uniformLocation("u_offset");
+        m_sphereCubeAngleLocation = sphereShader->uniformLocation("cubeAngle");
+        m_sphereTimeLineLocation = sphereShader->uniformLocation("timeLine");
     }
     return true;
 }
@@ -1217,28 +1223,28 @@ void CubeEffect::paintWindow(EffectWindow* w, int mask, QRegion region, WindowPa
         GLShader *currentShader = nullptr;
         if (mode == Cylinder) {
             shaderManager->pushShader(cylinderShader);
-            cylinderShader->setUniform("xCoord", (float)w->x());
-            cylinderShader->setUniform("cubeAngle", (effects->numberOfDesktops() - 2) / (float)effects->numberOfDesktops() * 90.0f);
+            cylinderShader->setUniform(m_cylinderXCoordLocation, (float)w->x());
+            cylinderShader->setUniform(m_cylinderCubeAngleLocation, (effects->numberOfDesktops() - 2) / (float)effects->numberOfDesktops() * 90.0f);
             float factor = 0.0f;
             if (animationState == AnimationState::Start) {
                 factor = 1.0f - timeLine.value();
             } else if (animationState == AnimationState::Stop) {
                 factor = timeLine.value();
             }
-            cylinderShader->setUniform("timeLine", factor);
+            cylinderShader->setUniform(m_cylinderTimeLineLocation, factor);
             currentShader = cylinderShader;
         }
         if (mode == Sphere) {
             shaderManager->pushShader(sphereShader);
-            sphereShader->setUniform("u_offset", QVector2D(w->x(), w->y()));
-            sphereShader->setUniform("cubeAngle", (effects->numberOfDesktops() - 2) / (float)effects->numberOfDesktops() * 90.0f);
+            sphereShader->setUniform(m_sphereOffsetLocation, QVector2D(w->x(), w->y()));
+            sphereShader->setUniform(m_sphereCubeAngleLocation, (effects->numberOfDesktops() - 2) / (float)effects->numberOfDesktops() * 90.0f);
             float factor = 0.0f;
             if (animationState == AnimationState::Start) {
                 factor = 1.0f - timeLine.value();
             } else if (animationState == AnimationState::Stop) {
                 factor = timeLine.value();
             }
-            sphereShader->setUniform("timeLine", factor);
+            sphereShader->setUniform(m_sphereTimeLineLocation, factor);
             currentShader = sphereShader;
         }
         if (currentShader) {
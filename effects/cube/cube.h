@@ -228,6 +228,13 @@ private:
     bool useShaders;
     GLShader* cylinderShader;
     GLShader* sphereShader;
+    // uniform locations for the per window paint, resolved when the shaders are loaded
+    int m_cylinderXCoordLocation = -1;
+    int m_cylinderCubeAngleLocation = -1;
+    int m_cylinderTimeLineLocation = -1;
+    int m_sphereOffsetLocation = -1;
+    int m_sphereCubeAngleLocation = -1;
+    int m_sphereTimeLineLocation = -1;
     GLShader* m_reflectionShader;
     GLShader* m_capShader;
     float capDeformationFactor;
@@ -30,11 +30,13 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <QVarLengthArray>
 #include <QPainter>
 #include <QMatrix4x4>
+#include <QTimer>
 #include <xcb/xcb_image.h>
 
 #include <KLocalizedString>
 #include <KNotification>
 
+#include <cstring>
 #include <unistd.h>
 
 namespace KWin
@@ -59,14 +61,98 @@ bool ScreenShotEffect::supported()
 
 ScreenShotEffect::ScreenShotEffect()
     : m_scheduledScreenshot(nullptr)
+    , m_readbackTimer(new QTimer(this))
 {
     connect(effects, &EffectsHandler::windowClosed, this, &ScreenShotEffect::windowClosed);
+    // The fences of pending readbacks are checked after every painted frame, the timer
+    // only covers a screen which doesn't repaint meanwhile
+    m_readbackTimer->setInterval(16);
+    connect(m_readbackTimer, &QTimer::timeout, this, &ScreenShotEffect::checkReadbacks);
+    connect(&m_readbackWatcher, &QFutureWatcher<QString>::finished, this, &ScreenShotEffect::readbackFinished);
     QDBusConnection::sessionBus().registerObject(QStringLiteral("/Screenshot"), this, QDBusConnection::ExportScriptableContents);
 }
 
 ScreenShotEffect::~ScreenShotEffect()
 {
     QDBusConnection::sessionBus().unregisterObject(QStringLiteral("/Screenshot"));
+    // the worker reads from the mapped buffers
+    m_readbackWatcher.waitForFinished();
+    releaseReadbacks();
+}
+
+static void writeImageToFd(int fd, const QImage &img)
+{
+    QFile file;
+    if (file.open(fd, QIODevice::WriteOnly, QFileDevice::AutoCloseHandle)) {
+        QDataStream ds(&file);
+        ds << img;
+        file.close();
+    } else {
+        close(fd);
+    }
+}
+
+static QString writeTempImage(const QImage &img)
+{
+    if (img.isNull()) {
+        return QString();
+    }
+    QTemporaryFile temp(QDir::tempPath() + QDir::separator() + QLatin1String("kwin_screenshot_XXXXXX.png"));
+    temp.setAutoRemove(false);
+    if (!temp.open()) {
+        return QString();
+    }
+    img.save(&temp);
+    temp.close();
+    return temp.fileName();
+}
+
+static void notifyImageSaved(const QString &fileName)
+{
+    KNotification::event(KNotification::Notification,
+                        i18nc("Notification caption that a screenshot got saved to file", "Screenshot"),
+                        i18nc("Notification with path to screenshot file", "Screenshot saved to %1", fileName),
+                        QStringLiteral("spectacle"));
+}
+
+static void convertFromGLRow(const uint *src, uint *dst, int width)
+{
+    // from QtOpenGL/qgl.cpp
+    // Copyright (C) 2010 Nokia Corporation and/or its subsidiary(-ies)
+    // see https://github.com/qt/qtbase/blob/dev/src/opengl/qgl.cpp
+    if (QSysInfo::ByteOrder == QSysInfo::BigEndian) {
+        // OpenGL gives RGBA; Qt wants ARGB
+        for (int x = 0; x < width; ++x) {
+            const uint pixel = src[x];
+            dst[x] = (pixel >> 8) | (pixel << 24);
+        }
+    } else {
+        // OpenGL gives ABGR (i.e. RGBA backwards); Qt wants ARGB
+        for (int x = 0; x < width; ++x) {
+            const uint pixel = src[x];
+            dst[x] = ((pixel << 16) & 0xff0000) | ((pixel >> 16) & 0xff)
+                     | (pixel & 0xff00ff00);
+        }
+    }
+}
+
+static QImage imageFromReadback(const uchar *data, const QSize &size, bool bgra)
+{
+    if (!data) {
+        return QImage();
+    }
+    QImage img(size, QImage::Format_ARGB32);
+    const size_t rowSize = size_t(size.width()) * 4;
+    for (int y = 0; y < size.height(); ++y) {
+        // OpenGL stores the rows bottom to top
+        const uchar *src = data + (size.height() - 1 - y) * rowSize;
+        if (bgra) {
+            memcpy(img.scanLine(y), src, rowSize);
+        } else {
+            convertFromGLRow(reinterpret_cast<const uint *>(src), reinterpret_cast<uint *>(img.scanLine(y)), size.width());
+        }
+    }
+    return img;
 }
 
 #ifdef KWIN_HAVE_XRENDER_COMPOSITING
@@ -165,6 +251,9 @@ void ScreenShotEffect::paintScreen(int mask, const QRegion &region, ScreenPaintD
 void ScreenShotEffect::postPaintScreen()
 {
     effects->postPaintScreen();
+    if (m_readbackTimer->isActive()) {
+        checkReadbacks();
+    }
     if (m_scheduledScreenshot) {
         WindowPaintData d(m_scheduledScreenshot);
         double left = 0;
@@ -256,17 +345,7 @@ void ScreenShotEffect::postPaintScreen()
             } else if (m_windowMode == WindowMode::File) {
                 sendReplyImage(img);
             } else if (m_windowMode == WindowMode::FileDescriptor) {
-                QtConcurrent::run(
-                    [] (int fd, const QImage &img) {
-                        QFile file;
-                        if (file.open(fd, QIODevice::WriteOnly, QFileDevice::AutoCloseHandle)) {
-                            QDataStream ds(&file);
-                            ds << img;
-                            file.close();
-                        } else {
-                            close(fd);
-                        }
-                    }, m_fd, img);
+                QtConcurrent::run(writeImageToFd, m_fd, img);
                 m_windowMode = WindowMode::NoCapture;
                 m_fd = -1;
             }
@@ -287,6 +366,10 @@ void ScreenShotEffect::postPaintScreen()
                 // doesn't intersect, not going onto this screenshot
                 return;
             }
+            if (supportsAsyncReadback()) {
+                startReadback(intersection);
+                return;
+            }
             const QImage img = blitScreenshot(intersection);
             if (img.size() == m_scheduledGeometry.size()) {
                 // we are done
@@ -306,6 +389,8 @@ void ScreenShotEffect::postPaintScreen()
                 sendReplyImage(m_multipleOutputsImage);
             }
 
+        } else if (supportsAsyncReadback()) {
+            startReadback(m_scheduledGeometry);
         } else {
             const QImage img = blitScreenshot(m_scheduledGeometry);
             sendReplyImage(img);
@@ -316,20 +401,23 @@ void ScreenShotEffect::postPaintScreen()
 void ScreenShotEffect::sendReplyImage(const QImage &img)
 {
     if (m_fd != -1) {
-        QtConcurrent::run(
-            [] (int fd, const QImage &img) {
-                QFile file;
-                if (file.open(fd, QIODevice::WriteOnly, QFileDevice::AutoCloseHandle)) {
-                    QDataStream ds(&file);
-                    ds << img;
-                    file.close();
-                } else {
-                    close(fd);
-                }
-            }, m_fd, img);
+        QtConcurrent::run(writeImageToFd, m_fd, img);
+        sendReplyFile(QString());
+    } else {
+        sendReplyFile(writeTempImage(img));
+    }
+}
+
+void ScreenShotEffect::sendReplyFile(const QString &fileName)
+{
+    if (m_fd != -1) {
+        // the image is written into the file descriptor, which takes care of closing it
         m_fd = -1;
     } else {
-        QDBusConnection::sessionBus().send(m_replyMessage.createReply(saveTempImage(img)));
+        if (!fileName.isEmpty()) {
+            notifyImageSaved(fileName);
+        }
+        QDBusConnection::sessionBus().send(m_replyMessage.createReply(fileName));
     }
     m_scheduledGeometry = QRect();
     m_multipleOutputsImage = QImage();
@@ -338,23 +426,133 @@ void ScreenShotEffect::sendReplyImage(const QImage &img)
     m_windowMode = WindowMode::NoCapture;
 }
 
-QString ScreenShotEffect::saveTempImage(const QImage &img)
+bool ScreenShotEffect::supportsAsyncReadback()
 {
-    if (img.isNull()) {
-        return QString();
+    if (!effects->isOpenGLCompositing() || !GLRenderTarget::blitSupported()) {
+        return false;
     }
-    QTemporaryFile temp(QDir::tempPath() + QDir::separator() + QLatin1String("kwin_screenshot_XXXXXX.png"));
-    temp.setAutoRemove(false);
-    if (!temp.open()) {
-        return QString();
+    if (GLPlatform::instance()->isGLES()) {
+        return hasGLVersion(3, 0);
     }
-    img.save(&temp);
-    temp.close();
-    KNotification::event(KNotification::Notification,
-                        i18nc("Notification caption that a screenshot got saved to file", "Screenshot"),
-                        i18nc("Notification with path to screenshot file", "Screenshot saved to %1", temp.fileName()),
-                        QStringLiteral("spectacle"));
-    return temp.fileName();
+    return hasGLVersion(3, 2) || (hasGLVersion(3, 0) && hasGLExtension(QByteArrayLiteral("GL_ARB_sync")));
+}
+
+void ScreenShotEffect::startReadback(const QRect &geometry)
+{
+    if ((QRegion(geometry) - m_multipleOutputsRendered).isEmpty()) {
+        // already read back, waiting for the GPU to finish
+        return;
+    }
+
+    Readback readback;
+    readback.geometry = geometry;
+    // let the GPU convert into the layout of QImage::Format_ARGB32 where possible
+    if (QSysInfo::ByteOrder == QSysInfo::LittleEndian) {
+        readback.bgra = !GLPlatform::instance()->isGLES() ||
+                        hasGLExtension(QByteArrayLiteral("GL_EXT_read_format_bgra"));
+    }
+
+    GLTexture tex(GL_RGBA8, geometry.width(), geometry.height());
+    GLRenderTarget target(tex);
+    target.blitFromFramebuffer(geometry);
+
+    glGenBuffers(1, &readback.buffer);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.buffer);
+    glBufferData(GL_PIXEL_PACK_BUFFER, GLsizeiptr(geometry.width()) * geometry.height() * 4, nullptr, GL_STREAM_READ);
+    // with a pack buffer bound the pixels are copied asynchronously
+    GLRenderTarget::pushRenderTarget(&target);
+    glReadPixels(0, 0, geometry.width(), geometry.height(), readback.bgra ? GL_BGRA : GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    GLRenderTarget::popRenderTarget();
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    readback.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+    m_readbacks << readback;
+    m_multipleOutputsRendered = m_multipleOutputsRendered.united(geometry);
+    if (m_multipleOutputsRendered.boundingRect() == m_scheduledGeometry) {
+        m_readbackTimer->start();
+    }
+}
+
+void ScreenShotEffect::checkReadbacks()
+{
+    effects->makeOpenGLContextCurrent();
+    for (const Readback &readback : qAsConst(m_readbacks)) {
+        if (glClientWaitSync(readback.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0) == GL_TIMEOUT_EXPIRED) {
+            return;
+        }
+    }
+    m_readbackTimer->stop();
+
+    for (Readback &readback : m_readbacks) {
+        glDeleteSync(readback.fence);
+        readback.fence = nullptr;
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.buffer);
+        readback.data = static_cast<const uchar *>(glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0,
+            GLsizeiptr(readback.geometry.width()) * readback.geometry.height() * 4, GL_MAP_READ_BIT));
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    QImage cursorImage;
+    QPoint cursorPos;
+    if (m_captureCursor) {
+        const auto cursor = effects->cursorImage();
+        cursorImage = cursor.image();
+        cursorPos = effects->cursorPos() - cursor.hotSpot() - m_scheduledGeometry.topLeft();
+    }
+
+    // The buffers stay mapped until the worker is done, converting and encoding the
+    // image doesn't block the compositor
+    m_readbackWatcher.setFuture(QtConcurrent::run(
+        [readbacks = m_readbacks, geometry = m_scheduledGeometry, cursorImage, cursorPos, fd = m_fd] {
+            QImage img;
+            if (readbacks.count() == 1 && readbacks.first().geometry == geometry) {
+                const Readback &readback = readbacks.first();
+                img = imageFromReadback(readback.data, geometry.size(), readback.bgra);
+            } else {
+                img = QImage(geometry.size(), QImage::Format_ARGB32);
+                img.fill(Qt::transparent);
+                QPainter p(&img);
+                for (const Readback &readback : readbacks) {
+                    p.drawImage(readback.geometry.topLeft() - geometry.topLeft(),
+                                imageFromReadback(readback.data, readback.geometry.size(), readback.bgra));
+                }
+            }
+            if (!img.isNull() && !cursorImage.isNull()) {
+                QPainter p(&img);
+                p.drawImage(cursorPos, cursorImage);
+            }
+            if (fd != -1) {
+                writeImageToFd(fd, img);
+                return QString();
+            }
+            return writeTempImage(img);
+        }));
+}
+
+void ScreenShotEffect::readbackFinished()
+{
+    releaseReadbacks();
+    sendReplyFile(m_readbackWatcher.result());
+}
+
+void ScreenShotEffect::releaseReadbacks()
+{
+    if (m_readbacks.isEmpty()) {
+        return;
+    }
+    effects->makeOpenGLContextCurrent();
+    for (const Readback &readback : qAsConst(m_readbacks)) {
+        if (readback.fence) {
+            glDeleteSync(readback.fence);
+        }
+        if (readback.data) {
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.buffer);
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        }
+        glDeleteBuffers(1, &readback.buffer);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    m_readbacks.clear();
 }
 
 void ScreenShotEffect::screenshotWindowUnderCursor(int mask)
@@ -653,31 +851,9 @@ void ScreenShotEffect::grabPointerImage(QImage& snapshot, int offsetx, int offse
 
 void ScreenShotEffect::convertFromGLImage(QImage &img, int w, int h)
 {
-    // from QtOpenGL/qgl.cpp
-    // Copyright (C) 2010 Nokia Corporation and/or its subsidiary(-ies)
-    // see https://github.com/qt/qtbase/blob/dev/src/opengl/qgl.cpp
-    if (QSysInfo::ByteOrder == QSysInfo::BigEndian) {
-        // OpenGL gives RGBA; Qt wants ARGB
-        uint *p = (uint*)img.bits();
-        uint *end = p + w * h;
-        while (p < end) {
-            uint a = *p << 24;
-            *p = (*p >> 8) | a;
-            p++;
-        }
-    } else {
-        // OpenGL gives ABGR (i.e. RGBA backwards); Qt wants ARGB
-        for (int y = 0; y < h; y++) {
-            uint *q = (uint*)img.scanLine(y);
-            for (int x = 0; x < w; ++x) {
-                const uint pixel = *q;
-                *q = ((pixel << 16) & 0xff0000) | ((pixel >> 16) & 0xff)
-                     | (pixel & 0xff00ff00);
-
-                q++;
-            }
-        }
-
+    for (int y = 0; y < h; y++) {
+        uint *q = reinterpret_cast<uint *>(img.scanLine(y));
+        convertFromGLRow(q, q, w);
     }
     img = img.mirrored();
 }
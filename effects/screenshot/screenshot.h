@@ -26,9 +26,14 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <QDBusConnection>
 #include <QDBusMessage>
 #include <QDBusUnixFileDescriptor>
+#include <QFutureWatcher>
 #include <QObject>
 #include <QImage>
 
+#include <epoxy/gl.h>
+
+class QTimer;
+
 namespace KWin
 {
 
@@ -142,8 +147,23 @@ private Q_SLOTS:
 private:
     void grabPointerImage(QImage& snapshot, int offsetx, int offsety);
     QImage blitScreenshot(const QRect &geometry);
-    QString saveTempImage(const QImage &img);
     void sendReplyImage(const QImage &img);
+    void sendReplyFile(const QString &fileName);
+    /**
+     * Area of the screen being read back into a pixel buffer object.
+     */
+    struct Readback {
+        QRect geometry;
+        GLuint buffer = 0;
+        GLsync fence = nullptr;
+        bool bgra = false;
+        const uchar *data = nullptr;
+    };
+    static bool supportsAsyncReadback();
+    void startReadback(const QRect &geometry);
+    void checkReadbacks();
+    void releaseReadbacks();
+    void readbackFinished();
     enum class InfoMessageMode {
         Window,
         Screen
@@ -167,6 +187,9 @@ private:
     };
     WindowMode m_windowMode = WindowMode::NoCapture;
     int m_fd = -1;
+    QVector<Readback> m_readbacks;
+    QTimer *m_readbackTimer;
+    QFutureWatcher<QString> m_readbackWatcher;
 };
 
 } // namespace
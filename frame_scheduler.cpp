@@ -0,0 +1,121 @@
+/********************************************************************
+ KWin - the KDE window manager
+ This file is part of the KDE project.
+
+Copyright (C) 2020 The KWin developers <kwin@kde.org>
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*********************************************************************/
+#include "frame_scheduler.h"
+
+#include <algorithm>
+
+namespace KWin
+{
+
+FrameScheduler::FrameScheduler()
+{
+    reset();
+}
+
+void FrameScheduler::reset()
+{
+    m_renderTimes.fill(0);
+    m_renderTimeIndex = 0;
+    m_renderTimesRecorded = 0;
+    m_lastVBlank = -1;
+    m_targetVBlank = -1;
+    m_missPadding = 0;
+}
+
+void FrameScheduler::setRefreshInterval(qint64 interval)
+{
+    m_refreshInterval = interval;
+}
+
+void FrameScheduler::setSafetyMargin(qint64 margin)
+{
+    m_safetyMargin = qMax(margin, qint64(0));
+}
+
+void FrameScheduler::addRenderTime(qint64 renderTime)
+{
+    m_renderTimes[m_renderTimeIndex] = renderTime;
+    m_renderTimeIndex = (m_renderTimeIndex + 1) % s_renderTimeCount;
+    m_renderTimesRecorded = qMin(m_renderTimesRecorded + 1, int(s_renderTimeCount));
+}
+
+qint64 FrameScheduler::predictedRenderTime() const
+{
+    if (m_renderTimesRecorded == 0) {
+        // nothing known yet, assume the worst
+        return m_refreshInterval;
+    }
+    // The maximum reacts to a spike immediately and forgets it once it left the history,
+    // a mean would let every expensive frame after a series of cheap ones miss its vblank.
+    return *std::max_element(m_renderTimes.begin(), m_renderTimes.begin() + m_renderTimesRecorded);
+}
+
+qint64 FrameScheduler::leadTime() const
+{
+    return predictedRenderTime() + m_safetyMargin + m_missPadding;
+}
+
+qint64 FrameScheduler::targetVBlank(qint64 startTime) const
+{
+    const qint64 elapsed = startTime + leadTime() - m_lastVBlank;
+    const qint64 cycles = elapsed <= 0 ? 0 : (elapsed + m_refreshInterval - 1) / m_refreshInterval;
+    return m_lastVBlank + cycles * m_refreshInterval;
+}
+
+qint64 FrameScheduler::nextRenderStart(qint64 now) const
+{
+    if (!hasVBlank() || m_refreshInterval <= 0) {
+        return now;
+    }
+    const qint64 lead = leadTime();
+    if (lead >= m_refreshInterval) {
+        // there is nothing to gain by waiting, every frame takes more than one refresh cycle
+        return now;
+    }
+    return qMax(now, targetVBlank(now) - lead);
+}
+
+void FrameScheduler::frameSubmitted(qint64 startTime)
+{
+    if (!hasVBlank() || m_refreshInterval <= 0) {
+        m_targetVBlank = -1;
+        return;
+    }
+    m_targetVBlank = targetVBlank(startTime);
+}
+
+void FrameScheduler::notifyVBlank(qint64 timestamp)
+{
+    if (m_targetVBlank >= 0 && m_refreshInterval > 0) {
+        const qint64 tolerance = m_refreshInterval / 2;
+        if (timestamp > m_targetVBlank + tolerance) {
+            // The frame was presented late, start the following ones earlier.
+            m_missPadding = qMin(m_missPadding + m_refreshInterval / 8, m_refreshInterval);
+            m_targetVBlank = -1;
+        } else if (timestamp >= m_targetVBlank - tolerance) {
+            m_missPadding -= m_missPadding / 16;
+            m_targetVBlank = -1;
+        }
+        // else it's the vblank of an earlier frame, keep waiting for the frame
+    }
+    m_lastVBlank = timestamp;
+}
+
+}
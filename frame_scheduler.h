@@ -0,0 +1,118 @@
+/********************************************************************
+ KWin - the KDE window manager
+ This file is part of the KDE project.
+
+Copyright (C) 2020 The KWin developers <kwin@kde.org>
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*********************************************************************/
+#ifndef KWIN_FRAME_SCHEDULER_H
+#define KWIN_FRAME_SCHEDULER_H
+
+#include <kwin_export.h>
+
+#include <QtGlobal>
+
+#include <array>
+
+namespace KWin
+{
+
+/**
+ * @short Predicts when the compositor has to start a frame to make the next vblank.
+ *
+ * The scheduler keeps the render times of the last frames and the timestamp of the last
+ * vblank reported by the platform. From those it computes the latest point in time at which
+ * a new frame can be started and still be presented with the earliest reachable vblank.
+ *
+ * Frames which still miss their vblank increase the lead time, it decays again while the
+ * frames are on time.
+ *
+ * All times are in nanoseconds on the CLOCK_MONOTONIC time base.
+ */
+class KWIN_EXPORT FrameScheduler
+{
+public:
+    FrameScheduler();
+
+    /**
+     * Forgets the render times and the last vblank, e.g. after the outputs changed.
+     */
+    void reset();
+
+    void setRefreshInterval(qint64 interval);
+    qint64 refreshInterval() const {
+        return m_refreshInterval;
+    }
+
+    /**
+     * Time reserved between the predicted end of the rendering and the vblank.
+     */
+    void setSafetyMargin(qint64 margin);
+    qint64 safetyMargin() const {
+        return m_safetyMargin;
+    }
+
+    /**
+     * Records how long painting a frame took.
+     */
+    void addRenderTime(qint64 renderTime);
+    /**
+     * The render time expected for the next frame. That is the longest of the recently
+     * recorded render times, or a full refresh interval if none have been recorded yet.
+     */
+    qint64 predictedRenderTime() const;
+
+    /**
+     * Records a vblank at @p timestamp, usually the time a page flip completed.
+     */
+    void notifyVBlank(qint64 timestamp);
+    bool hasVBlank() const {
+        return m_lastVBlank >= 0;
+    }
+    qint64 lastVBlank() const {
+        return m_lastVBlank;
+    }
+
+    /**
+     * Returns the latest point in time at which a frame started at @p now or later can be
+     * started to make the earliest vblank it can reach. Returns @p now if no vblank is known
+     * or a frame takes longer than a refresh interval.
+     */
+    qint64 nextRenderStart(qint64 now) const;
+    /**
+     * Tells the scheduler that a frame started at @p startTime got submitted. The next
+     * vblank notification checks whether the frame made the vblank it was scheduled for.
+     */
+    void frameSubmitted(qint64 startTime);
+
+private:
+    qint64 leadTime() const;
+    qint64 targetVBlank(qint64 startTime) const;
+
+    static const int s_renderTimeCount = 32;
+    std::array<qint64, s_renderTimeCount> m_renderTimes;
+    int m_renderTimeIndex = 0;
+    int m_renderTimesRecorded = 0;
+
+    qint64 m_refreshInterval = 0;
+    qint64 m_safetyMargin = 0;
+    qint64 m_lastVBlank = -1;
+    qint64 m_targetVBlank = -1;
+    qint64 m_missPadding = 0;
+};
+
+}
+
+#endif
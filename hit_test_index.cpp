@@ -0,0 +1,236 @@
+/********************************************************************
+ KWin - the KDE window manager
+ This file is part of the KDE project.
+
+Copyright (C) 2020 The KWin developers <kwin@kde.org>
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*********************************************************************/
+#include "hit_test_index.h"
+#include "toplevel.h"
+
+#include <algorithm>
+
+namespace KWin
+{
+
+static const int s_cellSize = 256;
+// Windows spanning more cells than this are not worth putting into the grid
+static const int s_maxCellsPerWindow = 256;
+
+static int cellIndex(int coordinate)
+{
+    // round towards negative infinity, windows may be placed left of or above the origin
+    return coordinate >= 0 ? coordinate / s_cellSize : -((-coordinate - 1) / s_cellSize) - 1;
+}
+
+static quint64 cellKey(int column, int row)
+{
+    return (quint64(quint32(column)) << 32) | quint32(row);
+}
+
+template <typename Function>
+static void forEachCell(const QRect &rect, Function function)
+{
+    const int firstColumn = cellIndex(rect.left());
+    const int lastColumn = cellIndex(rect.right());
+    const int firstRow = cellIndex(rect.top());
+    const int lastRow = cellIndex(rect.bottom());
+    for (int row = firstRow; row <= lastRow; ++row) {
+        for (int column = firstColumn; column <= lastColumn; ++column) {
+            function(cellKey(column, row));
+        }
+    }
+}
+
+static bool isLarge(const QRect &rect)
+{
+    const qint64 columns = cellIndex(rect.right()) - cellIndex(rect.left()) + 1;
+    const qint64 rows = cellIndex(rect.bottom()) - cellIndex(rect.top()) + 1;
+    return columns * rows > s_maxCellsPerWindow;
+}
+
+template <typename Entry>
+static void insertSorted(QVector<Entry> &entries, const Entry &entry)
+{
+    auto it = std::lower_bound(entries.begin(), entries.end(), entry,
+        [] (const Entry &a, const Entry &b) {
+            return a.position < b.position;
+        }
+    );
+    entries.insert(it, entry);
+}
+
+template <typename Entry>
+static void removeWindow(QVector<Entry> &entries, Toplevel *window)
+{
+    entries.erase(std::remove_if(entries.begin(), entries.end(),
+        [window] (const Entry &entry) {
+            return entry.window == window;
+        }), entries.end());
+}
+
+HitTestIndex::HitTestIndex(QObject *parent)
+    : QObject(parent)
+{
+}
+
+HitTestIndex::~HitTestIndex() = default;
+
+void HitTestIndex::invalidate()
+{
+    m_valid = false;
+}
+
+void HitTestIndex::rebuild(const QList<Toplevel *> &windows)
+{
+    QHash<Toplevel *, Item> items;
+    items.reserve(windows.count());
+    for (int i = 0; i < windows.count(); ++i) {
+        Toplevel *window = windows.at(i);
+        if (window->isDeleted() || items.contains(window)) {
+            // a deleted window doesn't get input events
+            continue;
+        }
+        items.insert(window, Item{i, window->inputGeometry()});
+        if (!m_items.contains(window)) {
+            watch(window);
+        }
+    }
+    for (auto it = m_items.constBegin(); it != m_items.constEnd(); ++it) {
+        if (!items.contains(it.key())) {
+            disconnect(it.key(), nullptr, this, nullptr);
+        }
+    }
+    m_items = items;
+    m_windows = windows;
+    m_valid = true;
+
+    // The positions changed, filling the grid in stacking order appends to every cell
+    m_cells.clear();
+    m_large.clear();
+    for (int i = 0; i < windows.count(); ++i) {
+        auto it = m_items.constFind(windows.at(i));
+        if (it != m_items.constEnd() && it->position == i) {
+            insert(it.key(), *it);
+        }
+    }
+}
+
+void HitTestIndex::watch(Toplevel *window)
+{
+    connect(window, &Toplevel::geometryShapeChanged, this, [this, window] { updateGeometry(window); });
+    connect(window, &Toplevel::frameGeometryChanged, this, [this, window] { updateGeometry(window); });
+    connect(window, &Toplevel::inputGeometryChanged, this, [this, window] { updateGeometry(window); });
+    connect(window, &QObject::destroyed, this, [this, window] { handleWindowDestroyed(window); });
+}
+
+void HitTestIndex::update(const QList<Toplevel *> &windows)
+{
+    if (m_valid && m_windows == windows) {
+        // share the list again, so the next comparison doesn't need to look at the elements
+        m_windows = windows;
+        return;
+    }
+    rebuild(windows);
+}
+
+void HitTestIndex::insert(Toplevel *window, const Item &item)
+{
+    if (item.rect.isEmpty()) {
+        return;
+    }
+    const Entry entry{item.position, window};
+    if (isLarge(item.rect)) {
+        insertSorted(m_large, entry);
+        return;
+    }
+    forEachCell(item.rect, [this, &entry] (quint64 key) {
+        insertSorted(m_cells[key], entry);
+    });
+}
+
+void HitTestIndex::remove(Toplevel *window, const Item &item)
+{
+    if (item.rect.isEmpty()) {
+        return;
+    }
+    if (isLarge(item.rect)) {
+        removeWindow(m_large, window);
+        return;
+    }
+    forEachCell(item.rect, [this, window] (quint64 key) {
+        auto it = m_cells.find(key);
+        if (it == m_cells.end()) {
+            return;
+        }
+        removeWindow(*it, window);
+        if (it->isEmpty()) {
+            m_cells.erase(it);
+        }
+    });
+}
+
+void HitTestIndex::updateGeometry(Toplevel *window)
+{
+    auto it = m_items.find(window);
+    if (it == m_items.end()) {
+        return;
+    }
+    const QRect rect = window->inputGeometry();
+    if (it->rect == rect) {
+        return;
+    }
+    remove(window, *it);
+    it->rect = rect;
+    insert(window, *it);
+}
+
+void HitTestIndex::handleWindowDestroyed(Toplevel *window)
+{
+    // only the pointer is used, the window is already gone
+    auto it = m_items.find(window);
+    if (it == m_items.end()) {
+        return;
+    }
+    remove(window, *it);
+    m_items.erase(it);
+    invalidate();
+}
+
+Toplevel *HitTestIndex::findTopmost(const QPoint &pos, const std::function<bool(Toplevel *)> &accept) const
+{
+    static const QVector<Entry> s_noEntries;
+    auto cellIt = m_cells.constFind(cellKey(cellIndex(pos.x()), cellIndex(pos.y())));
+    const QVector<Entry> &cell = cellIt != m_cells.constEnd() ? *cellIt : s_noEntries;
+
+    // Merge the cell and the large windows, both are sorted by stacking position
+    auto cellEntry = cell.crbegin();
+    auto largeEntry = m_large.crbegin();
+    while (cellEntry != cell.crend() || largeEntry != m_large.crend()) {
+        const Entry *entry;
+        if (largeEntry == m_large.crend() ||
+                (cellEntry != cell.crend() && cellEntry->position > largeEntry->position)) {
+            entry = &(*cellEntry++);
+        } else {
+            entry = &(*largeEntry++);
+        }
+        if (entry->window->inputGeometry().contains(pos) && accept(entry->window)) {
+            return entry->window;
+        }
+    }
+    return nullptr;
+}
+
+}
@@ -0,0 +1,112 @@
+/********************************************************************
+ KWin - the KDE window manager
+ This file is part of the KDE project.
+
+Copyright (C) 2020 The KWin developers <kwin@kde.org>
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*********************************************************************/
+#ifndef KWIN_HIT_TEST_INDEX_H
+#define KWIN_HIT_TEST_INDEX_H
+
+#include <kwin_export.h>
+
+#include <QHash>
+#include <QList>
+#include <QObject>
+#include <QRect>
+#include <QVector>
+
+#include <functional>
+
+namespace KWin
+{
+
+class Toplevel;
+
+/**
+ * @short Grid over the input geometry of a list of windows.
+ *
+ * The index is used to find the window at a position without walking the whole
+ * stacking order. Every window is stored in the grid cells its input geometry
+ * intersects, tagged with its position in the list it was built from. Windows
+ * later in the list are above windows earlier in the list.
+ *
+ * Input geometry changes of the indexed windows are applied incrementally. Changes of
+ * the list itself require a call to update() or rebuild(), which keep watching the
+ * windows that stay in the list and only fill the grid again.
+ */
+class KWIN_EXPORT HitTestIndex : public QObject
+{
+    Q_OBJECT
+public:
+    explicit HitTestIndex(QObject *parent = nullptr);
+    ~HitTestIndex() override;
+
+    /**
+     * Indexes @p windows, the last window is the topmost one.
+     */
+    void rebuild(const QList<Toplevel *> &windows);
+    /**
+     * Rebuilds the index if it is not valid or @p windows differs from the indexed list.
+     */
+    void update(const QList<Toplevel *> &windows);
+    /**
+     * Marks the index as outdated, isValid() returns @c false until the next rebuild().
+     */
+    void invalidate();
+    bool isValid() const {
+        return m_valid;
+    }
+    /**
+     * @returns the list the index was built from
+     */
+    const QList<Toplevel *> &windows() const {
+        return m_windows;
+    }
+
+    /**
+     * Finds the topmost window whose input geometry contains @p pos and which is
+     * accepted by @p accept.
+     */
+    Toplevel *findTopmost(const QPoint &pos, const std::function<bool(Toplevel *)> &accept) const;
+
+private:
+    struct Entry {
+        int position;
+        Toplevel *window;
+    };
+    struct Item {
+        int position;
+        QRect rect;
+    };
+    void insert(Toplevel *window, const Item &item);
+    void remove(Toplevel *window, const Item &item);
+    void updateGeometry(Toplevel *window);
+    void handleWindowDestroyed(Toplevel *window);
+    void watch(Toplevel *window);
+
+    QList<Toplevel *> m_windows;
+    QHash<Toplevel *, Item> m_items;
+    QHash<quint64, QVector<Entry>> m_cells;
+    /**
+     * Windows covering too many cells, checked for every position.
+     */
+    QVector<Entry> m_large;
+    bool m_valid = false;
+};
+
+}
+
+#endif
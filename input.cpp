@@ -23,6 +23,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "effects.h"
 #include "gestures.h"
 #include "globalshortcuts.h"
+#include "hit_test_index.h"
 #include "input_event.h"
 #include "input_event_spy.h"
 #include "keyboard_input.h"
@@ -66,7 +67,10 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 namespace KWin
 {
 
-InputEventFilter::InputEventFilter() = default;
+InputEventFilter::InputEventFilter(EventTypes eventTypes)
+    : m_eventTypes(eventTypes)
+{
+}
 
 InputEventFilter::~InputEventFilter()
 {
@@ -229,8 +233,24 @@ void InputEventFilter::passToWaylandServer(QKeyEvent *event)
     }
 }
 
+void InputEventFilter::setActive(bool active)
+{
+    if (m_active == active) {
+        return;
+    }
+    m_active = active;
+    if (input()) {
+        input()->m_filterRegistryDirty = true;
+    }
+}
+
 class VirtualTerminalFilter : public InputEventFilter {
 public:
+    VirtualTerminalFilter()
+        : InputEventFilter(KeyEvents)
+    {
+    }
+
     bool keyEvent(QKeyEvent *event) override {
         // really on press and not on release? X11 switches on press.
         if (event->type() == QEvent::KeyPress && !event->isAutoRepeat()) {
@@ -246,6 +266,11 @@ public:
 
 class TerminateServerFilter : public InputEventFilter {
 public:
+    TerminateServerFilter()
+        : InputEventFilter(KeyEvents)
+    {
+    }
+
     bool keyEvent(QKeyEvent *event) override {
         if (event->type() == QEvent::KeyPress && !event->isAutoRepeat()) {
             if (event->nativeVirtualKey() == XKB_KEY_Terminate_Server) {
@@ -260,6 +285,11 @@ public:
 
 class LockScreenFilter : public InputEventFilter {
 public:
+    LockScreenFilter()
+        : InputEventFilter(PointerMotionEvents | PointerButtonEvents | WheelEvents | KeyEvents | TouchEvents | GestureEvents)
+    {
+    }
+
     bool pointerEvent(QMouseEvent *event, quint32 nativeButton) override {
         if (!waylandServer()->isScreenLocked()) {
             return false;
@@ -439,6 +469,11 @@ private:
 
 class EffectsFilter : public InputEventFilter {
 public:
+    EffectsFilter()
+        : InputEventFilter(PointerMotionEvents | PointerButtonEvents | WheelEvents | KeyEvents | TouchEvents)
+    {
+    }
+
     bool pointerEvent(QMouseEvent *event, quint32 nativeButton) override {
         Q_UNUSED(nativeButton)
         if (!effects) {
@@ -483,6 +518,11 @@ public:
 
 class MoveResizeFilter : public InputEventFilter {
 public:
+    MoveResizeFilter()
+        : InputEventFilter(PointerMotionEvents | PointerButtonEvents | WheelEvents | KeyEvents | TouchEvents)
+    {
+    }
+
     bool pointerEvent(QMouseEvent *event, quint32 nativeButton) override {
         Q_UNUSED(nativeButton)
         AbstractClient *c = workspace()->moveResizeClient();
@@ -572,9 +612,15 @@ private:
 
 class WindowSelectorFilter : public InputEventFilter {
 public:
+    WindowSelectorFilter()
+        : InputEventFilter(PointerMotionEvents | PointerButtonEvents | WheelEvents | KeyEvents | TouchEvents)
+    {
+        setActive(false);
+    }
+
     bool pointerEvent(QMouseEvent *event, quint32 nativeButton) override {
         Q_UNUSED(nativeButton)
-        if (!m_active) {
+        if (!isActive()) {
             return false;
         }
         switch (event->type()) {
@@ -595,11 +641,11 @@ public:
     bool wheelEvent(QWheelEvent *event) override {
         Q_UNUSED(event)
         // filter out while selecting a window
-        return m_active;
+        return isActive();
     }
     bool keyEvent(QKeyEvent *event) override {
         Q_UNUSED(event)
-        if (!m_active) {
+        if (!isActive()) {
             return false;
         }
         waylandServer()->seat()->setFocusedKeyboardSurface(nullptr);
@@ -677,26 +723,23 @@ public:
         return true;
     }
 
-    bool isActive() const {
-        return m_active;
-    }
     void start(std::function<void(KWin::Toplevel*)> callback) {
-        Q_ASSERT(!m_active);
-        m_active = true;
+        Q_ASSERT(!isActive());
+        setActive(true);
         m_callback = callback;
         input()->keyboard()->update();
         input()->cancelTouch();
     }
     void start(std::function<void(const QPoint &)> callback) {
-        Q_ASSERT(!m_active);
-        m_active = true;
+        Q_ASSERT(!isActive());
+        setActive(true);
         m_pointSelectionFallback = callback;
         input()->keyboard()->update();
         input()->cancelTouch();
     }
 private:
     void deactivate() {
-        m_active = false;
+        setActive(false);
         m_callback = std::function<void(KWin::Toplevel*)>();
         m_pointSelectionFallback = std::function<void(const QPoint &)>();
         input()->pointer()->removeWindowSelectionCursor();
@@ -725,7 +768,6 @@ private:
     void accept(const QPointF &pos) {
         accept(pos.toPoint());
     }
-    bool m_active = false;
     std::function<void(KWin::Toplevel*)> m_callback;
     std::function<void(const QPoint &)> m_pointSelectionFallback;
     QMap<quint32, QPointF> m_touchPoints;
@@ -733,6 +775,11 @@ private:
 
 class GlobalShortcutFilter : public InputEventFilter {
 public:
+    GlobalShortcutFilter()
+        : InputEventFilter(PointerButtonEvents | WheelEvents | KeyEvents | GestureEvents)
+    {
+    }
+
     bool pointerEvent(QMouseEvent *event, quint32 nativeButton) override {
         Q_UNUSED(nativeButton);
         if (event->type() == QEvent::MouseButtonPress) {
@@ -861,6 +908,12 @@ std::pair<bool, bool> performClientWheelAction(QWheelEvent *event, AbstractClien
 }
 
 class InternalWindowEventFilter : public InputEventFilter {
+public:
+    InternalWindowEventFilter()
+        : InputEventFilter(PointerMotionEvents | PointerButtonEvents | WheelEvents | KeyEvents | TouchEvents)
+    {
+    }
+
     bool pointerEvent(QMouseEvent *event, quint32 nativeButton) override {
         Q_UNUSED(nativeButton)
         auto internal = input()->pointer()->internalWindow();
@@ -1056,6 +1109,11 @@ private:
 
 class DecorationEventFilter : public InputEventFilter {
 public:
+    DecorationEventFilter()
+        : InputEventFilter(PointerMotionEvents | PointerButtonEvents | WheelEvents | TouchEvents)
+    {
+    }
+
     bool pointerEvent(QMouseEvent *event, quint32 nativeButton) override {
         Q_UNUSED(nativeButton)
         auto decoration = input()->pointer()->decoration();
@@ -1212,6 +1270,24 @@ private:
 class TabBoxInputFilter : public InputEventFilter
 {
 public:
+    TabBoxInputFilter()
+        : InputEventFilter(PointerMotionEvents | PointerButtonEvents | WheelEvents | KeyEvents)
+    {
+        // only needed while the tabbox holds the grab
+        TabBox::TabBox *tabBox = TabBox::TabBox::self();
+        setActive(tabBox && tabBox->isGrabbed());
+        if (tabBox) {
+            m_grabbedConnection = QObject::connect(tabBox, &TabBox::TabBox::grabbedChanged,
+                [this, tabBox] {
+                    setActive(tabBox->isGrabbed());
+                }
+            );
+        }
+    }
+    ~TabBoxInputFilter() override {
+        QObject::disconnect(m_grabbedConnection);
+    }
+
     bool pointerEvent(QMouseEvent *event, quint32 button) override {
         Q_UNUSED(button)
         if (!TabBox::TabBox::self() || !TabBox::TabBox::self()->isGrabbed()) {
@@ -1243,12 +1319,20 @@ public:
         }
         return TabBox::TabBox::self()->handleWheelEvent(event);
     }
+
+private:
+    QMetaObject::Connection m_grabbedConnection;
 };
 #endif
 
 class ScreenEdgeInputFilter : public InputEventFilter
 {
 public:
+    ScreenEdgeInputFilter()
+        : InputEventFilter(PointerMotionEvents | TouchEvents)
+    {
+    }
+
     bool pointerEvent(QMouseEvent *event, quint32 nativeButton) override {
         Q_UNUSED(nativeButton)
         ScreenEdges::self()->isEntered(event);
@@ -1304,6 +1388,11 @@ private:
 class WindowActionInputFilter : public InputEventFilter
 {
 public:
+    WindowActionInputFilter()
+        : InputEventFilter(PointerButtonEvents | WheelEvents | TouchEvents)
+    {
+    }
+
     bool pointerEvent(QMouseEvent *event, quint32 nativeButton) override {
         Q_UNUSED(nativeButton)
         if (event->type() != QEvent::MouseButtonPress) {
@@ -1360,6 +1449,11 @@ public:
 class ForwardInputFilter : public InputEventFilter
 {
 public:
+    ForwardInputFilter()
+        : InputEventFilter(PointerMotionEvents | PointerButtonEvents | WheelEvents | KeyEvents | TouchEvents | GestureEvents)
+    {
+    }
+
     bool pointerEvent(QMouseEvent *event, quint32 nativeButton) override {
         auto seat = waylandServer()->seat();
         seat->setTimestamp(event->timestamp());
@@ -1367,7 +1461,13 @@ public:
         case QEvent::MouseMove: {
             seat->setPointerPos(event->globalPos());
             MouseEvent *e = static_cast<MouseEvent*>(event);
-            if (e->delta() != QSizeF()) {
+            const auto motions = e->relativeMotions();
+            if (!motions.isEmpty()) {
+                // merged device motion, relative pointer clients still get every single one
+                for (const RelativePointerMotion &motion : motions) {
+                    seat->relativePointerMotion(motion.delta, motion.deltaUnaccelerated, motion.timeMicroseconds);
+                }
+            } else if (e->delta() != QSizeF()) {
                 seat->relativePointerMotion(e->delta(), e->deltaUnaccelerated(), e->timestampMicroseconds());
             }
             break;
@@ -1539,6 +1639,7 @@ class FakeTabletInputFilter : public InputEventFilter
 {
 public:
     FakeTabletInputFilter()
+        : InputEventFilter(TabletEvents)
     {
     }
 
@@ -1575,6 +1676,11 @@ public:
 class DragAndDropInputFilter : public InputEventFilter
 {
 public:
+    DragAndDropInputFilter()
+        : InputEventFilter(PointerMotionEvents | PointerButtonEvents | TouchEvents)
+    {
+    }
+
     bool pointerEvent(QMouseEvent *event, quint32 nativeButton) override {
         auto seat = waylandServer()->seat();
         if (!seat->isDragPointer()) {
@@ -1713,6 +1819,8 @@ InputRedirection::InputRedirection(QObject *parent)
     , m_tablet(new TabletInputRedirection(this))
     , m_touch(new TouchInputRedirection(this))
     , m_shortcuts(new GlobalShortcutsManager(this))
+    , m_stackingIndex(new HitTestIndex(this))
+    , m_unmanagedIndex(new HitTestIndex(this))
 {
     qRegisterMetaType<KWin::InputRedirection::KeyboardKeyState>();
     qRegisterMetaType<KWin::InputRedirection::PointerButtonState>();
@@ -1751,17 +1859,54 @@ void InputRedirection::installInputEventFilter(InputEventFilter *filter)
 {
     Q_ASSERT(!m_filters.contains(filter));
     m_filters << filter;
+    m_filterRegistryDirty = true;
 }
 
 void InputRedirection::prependInputEventFilter(InputEventFilter *filter)
 {
     Q_ASSERT(!m_filters.contains(filter));
     m_filters.prepend(filter);
+    m_filterRegistryDirty = true;
 }
 
 void InputRedirection::uninstallInputEventFilter(InputEventFilter *filter)
 {
     m_filters.removeOne(filter);
+    m_filterStatistics.remove(filter);
+    m_filterRegistryDirty = true;
+}
+
+void InputRedirection::updateFilterRegistry()
+{
+    for (int i = 0; i < InputEventFilter::EventTypeCount; ++i) {
+        const auto type = InputEventFilter::EventType(1 << i);
+        QVector<InputEventFilter*> &filters = m_filterRegistry[i];
+        filters.clear();
+        for (InputEventFilter *filter : qAsConst(m_filters)) {
+            if (filter->isActive() && filter->eventTypes().testFlag(type)) {
+                filters << filter;
+            }
+        }
+    }
+    m_filterRegistryDirty = false;
+}
+
+void InputRedirection::setFilterProfilingEnabled(bool enabled)
+{
+    m_filterProfiling = enabled;
+    m_filterStatistics.clear();
+}
+
+InputRedirection::FilterStatistics InputRedirection::filterStatistics(const InputEventFilter *filter) const
+{
+    return m_filterStatistics.value(filter);
+}
+
+void InputRedirection::addFilterTime(const InputEventFilter *filter, qint64 time)
+{
+    FilterStatistics &statistics = m_filterStatistics[filter];
+    statistics.calls++;
+    statistics.time += time;
 }
 
 void InputRedirection::installInputEventSpy(InputEventSpy *spy)
@@ -1897,6 +2042,8 @@ void InputRedirection::setupWorkspace()
         m_touch->init();
         m_tablet->init();
     }
+    connect(workspace(), &Workspace::unmanagedAdded, m_unmanagedIndex, &HitTestIndex::invalidate);
+    connect(workspace(), &Workspace::unmanagedRemoved, m_unmanagedIndex, &HitTestIndex::invalidate);
     setupInputFilters();
 }
 
@@ -2000,8 +2147,9 @@ void InputRedirection::setupLibInput()
         connect(conn, &LibInput::Connection::swipeGestureCancelled, m_pointer, &PointerInputRedirection::processSwipeGestureCancelled);
         connect(conn, &LibInput::Connection::keyChanged, m_keyboard, &KeyboardInputRedirection::processKey);
         connect(conn, &LibInput::Connection::pointerMotion, this,
-            [this] (const QSizeF &delta, const QSizeF &deltaNonAccel, uint32_t time, quint64 timeMicroseconds, LibInput::Device *device) {
-                m_pointer->processMotion(m_pointer->pos() + QPointF(delta.width(), delta.height()), delta, deltaNonAccel, time, timeMicroseconds, device);
+            [this] (const QSizeF &delta, const QSizeF &deltaNonAccel, uint32_t time, quint64 timeMicroseconds, LibInput::Device *device,
+                    const QVector<RelativePointerMotion> &motions) {
+                m_pointer->processMotion(m_pointer->pos() + QPointF(delta.width(), delta.height()), delta, deltaNonAccel, time, timeMicroseconds, device, motions);
             }
         );
         connect(conn, &LibInput::Connection::pointerMotionAbsolute, this,
@@ -2018,7 +2166,7 @@ void InputRedirection::setupLibInput()
         auto handleSwitchEvent = [this] (SwitchEvent::State state, quint32 time, quint64 timeMicroseconds, LibInput::Device *device) {
             SwitchEvent event(state, time, timeMicroseconds, device);
             processSpies(std::bind(&InputEventSpy::switchEvent, std::placeholders::_1, &event));
-            processFilters(std::bind(&InputEventFilter::switchEvent, std::placeholders::_1, &event));
+            processFilters(InputEventFilter::SwitchEvents, std::bind(&InputEventFilter::switchEvent, std::placeholders::_1, &event));
         };
         connect(conn, &LibInput::Connection::switchToggledOn, this,
                 std::bind(handleSwitchEvent, SwitchEvent::State::On, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3));
@@ -2236,11 +2384,21 @@ Toplevel *InputRedirection::findToplevel(const QPoint &pos)
         if (effects && static_cast<EffectsHandlerImpl*>(effects)->isMouseInterception()) {
             return nullptr;
         }
-        const QList<Unmanaged *> &unmanaged = Workspace::self()->unmanagedList();
-        foreach (Unmanaged *u, unmanaged) {
-            if (u->inputGeometry().contains(pos) && acceptsInput(u, pos)) {
-                return u;
+        if (!m_unmanagedIndex->isValid()) {
+            // the first unmanaged window takes precedence, so it goes on top
+            const QList<Unmanaged *> &unmanaged = Workspace::self()->unmanagedList();
+            QList<Toplevel *> windows;
+            windows.reserve(unmanaged.count());
+            for (auto it = unmanaged.crbegin(); it != unmanaged.crend(); ++it) {
+                windows.append(*it);
             }
+            m_unmanagedIndex->rebuild(windows);
+        }
+        Toplevel *u = m_unmanagedIndex->findTopmost(pos, [pos] (Toplevel *t) {
+            return acceptsInput(t, pos);
+        });
+        if (u) {
+            return u;
         }
     }
     return findManagedToplevel(pos);
@@ -2253,35 +2411,27 @@ Toplevel *InputRedirection::findManagedToplevel(const QPoint &pos)
     }
     const bool isScreenLocked = waylandServer() && waylandServer()->isScreenLocked();
     const QList<Toplevel *> &stacking = Workspace::self()->stackingOrder();
-    if (stacking.isEmpty()) {
-        return nullptr;
-    }
-    auto it = stacking.end();
-    do {
-        --it;
-        Toplevel *t = (*it);
+    m_stackingIndex->update(stacking);
+    return m_stackingIndex->findTopmost(pos, [isScreenLocked, pos] (Toplevel *t) {
         if (t->isDeleted()) {
             // a deleted window doesn't get mouse events
-            continue;
+            return false;
         }
         if (AbstractClient *c = dynamic_cast<AbstractClient*>(t)) {
             if (!c->isOnCurrentActivity() || !c->isOnCurrentDesktop() || c->isMinimized() || c->isHiddenInternal()) {
-                continue;
+                return false;
             }
         }
         if (!t->readyForPainting()) {
-            continue;
+            return false;
         }
         if (isScreenLocked) {
             if (!t->isLockScreen() && !t->isInputMethod()) {
-                continue;
+                return false;
             }
         }
-        if (t->inputGeometry().contains(pos) && acceptsInput(t, pos)) {
-            return t;
-        }
-    } while (it != stacking.begin());
-    return nullptr;
+        return acceptsInput(t, pos);
+    });
 }
 
 Qt::KeyboardModifiers InputRedirection::keyboardModifiers() const
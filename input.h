@@ -26,11 +26,17 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <QObject>
 #include <QPoint>
 #include <QPointer>
+#include <QSizeF>
 #include <config-kwin.h>
 
 #include <KSharedConfig>
+#include <QElapsedTimer>
+#include <QHash>
 #include <QSet>
+#include <QtAlgorithms>
+#include <QVector>
 
+#include <array>
 #include <functional>
 
 class KGlobalAccelInterface;
@@ -42,6 +48,7 @@ class QWheelEvent;
 namespace KWin
 {
 class GlobalShortcutsManager;
+class HitTestIndex;
 class Toplevel;
 class InputEventFilter;
 class InputEventSpy;
@@ -63,6 +70,138 @@ namespace LibInput
     class Device;
 }
 
+/**
+ * A single relative pointer motion as reported by the device. Motion events merged into
+ * one cursor update keep these, relative pointer clients get each of them.
+ */
+struct RelativePointerMotion {
+    QSizeF delta;
+    QSizeF deltaUnaccelerated;
+    quint64 timeMicroseconds = 0;
+};
+
+/**
+ * Base class for filtering input events inside InputRedirection.
+ *
+ * The idea behind the InputEventFilter is to have task oriented
+ * filters. E.g. there is one filter taking care of a locked screen,
+ * one to take care of interacting with window decorations, etc.
+ *
+ * A concrete subclass can reimplement the virtual methods and decide
+ * whether an event should be filtered out or not by returning either
+ * @c true or @c false. E.g. the lock screen filter can easily ensure
+ * that all events are filtered out.
+ *
+ * As soon as a filter returns @c true the processing is stopped. If
+ * a filter returns @c false the next one is invoked. This means a filter
+ * installed early gets to see more events than a filter installed later on.
+ *
+ * Deleting an instance of InputEventFilter automatically uninstalls it from
+ * InputRedirection.
+ */
+class KWIN_EXPORT InputEventFilter
+{
+public:
+    /**
+     * The kinds of events passed through the filters. Each one stands for a group of the
+     * virtual methods below, e.g. TouchEvents for touchDown, touchMotion and touchUp.
+     */
+    enum EventType {
+        PointerMotionEvents = 1 << 0,
+        PointerButtonEvents = 1 << 1,
+        WheelEvents = 1 << 2,
+        KeyEvents = 1 << 3,
+        TouchEvents = 1 << 4,
+        GestureEvents = 1 << 5,
+        SwitchEvents = 1 << 6,
+        TabletEvents = 1 << 7,
+        AllEvents = (1 << 8) - 1
+    };
+    Q_DECLARE_FLAGS(EventTypes, EventType)
+    static const int EventTypeCount = 8;
+
+    /**
+     * Creates a filter which only gets events of the @p eventTypes. Events of other types
+     * are passed on to the next filter without invoking this one.
+     */
+    explicit InputEventFilter(EventTypes eventTypes = AllEvents);
+    virtual ~InputEventFilter();
+
+    EventTypes eventTypes() const {
+        return m_eventTypes;
+    }
+    /**
+     * An inactive filter is skipped for all events. Filters are active by default.
+     */
+    bool isActive() const {
+        return m_active;
+    }
+
+    /**
+     * Event filter for pointer events which can be described by a QMouseEvent.
+     *
+     * Please note that the button translation in QMouseEvent cannot cover all
+     * possible buttons. Because of that also the @p nativeButton code is passed
+     * through the filter. For internal areas it's fine to use @p event, but for
+     * passing to client windows the @p nativeButton should be used.
+     *
+     * @param event The event information about the move or button press/release
+     * @param nativeButton The native key code of the button, for move events 0
+     * @return @c true to stop further event processing, @c false to pass to next filter
+     */
+    virtual bool pointerEvent(QMouseEvent *event, quint32 nativeButton);
+    /**
+     * Event filter for pointer axis events.
+     *
+     * @param event The event information about the axis event
+     * @return @c true to stop further event processing, @c false to pass to next filter
+     */
+    virtual bool wheelEvent(QWheelEvent *event);
+    /**
+     * Event filter for keyboard events.
+     *
+     * @param event The event information about the key event
+     * @return @c tru to stop further event processing, @c false to pass to next filter.
+     */
+    virtual bool keyEvent(QKeyEvent *event);
+    virtual bool touchDown(qint32 id, const QPointF &pos, quint32 time);
+    virtual bool touchMotion(qint32 id, const QPointF &pos, quint32 time);
+    virtual bool touchUp(qint32 id, quint32 time);
+
+    virtual bool pinchGestureBegin(int fingerCount, quint32 time);
+    virtual bool pinchGestureUpdate(qreal scale, qreal angleDelta, const QSizeF &delta, quint32 time);
+    virtual bool pinchGestureEnd(quint32 time);
+    virtual bool pinchGestureCancelled(quint32 time);
+
+    virtual bool swipeGestureBegin(int fingerCount, quint32 time);
+    virtual bool swipeGestureUpdate(const QSizeF &delta, quint32 time);
+    virtual bool swipeGestureEnd(quint32 time);
+    virtual bool swipeGestureCancelled(quint32 time);
+
+    virtual bool switchEvent(SwitchEvent *event);
+
+    virtual bool tabletToolEvent(QTabletEvent *event);
+    virtual bool tabletToolButtonEvent(const QSet<uint> &buttons);
+    virtual bool tabletPadButtonEvent(const QSet<uint> &buttons);
+    virtual bool tabletPadStripEvent(int number, int position, bool isFinger);
+    virtual bool tabletPadRingEvent(int number, int position, bool isFinger);
+
+protected:
+    void passToWaylandServer(QKeyEvent *event);
+    /**
+     * Filters which only act in a certain state, e.g. while a grab is active, should
+     * deactivate themselves while not in that state, so that dispatching the events
+     * doesn't have to go through them.
+     */
+    void setActive(bool active);
+
+private:
+    EventTypes m_eventTypes;
+    bool m_active = true;
+};
+
+Q_DECLARE_OPERATORS_FOR_FLAGS(InputEventFilter::EventTypes)
+
 /**
  * @brief This class is responsible for redirecting incoming input to the surface which currently
  * has input or send enter/leave events.
@@ -187,8 +326,8 @@ public:
     }
 
     /**
-     * Sends an event through all InputFilters.
-     * The method @p function is invoked on each input filter. Processing is stopped if
+     * Sends an event of @p type through the active InputFilters handling that type.
+     * The method @p function is invoked on each of those filters. Processing is stopped if
      * a filter returns @c true for @p function.
      *
      * The UnaryPredicate is defined like the UnaryPredicate of std::any_of.
@@ -201,8 +340,43 @@ public:
      * bind.
      */
     template <class UnaryPredicate>
-    void processFilters(UnaryPredicate function) {
-        std::any_of(m_filters.constBegin(), m_filters.constEnd(), function);
+    void processFilters(InputEventFilter::EventType type, UnaryPredicate function) {
+        if (m_filterRegistryDirty) {
+            updateFilterRegistry();
+        }
+        // copied, as the event might install or deactivate filters
+        const QVector<InputEventFilter*> filters = m_filterRegistry[filterRegistryIndex(type)];
+        if (Q_UNLIKELY(m_filterProfiling)) {
+            std::any_of(filters.constBegin(), filters.constEnd(),
+                [this, &function] (InputEventFilter *filter) {
+                    QElapsedTimer timer;
+                    timer.start();
+                    const bool filtered = function(filter);
+                    addFilterTime(filter, timer.nsecsElapsed());
+                    return filtered;
+                }
+            );
+            return;
+        }
+        std::any_of(filters.constBegin(), filters.constEnd(), function);
+    }
+
+    struct FilterStatistics {
+        quint64 calls = 0;
+        // in nanoseconds
+        qint64 time = 0;
+    };
+    /**
+     * Measures the time spent in each filter while enabled, for the debug console.
+     * Enabling resets the statistics.
+     */
+    void setFilterProfilingEnabled(bool enabled);
+    FilterStatistics filterStatistics(const InputEventFilter *filter) const;
+    /**
+     * All installed filters in processing order, including inactive ones.
+     */
+    QVector<InputEventFilter*> filters() const {
+        return m_filters;
     }
 
     /**
@@ -293,6 +467,11 @@ private:
     void reconfigure();
     void setupInputFilters();
     void installInputEventFilter(InputEventFilter *filter);
+    void updateFilterRegistry();
+    void addFilterTime(const InputEventFilter *filter, qint64 time);
+    static int filterRegistryIndex(InputEventFilter::EventType type) {
+        return qCountTrailingZeroBits(quint32(type));
+    }
     KeyboardInputRedirection *m_keyboard;
     PointerInputRedirection *m_pointer;
     TabletInputRedirection *m_tablet;
@@ -304,7 +483,15 @@ private:
 
     WindowSelectorFilter *m_windowSelector = nullptr;
 
+    HitTestIndex *m_stackingIndex;
+    HitTestIndex *m_unmanagedIndex;
+
     QVector<InputEventFilter*> m_filters;
+    // the active filters of m_filters for each event type
+    std::array<QVector<InputEventFilter*>, InputEventFilter::EventTypeCount> m_filterRegistry;
+    bool m_filterRegistryDirty = true;
+    bool m_filterProfiling = false;
+    QHash<const InputEventFilter*, FilterStatistics> m_filterStatistics;
     QVector<InputEventSpy*> m_spies;
 
     KWIN_SINGLETON(InputRedirection)
@@ -312,84 +499,7 @@ private:
     friend class DecorationEventFilter;
     friend class InternalWindowEventFilter;
     friend class ForwardInputFilter;
-};
-
-/**
- * Base class for filtering input events inside InputRedirection.
- *
- * The idea behind the InputEventFilter is to have task oriented
- * filters. E.g. there is one filter taking care of a locked screen,
- * one to take care of interacting with window decorations, etc.
- *
- * A concrete subclass can reimplement the virtual methods and decide
- * whether an event should be filtered out or not by returning either
- * @c true or @c false. E.g. the lock screen filter can easily ensure
- * that all events are filtered out.
- *
- * As soon as a filter returns @c true the processing is stopped. If
- * a filter returns @c false the next one is invoked. This means a filter
- * installed early gets to see more events than a filter installed later on.
- *
- * Deleting an instance of InputEventFilter automatically uninstalls it from
- * InputRedirection.
- */
-class KWIN_EXPORT InputEventFilter
-{
-public:
-    InputEventFilter();
-    virtual ~InputEventFilter();
-
-    /**
-     * Event filter for pointer events which can be described by a QMouseEvent.
-     *
-     * Please note that the button translation in QMouseEvent cannot cover all
-     * possible buttons. Because of that also the @p nativeButton code is passed
-     * through the filter. For internal areas it's fine to use @p event, but for
-     * passing to client windows the @p nativeButton should be used.
-     *
-     * @param event The event information about the move or button press/release
-     * @param nativeButton The native key code of the button, for move events 0
-     * @return @c true to stop further event processing, @c false to pass to next filter
-     */
-    virtual bool pointerEvent(QMouseEvent *event, quint32 nativeButton);
-    /**
-     * Event filter for pointer axis events.
-     *
-     * @param event The event information about the axis event
-     * @return @c true to stop further event processing, @c false to pass to next filter
-     */
-    virtual bool wheelEvent(QWheelEvent *event);
-    /**
-     * Event filter for keyboard events.
-     *
-     * @param event The event information about the key event
-     * @return @c tru to stop further event processing, @c false to pass to next filter.
-     */
-    virtual bool keyEvent(QKeyEvent *event);
-    virtual bool touchDown(qint32 id, const QPointF &pos, quint32 time);
-    virtual bool touchMotion(qint32 id, const QPointF &pos, quint32 time);
-    virtual bool touchUp(qint32 id, quint32 time);
-
-    virtual bool pinchGestureBegin(int fingerCount, quint32 time);
-    virtual bool pinchGestureUpdate(qreal scale, qreal angleDelta, const QSizeF &delta, quint32 time);
-    virtual bool pinchGestureEnd(quint32 time);
-    virtual bool pinchGestureCancelled(quint32 time);
-
-    virtual bool swipeGestureBegin(int fingerCount, quint32 time);
-    virtual bool swipeGestureUpdate(const QSizeF &delta, quint32 time);
-    virtual bool swipeGestureEnd(quint32 time);
-    virtual bool swipeGestureCancelled(quint32 time);
-
-    virtual bool switchEvent(SwitchEvent *event);
-
-    virtual bool tabletToolEvent(QTabletEvent *event);
-    virtual bool tabletToolButtonEvent(const QSet<uint> &buttons);
-    virtual bool tabletPadButtonEvent(const QSet<uint> &buttons);
-    virtual bool tabletPadStripEvent(int number, int position, bool isFinger);
-    virtual bool tabletPadRingEvent(int number, int position, bool isFinger);
-
-protected:
-    void passToWaylandServer(QKeyEvent *event);
+    friend class InputEventFilter;
 };
 
 class KWIN_EXPORT InputDeviceHandler : public QObject
@@ -72,6 +72,18 @@ public:
         m_nativeButton = button;
     }
 
+    /**
+     * The single motions summed up in delta(), empty if the event wasn't merged from
+     * device motion.
+     */
+    QVector<RelativePointerMotion> relativeMotions() const {
+        return m_relativeMotions;
+    }
+
+    void setRelativeMotions(const QVector<RelativePointerMotion> &motions) {
+        m_relativeMotions = motions;
+    }
+
 private:
     QSizeF m_delta;
     QSizeF m_deltaUnccelerated;
@@ -79,6 +91,7 @@ private:
     LibInput::Device *m_device;
     Qt::KeyboardModifiers m_modifiersRelevantForShortcuts = Qt::KeyboardModifiers();
     quint32 m_nativeButton = 0;
+    QVector<RelativePointerMotion> m_relativeMotions;
 };
 
 // TODO: Don't derive from QWheelEvent, this event is quite domain specific.
@@ -40,6 +40,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <QMutexLocker>
 #include <QSocketNotifier>
 #include <QThread>
+#include <QTimer>
 
 #include <libinput.h>
 #include <cmath>
@@ -170,6 +171,7 @@ Connection::Connection(Context *input, QObject *parent)
     , m_leds()
 {
     Q_ASSERT(m_input);
+    m_coalesceMotion = qEnvironmentVariableIntValue("KWIN_LIBINPUT_COALESCE_MOTION") != 0;
     // need to connect to KGlobalSettings as the mouse KCM does not emit a dedicated signal
     QDBusConnection::sessionBus().connect(QString(), QStringLiteral("/KGlobalSettings"), QStringLiteral("org.kde.KGlobalSettings"),
                                           QStringLiteral("notifyChange"), this, SLOT(slotKGlobalSettingsNotifyChange(int,int)));
@@ -177,6 +179,11 @@ Connection::Connection(Context *input, QObject *parent)
 
 Connection::~Connection()
 {
+    Event *event;
+    while (m_eventQueue.pop(&event)) {
+        delete event;
+    }
+    delete m_overflowEvent;
     delete s_adaptor;
     s_adaptor = nullptr;
     s_self = nullptr;
@@ -235,17 +242,49 @@ void Connection::deactivate()
 
 void Connection::handleEvent()
 {
-    QMutexLocker locker(&m_mutex);
-    const bool wasEmpty = m_eventQueue.isEmpty();
+    // Runs on the libinput thread only. Handing the events over is lock-free, but libinput
+    // itself is not thread-safe: the main thread destroys events and creates devices, so
+    // every call into the context is serialized with the mutex.
+    bool queued = false;
+    if (m_overflowEvent) {
+        if (!m_eventQueue.push(m_overflowEvent)) {
+            overflowQueue();
+            return;
+        }
+        m_overflowEvent = nullptr;
+        queued = true;
+        m_notifier->setEnabled(true);
+    }
     do {
-        m_input->dispatch();
-        Event *event = m_input->event();
+        Event *event;
+        {
+            QMutexLocker locker(&m_mutex);
+            m_input->dispatch();
+            event = m_input->event();
+        }
         if (!event) {
             break;
         }
-        m_eventQueue << event;
+        if (!m_eventQueue.push(event)) {
+            m_overflowEvent = event;
+            overflowQueue();
+            return;
+        }
+        queued = true;
     } while (true);
-    if (wasEmpty && !m_eventQueue.isEmpty()) {
+    if (queued && !m_eventsReadPending.exchange(true)) {
+        emit eventsRead();
+    }
+}
+
+void Connection::overflowQueue()
+{
+    // The fd stays readable, so stop watching it until the main thread drained the queue
+    // and asks for more. The flag is set before the main thread gets notified, so either
+    // the running processEvents() sees it or the notification triggers another one.
+    m_notifier->setEnabled(false);
+    m_queueOverflowed = true;
+    if (!m_eventsReadPending.exchange(true)) {
         emit eventsRead();
     }
 }
@@ -283,9 +322,17 @@ QPointF devicePointToGlobalPosition(const QPointF &devicePos, const AbstractWayl
 
 void Connection::processEvents()
 {
-    QMutexLocker locker(&m_mutex);
-    while (!m_eventQueue.isEmpty()) {
-        QScopedPointer<Event> event(m_eventQueue.takeFirst());
+    // cleared before draining, events queued from now on need another notification
+    m_eventsReadPending = false;
+    Event *next;
+    while (m_eventQueue.pop(&next)) {
+        // locked per event, so the libinput thread can read new events in between,
+        // declared first to still be held when the event gets destroyed
+        QMutexLocker locker(&m_mutex);
+        QScopedPointer<Event> event(next);
+        if (event->type() != LIBINPUT_EVENT_POINTER_MOTION) {
+            flushPointerMotion();
+        }
         switch (event->type()) {
             case LIBINPUT_EVENT_DEVICE_ADDED: {
                 auto device = new Device(event->nativeDevice());
@@ -392,28 +439,9 @@ void Connection::processEvents()
                 emit pointerButtonChanged(pe->button(), pe->buttonState(), pe->time(), pe->device());
                 break;
             }
-            case LIBINPUT_EVENT_POINTER_MOTION: {
-                PointerEvent *pe = static_cast<PointerEvent*>(event.data());
-                auto delta = pe->delta();
-                auto deltaNonAccel = pe->deltaUnaccelerated();
-                quint32 latestTime = pe->time();
-                quint64 latestTimeUsec = pe->timeMicroseconds();
-                auto it = m_eventQueue.begin();
-                while (it != m_eventQueue.end()) {
-                    if ((*it)->type() == LIBINPUT_EVENT_POINTER_MOTION) {
-                        QScopedPointer<PointerEvent> p(static_cast<PointerEvent*>(*it));
-                        delta += p->delta();
-                        deltaNonAccel += p->deltaUnaccelerated();
-                        latestTime = p->time();
-                        latestTimeUsec = p->timeMicroseconds();
-                        it = m_eventQueue.erase(it);
-                    } else {
-                        break;
-                    }
-                }
-                emit pointerMotion(delta, deltaNonAccel, latestTime, latestTimeUsec, pe->device());
+            case LIBINPUT_EVENT_POINTER_MOTION:
+                processPointerMotion(static_cast<PointerEvent*>(event.data()));
                 break;
-            }
             case LIBINPUT_EVENT_POINTER_MOTION_ABSOLUTE: {
                 PointerEvent *pe = static_cast<PointerEvent*>(event.data());
                 emit pointerMotionAbsolute(pe->absolutePos(), pe->absolutePos(m_size), pe->time(), pe->device());
@@ -587,6 +615,95 @@ void Connection::processEvents()
         }
         wasSuspended = false;
     }
+    if (m_queueOverflowed.exchange(false)) {
+        // the libinput thread stopped reading when the queue was full, let it continue,
+        // it enables the notifier again on its own thread
+        QMetaObject::invokeMethod(this, [this] { handleEvent(); }, Qt::QueuedConnection);
+    }
+}
+
+void Connection::processPointerMotion(PointerEvent *event)
+{
+    if (m_pendingMotion.device && m_pendingMotion.device != event->device()) {
+        flushPointerMotion();
+    }
+    m_pendingMotion.device = event->device();
+    addPointerMotion(event);
+
+    // merge the motion of the same device which is already queued
+    while (const auto queued = m_eventQueue.front()) {
+        if ((*queued)->type() != LIBINPUT_EVENT_POINTER_MOTION || (*queued)->device() != event->device()) {
+            break;
+        }
+        Event *next;
+        m_eventQueue.pop(&next);
+        QScopedPointer<PointerEvent> pe(static_cast<PointerEvent*>(next));
+        addPointerMotion(pe.data());
+    }
+
+    if (!m_coalesceMotion) {
+        flushPointerMotion();
+        return;
+    }
+    if (m_motionInterval <= 0) {
+        updateMotionInterval();
+    }
+    const qint64 remaining = m_lastMotion.isValid() ? m_motionInterval - m_lastMotion.elapsed() : 0;
+    if (remaining <= 0) {
+        flushPointerMotion();
+        return;
+    }
+    if (!m_motionTimer) {
+        m_motionTimer.reset(new QTimer);
+        m_motionTimer->setSingleShot(true);
+        m_motionTimer->setTimerType(Qt::PreciseTimer);
+        connect(m_motionTimer.data(), &QTimer::timeout, m_motionTimer.data(), [this] {
+            QMutexLocker locker(&m_mutex);
+            flushPointerMotion();
+        });
+    }
+    if (!m_motionTimer->isActive()) {
+        m_motionTimer->start(remaining);
+    }
+}
+
+void Connection::addPointerMotion(PointerEvent *event)
+{
+    const QSizeF delta = event->delta();
+    const QSizeF deltaNonAccelerated = event->deltaUnaccelerated();
+    m_pendingMotion.delta += delta;
+    m_pendingMotion.deltaNonAccelerated += deltaNonAccelerated;
+    m_pendingMotion.time = event->time();
+    m_pendingMotion.timeMicroseconds = event->timeMicroseconds();
+    m_pendingMotion.motions.append({delta, deltaNonAccelerated, event->timeMicroseconds()});
+}
+
+void Connection::flushPointerMotion()
+{
+    if (!m_pendingMotion.device) {
+        return;
+    }
+    if (m_motionTimer) {
+        m_motionTimer->stop();
+    }
+    const PointerMotion motion = m_pendingMotion;
+    m_pendingMotion = PointerMotion();
+    m_lastMotion.start();
+    emit pointerMotion(motion.delta, motion.deltaNonAccelerated, motion.time, motion.timeMicroseconds, motion.device, motion.motions);
+}
+
+void Connection::updateMotionInterval()
+{
+    m_motionInterval = 0;
+#ifndef KWIN_BUILD_TESTING
+    float refreshRate = 0;
+    for (int i = 0; i < screens()->count(); ++i) {
+        refreshRate = qMax(refreshRate, screens()->refreshRate(i));
+    }
+    if (refreshRate > 0) {
+        m_motionInterval = qRound(1000 / refreshRate);
+    }
+#endif
 }
 
 void Connection::setScreenSize(const QSize &size)
@@ -597,6 +714,8 @@ void Connection::setScreenSize(const QSize &size)
 void Connection::updateScreens()
 {
     QMutexLocker locker(&m_mutex);
+    // recomputed with the next motion
+    m_motionInterval = 0;
     for (auto device: qAsConst(m_devices)) {
         applyScreenToDevice(device);
     }
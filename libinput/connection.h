@@ -22,17 +22,24 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "../input.h"
 #include "../keyboard_input.h"
+#include "ringbuffer.h"
 #include <kwinglobals.h>
 
+#include <QElapsedTimer>
 #include <QObject>
 #include <QPointer>
+#include <QScopedPointer>
 #include <QSize>
+#include <QSizeF>
 #include <QMutex>
 #include <QVector>
 #include <QStringList>
 
+#include <atomic>
+
 class QSocketNotifier;
 class QThread;
+class QTimer;
 
 namespace KWin
 {
@@ -42,6 +49,7 @@ namespace LibInput
 class Event;
 class Device;
 class Context;
+class PointerEvent;
 
 class KWIN_EXPORT Connection : public QObject
 {
@@ -103,7 +111,12 @@ Q_SIGNALS:
     void keyChanged(quint32 key, KWin::InputRedirection::KeyboardKeyState, quint32 time, KWin::LibInput::Device *device);
     void pointerButtonChanged(quint32 button, KWin::InputRedirection::PointerButtonState state, quint32 time, KWin::LibInput::Device *device);
     void pointerMotionAbsolute(QPointF orig, QPointF screen, quint32 time, KWin::LibInput::Device *device);
-    void pointerMotion(const QSizeF &delta, const QSizeF &deltaNonAccelerated, quint32 time, quint64 timeMicroseconds, KWin::LibInput::Device *device);
+    /**
+     * @p delta and @p deltaNonAccelerated are the sum of @p motions, @p time and
+     * @p timeMicroseconds the timestamp of the latest one.
+     */
+    void pointerMotion(const QSizeF &delta, const QSizeF &deltaNonAccelerated, quint32 time, quint64 timeMicroseconds, KWin::LibInput::Device *device,
+                       const QVector<KWin::RelativePointerMotion> &motions);
     void pointerAxisChanged(KWin::InputRedirection::PointerAxis axis, qreal delta, qint32 discreteDelta,
         KWin::InputRedirection::PointerAxisSource source, quint32 time, KWin::LibInput::Device *device);
     void touchFrame(KWin::LibInput::Device *device);
@@ -151,6 +164,11 @@ private:
     void handleEvent();
     void applyDeviceConfig(Device *device);
     void applyScreenToDevice(Device *device);
+    void updateMotionInterval();
+    void processPointerMotion(PointerEvent *event);
+    void addPointerMotion(PointerEvent *event);
+    void flushPointerMotion();
+    void overflowQueue();
     Context *m_input;
     QSocketNotifier *m_notifier;
     QSize m_size;
@@ -165,7 +183,33 @@ private:
     bool m_touchBeforeSuspend = false;
     bool m_tabletModeSwitchBeforeSuspend = false;
     QMutex m_mutex;
-    QVector<Event*> m_eventQueue;
+    // filled on the libinput thread, drained on the main thread
+    RingBuffer<Event*, 1024> m_eventQueue;
+    // read from libinput but not queued yet because the queue was full
+    Event *m_overflowEvent = nullptr;
+    std::atomic<bool> m_eventsReadPending{false};
+    std::atomic<bool> m_queueOverflowed{false};
+
+    /**
+     * Relative pointer motion not emitted yet. Consecutive motion events of a device are
+     * summed up, with KWIN_LIBINPUT_COALESCE_MOTION set to 1 also across event batches
+     * until a refresh interval passed since the last emitted motion. The single motions
+     * are kept with their timestamps for relative pointer clients.
+     */
+    struct PointerMotion {
+        QSizeF delta;
+        QSizeF deltaNonAccelerated;
+        quint32 time = 0;
+        quint64 timeMicroseconds = 0;
+        Device *device = nullptr;
+        QVector<RelativePointerMotion> motions;
+    };
+    PointerMotion m_pendingMotion;
+    bool m_coalesceMotion = false;
+    int m_motionInterval = 0;
+    QElapsedTimer m_lastMotion;
+    // lives on the main thread, like the consumer side of the queue
+    QScopedPointer<QTimer, QScopedPointerDeleteLater> m_motionTimer;
     bool wasSuspended = false;
     QVector<Device*> m_devices;
     KSharedConfigPtr m_config;
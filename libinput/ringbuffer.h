@@ -0,0 +1,96 @@
+/********************************************************************
+ KWin - the KDE window manager
+ This file is part of the KDE project.
+
+Copyright (C) 2020 The KWin developers <kwin@kde.org>
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*********************************************************************/
+#ifndef KWIN_LIBINPUT_RINGBUFFER_H
+#define KWIN_LIBINPUT_RINGBUFFER_H
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+namespace KWin
+{
+namespace LibInput
+{
+
+/**
+ * @short Bounded lock-free queue for one producer thread and one consumer thread.
+ *
+ * All slots are allocated up front. push() may only be called from the producer thread,
+ * front() and pop() only from the consumer thread.
+ */
+template <typename T, std::size_t Capacity>
+class RingBuffer
+{
+    static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+    /**
+     * Appends @p value, returns @c false if the queue is full.
+     */
+    bool push(const T &value) {
+        const std::size_t tail = m_tail.load(std::memory_order_relaxed);
+        if (tail - m_head.load(std::memory_order_acquire) == Capacity) {
+            return false;
+        }
+        m_slots[tail & (Capacity - 1)] = value;
+        m_tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * Returns the oldest value without removing it, or @c nullptr if the queue is empty.
+     */
+    const T *front() const {
+        const std::size_t head = m_head.load(std::memory_order_relaxed);
+        if (head == m_tail.load(std::memory_order_acquire)) {
+            return nullptr;
+        }
+        return &m_slots[head & (Capacity - 1)];
+    }
+
+    /**
+     * Removes the oldest value and stores it in @p value, returns @c false if the queue is empty.
+     */
+    bool pop(T *value) {
+        const std::size_t head = m_head.load(std::memory_order_relaxed);
+        if (head == m_tail.load(std::memory_order_acquire)) {
+            return false;
+        }
+        *value = m_slots[head & (Capacity - 1)];
+        m_head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    static constexpr std::size_t capacity() {
+        return Capacity;
+    }
+
+private:
+    std::array<T, Capacity> m_slots;
+    // The indices only ever grow, they are wrapped when accessing the slots. Each one
+    // gets a cache line of its own, so the threads don't invalidate each other's.
+    alignas(64) std::atomic<std::size_t> m_head{0};
+    alignas(64) std::atomic<std::size_t> m_tail{0};
+};
+
+}
+}
+
+#endif
@@ -38,6 +38,8 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <QGraphicsScale>
 #include <QtMath>
 
+#include <cstddef>
+
 #include <ksharedconfig.h>
 #include <kconfiggroup.h>
 
@@ -605,6 +607,11 @@ bool Effect::isActive() const
     return true;
 }
 
+bool Effect::blocksDirectScanout() const
+{
+    return true;
+}
+
 QString Effect::debug(const QString &) const
 {
     return QString();
@@ -932,7 +939,8 @@ bool WindowQuad::smoothNeeded() const
 WindowQuadList WindowQuadList::splitAtX(double x) const
 {
     WindowQuadList ret;
-    foreach (const WindowQuad & quad, *this) {
+    ret.reserve(count());
+    for (const WindowQuad &quad : *this) {
 #if !defined(QT_NO_DEBUG)
         if (quad.isTransformed())
             qFatal("Splitting quads is allowed only in pre-paint calls!");
@@ -964,7 +972,8 @@ WindowQuadList WindowQuadList::splitAtX(double x) const
 WindowQuadList WindowQuadList::splitAtY(double y) const
 {
     WindowQuadList ret;
-    foreach (const WindowQuad & quad, *this) {
+    ret.reserve(count());
+    for (const WindowQuad &quad : *this) {
 #if !defined(QT_NO_DEBUG)
         if (quad.isTransformed())
             qFatal("Splitting quads is allowed only in pre-paint calls!");
@@ -1004,7 +1013,7 @@ WindowQuadList WindowQuadList::makeGrid(int maxQuadSize) const
     double top    = first().top();
     double bottom = first().bottom();
 
-    foreach (const WindowQuad &quad, *this) {
+    for (const WindowQuad &quad : *this) {
 #if !defined(QT_NO_DEBUG)
         if (quad.isTransformed())
             qFatal("Splitting quads is allowed only in pre-paint calls!");
@@ -1016,8 +1025,9 @@ WindowQuadList WindowQuadList::makeGrid(int maxQuadSize) const
     }
 
     WindowQuadList ret;
+    ret.reserve(qMax(count(), qCeil((right - left) / maxQuadSize) * qCeil((bottom - top) / maxQuadSize)));
 
-    foreach (const WindowQuad &quad, *this) {
+    for (const WindowQuad &quad : *this) {
         const double quadLeft   = quad.left();
         const double quadRight  = quad.right();
         const double quadTop    = quad.top();
@@ -1061,7 +1071,7 @@ WindowQuadList WindowQuadList::makeRegularGrid(int xSubdivisions, int ySubdivisi
     double top    = first().top();
     double bottom = first().bottom();
 
-    foreach (const WindowQuad &quad, *this) {
+    for (const WindowQuad &quad : *this) {
 #if !defined(QT_NO_DEBUG)
         if (quad.isTransformed())
             qFatal("Splitting quads is allowed only in pre-paint calls!");
@@ -1076,8 +1086,9 @@ WindowQuadList WindowQuadList::makeRegularGrid(int xSubdivisions, int ySubdivisi
     double yIncrement = (bottom - top) / ySubdivisions;
 
     WindowQuadList ret;
+    ret.reserve(qMax(count(), xSubdivisions * ySubdivisions));
 
-    foreach (const WindowQuad &quad, *this) {
+    for (const WindowQuad &quad : *this) {
         const double quadLeft   = quad.left();
         const double quadRight  = quad.right();
         const double quadTop    = quad.top();
@@ -1129,110 +1140,96 @@ void WindowQuadList::makeInterleavedArrays(unsigned int type, GLVertex2D *vertic
 
     Q_ASSERT(type == GL_QUADS || type == GL_TRIANGLES);
 
-    switch (type)
-    {
-    case GL_QUADS:
 #if defined(__SSE2__)
-        if (!(intptr_t(vertex) & 0xf)) {
-            for (int i = 0; i < count(); i++) {
-                const WindowQuad &quad = at(i);
-                alignas(16) GLVertex2D v[4];
-
-                for (int j = 0; j < 4; j++) {
-                    const WindowVertex &wv = quad[j];
-
-                    v[j].position = QVector2D(wv.x(), wv.y());
-                    v[j].texcoord = QVector2D(wv.u(), wv.v()) * coeff + offset;
-                }
+    // A WindowVertex starts with x, y, u, v, which is the layout of a GLVertex2D once
+    // the texture coordinates are transformed, so each vertex is one load, one
+    // multiply-add and one store.
+    static_assert(sizeof(GLVertex2D) == 4 * sizeof(float), "GLVertex2D must be four floats");
+    static_assert(offsetof(WindowVertex, ty) == 3 * sizeof(float), "WindowVertex must start with x, y, u, v");
+
+    if (!(intptr_t(vertex) & 0xf)) {
+        const __m128 scale = _mm_setr_ps(1.0f, 1.0f, coeff.x(), coeff.y());
+        const __m128 translation = _mm_setr_ps(0.0f, 0.0f, offset.x(), offset.y());
+        __m128 *dstP = reinterpret_cast<__m128 *>(vertex);
+
+        auto load = [scale, translation](const WindowVertex &wv) {
+            return _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(&wv.px), scale), translation);
+        };
+
+        switch (type) {
+        case GL_QUADS:
+            for (const WindowQuad &quad : *this) {
+                _mm_stream_ps(reinterpret_cast<float *>(dstP++), load(quad.verts[0])); // Top-left
+                _mm_stream_ps(reinterpret_cast<float *>(dstP++), load(quad.verts[1])); // Top-right
+                _mm_stream_ps(reinterpret_cast<float *>(dstP++), load(quad.verts[2])); // Bottom-right
+                _mm_stream_ps(reinterpret_cast<float *>(dstP++), load(quad.verts[3])); // Bottom-left
+            }
+            break;
 
-                const __m128i *srcP = reinterpret_cast<const __m128i *>(&v);
-                __m128i *dstP = reinterpret_cast<__m128i *>(vertex);
+        case GL_TRIANGLES:
+            for (const WindowQuad &quad : *this) {
+                const __m128 src[4] = {
+                    load(quad.verts[0]), // Top-left
+                    load(quad.verts[1]), // Top-right
+                    load(quad.verts[2]), // Bottom-right
+                    load(quad.verts[3])  // Bottom-left
+                };
 
-                _mm_stream_si128(&dstP[0], _mm_load_si128(&srcP[0])); // Top-left
-                _mm_stream_si128(&dstP[1], _mm_load_si128(&srcP[1])); // Top-right
-                _mm_stream_si128(&dstP[2], _mm_load_si128(&srcP[2])); // Bottom-right
-                _mm_stream_si128(&dstP[3], _mm_load_si128(&srcP[3])); // Bottom-left
+                // First triangle
+                _mm_stream_ps(reinterpret_cast<float *>(dstP++), src[1]); // Top-right
+                _mm_stream_ps(reinterpret_cast<float *>(dstP++), src[0]); // Top-left
+                _mm_stream_ps(reinterpret_cast<float *>(dstP++), src[3]); // Bottom-left
 
-                vertex += 4;
+                // Second triangle
+                _mm_stream_ps(reinterpret_cast<float *>(dstP++), src[3]); // Bottom-left
+                _mm_stream_ps(reinterpret_cast<float *>(dstP++), src[2]); // Bottom-right
+                _mm_stream_ps(reinterpret_cast<float *>(dstP++), src[1]); // Top-right
             }
-        } else
+            break;
+
+        default:
+            break;
+        }
+        return;
+    }
 #endif // __SSE2__
-        {
-            for (int i = 0; i < count(); i++) {
-                const WindowQuad &quad = at(i);
 
-                for (int j = 0; j < 4; j++) {
-                    const WindowVertex &wv = quad[j];
+    switch (type)
+    {
+    case GL_QUADS:
+        for (const WindowQuad &quad : *this) {
+            for (int j = 0; j < 4; j++) {
+                const WindowVertex &wv = quad.verts[j];
 
-                    GLVertex2D v;
-                    v.position = QVector2D(wv.x(), wv.y());
-                    v.texcoord = QVector2D(wv.u(), wv.v()) * coeff + offset;
+                GLVertex2D v;
+                v.position = QVector2D(wv.px, wv.py);
+                v.texcoord = QVector2D(wv.tx, wv.ty) * coeff + offset;
 
-                    *(vertex++) = v;
-                }
+                *(vertex++) = v;
             }
         }
         break;
 
     case GL_TRIANGLES:
-#if defined(__SSE2__)
-        if (!(intptr_t(vertex) & 0xf)) {
-            for (int i = 0; i < count(); i++) {
-                const WindowQuad &quad = at(i);
-                alignas(16) GLVertex2D v[4];
-
-                for (int j = 0; j < 4; j++) {
-                    const WindowVertex &wv = quad[j];
+        for (const WindowQuad &quad : *this) {
+            GLVertex2D v[4]; // Four unique vertices / quad
 
-                    v[j].position = QVector2D(wv.x(), wv.y());
-                    v[j].texcoord = QVector2D(wv.u(), wv.v()) * coeff + offset;
-                }
-
-                const __m128i *srcP = reinterpret_cast<const __m128i *>(&v);
-                __m128i *dstP = reinterpret_cast<__m128i *>(vertex);
-
-                __m128i src[4];
-                src[0] = _mm_load_si128(&srcP[0]); // Top-left
-                src[1] = _mm_load_si128(&srcP[1]); // Top-right
-                src[2] = _mm_load_si128(&srcP[2]); // Bottom-right
-                src[3] = _mm_load_si128(&srcP[3]); // Bottom-left
-
-                // First triangle
-                _mm_stream_si128(&dstP[0], src[1]); // Top-right
-                _mm_stream_si128(&dstP[1], src[0]); // Top-left
-                _mm_stream_si128(&dstP[2], src[3]); // Bottom-left
+            for (int j = 0; j < 4; j++) {
+                const WindowVertex &wv = quad.verts[j];
 
-                // Second triangle
-                _mm_stream_si128(&dstP[3], src[3]); // Bottom-left
-                _mm_stream_si128(&dstP[4], src[2]); // Bottom-right
-                _mm_stream_si128(&dstP[5], src[1]); // Top-right
-
-                vertex += 6;
+                v[j].position = QVector2D(wv.px, wv.py);
+                v[j].texcoord = QVector2D(wv.tx, wv.ty) * coeff + offset;
             }
-        } else
-#endif // __SSE2__
-        {
-            for (int i = 0; i < count(); i++) {
-                const WindowQuad &quad = at(i);
-                GLVertex2D v[4]; // Four unique vertices / quad
-
-                for (int j = 0; j < 4; j++) {
-                    const WindowVertex &wv = quad[j];
 
-                    v[j].position = QVector2D(wv.x(), wv.y());
-                    v[j].texcoord = QVector2D(wv.u(), wv.v()) * coeff + offset;
-                }
+            // First triangle
+            *(vertex++) = v[1]; // Top-right
+            *(vertex++) = v[0]; // Top-left
+            *(vertex++) = v[3]; // Bottom-left
 
-                // First triangle
-                *(vertex++) = v[1]; // Top-right
-                *(vertex++) = v[0]; // Top-left
-                *(vertex++) = v[3]; // Bottom-left
-
-                // Second triangle
-                *(vertex++) = v[3]; // Bottom-left
-                *(vertex++) = v[2]; // Bottom-right
-                *(vertex++) = v[1]; // Top-right
-            }
+            // Second triangle
+            *(vertex++) = v[3]; // Bottom-left
+            *(vertex++) = v[2]; // Bottom-right
+            *(vertex++) = v[1]; // Top-right
         }
         break;
 
@@ -188,7 +188,7 @@ X-KDE-Library=kwin4_effect_cooleffect
 
 #define KWIN_EFFECT_API_MAKE_VERSION( major, minor ) (( major ) << 8 | ( minor ))
 #define KWIN_EFFECT_API_VERSION_MAJOR 0
-#define KWIN_EFFECT_API_VERSION_MINOR 229
+#define KWIN_EFFECT_API_VERSION_MINOR 232
 #define KWIN_EFFECT_API_VERSION KWIN_EFFECT_API_MAKE_VERSION( \
         KWIN_EFFECT_API_VERSION_MAJOR, KWIN_EFFECT_API_VERSION_MINOR )
 
@@ -544,6 +544,17 @@ public:
      */
     virtual bool isActive() const;
 
+    /**
+     * Overwrite this method to indicate whether your effect, while active, still allows the
+     * compositor to present the buffer of a fullscreen window directly on the output instead
+     * of compositing it. Return @c false only if the effect never changes how an opaque
+     * fullscreen window covering a whole output looks.
+     *
+     * The default implementation of this method returns @c true.
+     * @since 5.19
+     */
+    virtual bool blocksDirectScanout() const;
+
     /**
      * Reimplement this method to provide online debugging.
      * This could be as trivial as printing specific detail information about the effect state
@@ -2543,9 +2554,11 @@ public:
 private:
     friend class WindowQuad;
     friend class WindowQuadList;
-    double px, py; // position
-    double ox, oy; // origional position
-    double tx, ty; // texture coords
+    // Stored as floats to keep quads small, the position and the texture coordinates are
+    // next to each other so they can be loaded at once when building vertex arrays.
+    float px, py; // position
+    float tx, ty; // texture coords
+    float ox, oy; // origional position
 };
 
 /**
@@ -2585,8 +2598,13 @@ private:
     int quadID;
 };
 
+/**
+ * @short List of WindowQuads.
+ *
+ * The quads are stored contiguously, so building the vertex arrays walks linear memory.
+ */
 class KWINEFFECTS_EXPORT WindowQuadList
-    : public QList< WindowQuad >
+    : public QVector< WindowQuad >
 {
 public:
     WindowQuadList splitAtX(double x) const;
@@ -3793,20 +3811,20 @@ extern KWINEFFECTS_EXPORT EffectsHandler* effects;
 
 inline
 WindowVertex::WindowVertex()
-    : px(0), py(0), ox(0), oy(0), tx(0), ty(0)
+    : px(0), py(0), tx(0), ty(0), ox(0), oy(0)
 {
 }
 
 inline
 WindowVertex::WindowVertex(double _x, double _y, double _tx, double _ty)
-    : px(_x), py(_y), ox(_x), oy(_y), tx(_tx), ty(_ty)
+    : px(_x), py(_y), tx(_tx), ty(_ty), ox(_x), oy(_y)
 {
 }
 
 
 inline
 WindowVertex::WindowVertex(const QPointF &position, const QPointF &texturePosition)
-    : px(position.x()), py(position.y()), ox(position.x()), oy(position.y()), tx(texturePosition.x()), ty(texturePosition.y())
+    : px(position.x()), py(position.y()), tx(texturePosition.x()), ty(texturePosition.y()), ox(position.x()), oy(position.y())
 {
 }
 
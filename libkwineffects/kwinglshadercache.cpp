@@ -0,0 +1,188 @@
+/********************************************************************
+ KWin - the KDE window manager
+ This file is part of the KDE project.
+
+Copyright (C) 2020 The KWin developers <kwin@kde.org>
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*********************************************************************/
+#include "kwinglshadercache_p.h"
+#include "kwinglplatform.h"
+#include "kwinglutils.h"
+#include "logging_p.h"
+
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+namespace KWin
+{
+
+static const quint32 s_magic = 0x4b474c53; // KGLS
+static const quint32 s_version = 1;
+// binaries which were not loaded for this long belong to shaders which are gone
+static const int s_maxAgeDays = 30;
+
+GLShaderCache *GLShaderCache::s_instance = nullptr;
+
+GLShaderCache *GLShaderCache::instance()
+{
+    if (!s_instance) {
+        s_instance = new GLShaderCache();
+    }
+    return s_instance;
+}
+
+void GLShaderCache::cleanup()
+{
+    delete s_instance;
+    s_instance = nullptr;
+}
+
+GLShaderCache::GLShaderCache()
+{
+    if (qgetenv("KWIN_GL_SHADER_CACHE") == QByteArrayLiteral("0")) {
+        return;
+    }
+
+    GLPlatform *platform = GLPlatform::instance();
+    if (platform->isGLES() ? !hasGLVersion(3, 0)
+                           : !(hasGLVersion(4, 1) || hasGLExtension(QByteArrayLiteral("GL_ARB_get_program_binary")))) {
+        return;
+    }
+    GLint formats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    if (formats <= 0) {
+        return;
+    }
+
+    const QString cacheDirectory = QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation);
+    if (cacheDirectory.isEmpty()) {
+        return;
+    }
+
+    // Everything the driver could change the binary format with goes into the directory name.
+    QCryptographicHash driver(QCryptographicHash::Sha1);
+    driver.addData(platform->glVendorString());
+    driver.addData(platform->glRendererString());
+    driver.addData(platform->glVersionString());
+    driver.addData(platform->glShadingLanguageVersionString());
+    const QString driverName = QString::fromLatin1(driver.result().toHex());
+
+    QDir root(cacheDirectory + QStringLiteral("/kwin/glsl-program-binaries"));
+    if (!root.mkpath(driverName)) {
+        qCWarning(LIBKWINGLUTILS) << "Could not create the shader cache in" << root.path();
+        return;
+    }
+    m_directory = root.filePath(driverName);
+
+    // Only the binaries of this driver are cleaned up, the directories of other drivers may
+    // still be in use, e.g. by a session on another GPU.
+    const QDateTime expiry = QDateTime::currentDateTime().addDays(-s_maxAgeDays);
+    const QFileInfoList entries = QDir(m_directory).entryInfoList(QDir::Files);
+    for (const QFileInfo &entry : entries) {
+        if (entry.lastModified() < expiry) {
+            QFile::remove(entry.filePath());
+        }
+    }
+
+    m_enabled = true;
+}
+
+QByteArray GLShaderCache::key(const QByteArray &vertexSource, const QByteArray &fragmentSource, const QByteArray &bindings) const
+{
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(vertexSource);
+    hash.addData("\0", 1);
+    hash.addData(fragmentSource);
+    hash.addData("\0", 1);
+    hash.addData(bindings);
+    return hash.result().toHex();
+}
+
+QString GLShaderCache::filePath(const QByteArray &key) const
+{
+    return m_directory + QLatin1Char('/') + QString::fromLatin1(key);
+}
+
+bool GLShaderCache::load(GLuint program, const QByteArray &key)
+{
+    if (!m_enabled) {
+        return false;
+    }
+    QFile file(filePath(key));
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    QDataStream stream(&file);
+    quint32 magic = 0;
+    quint32 version = 0;
+    quint32 format = 0;
+    QByteArray binary;
+    stream >> magic >> version >> format >> binary;
+    if (stream.status() != QDataStream::Ok || magic != s_magic || version != s_version || binary.isEmpty()) {
+        file.remove();
+        return false;
+    }
+
+    glProgramBinary(program, format, binary.constData(), binary.size());
+    GLint status = 0;
+    glGetProgramiv(program, GL_LINK_STATUS, &status);
+    if (status == 0) {
+        // the driver may reject binaries at any time, the program gets compiled again then
+        qCDebug(LIBKWINGLUTILS) << "Discarding rejected shader program binary" << key;
+        file.remove();
+        return false;
+    }
+    // keep the binary from expiring while it is in use
+    const QDateTime now = QDateTime::currentDateTime();
+    if (file.fileTime(QFileDevice::FileModificationTime).daysTo(now) > 0) {
+        file.setFileTime(now, QFileDevice::FileModificationTime);
+    }
+    return true;
+}
+
+void GLShaderCache::store(GLuint program, const QByteArray &key)
+{
+    if (!m_enabled) {
+        return;
+    }
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0) {
+        return;
+    }
+    QByteArray binary(length, Qt::Uninitialized);
+    GLenum format = 0;
+    glGetProgramBinary(program, length, &length, &format, binary.data());
+    binary.resize(length);
+
+    // written to a temporary file first, so a crash never leaves a truncated binary behind
+    QSaveFile file(filePath(key));
+    if (!file.open(QIODevice::WriteOnly)) {
+        return;
+    }
+    QDataStream stream(&file);
+    stream << s_magic << s_version << quint32(format) << binary;
+    if (!file.commit()) {
+        qCWarning(LIBKWINGLUTILS) << "Could not write the shader program binary" << file.fileName();
+    }
+}
+
+}
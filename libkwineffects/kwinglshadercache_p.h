@@ -0,0 +1,82 @@
+/********************************************************************
+ KWin - the KDE window manager
+ This file is part of the KDE project.
+
+Copyright (C) 2020 The KWin developers <kwin@kde.org>
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*********************************************************************/
+#ifndef KWIN_GLSHADERCACHE_P_H
+#define KWIN_GLSHADERCACHE_P_H
+
+#include <QByteArray>
+#include <QString>
+#include <epoxy/gl.h>
+
+namespace KWin
+{
+
+/**
+ * @short On-disk cache of linked shader programs.
+ *
+ * Linked programs are stored with glGetProgramBinary and restored with glProgramBinary,
+ * so shaders don't need to be compiled again on later starts. The binaries are kept in a
+ * directory named after the GL vendor, renderer and version strings, so an updated driver
+ * never gets binaries of an old one. Binaries which have not been loaded for 30 days are
+ * removed from the directory of the current driver.
+ *
+ * The cache can be disabled by setting the environment variable KWIN_GL_SHADER_CACHE to 0.
+ */
+class GLShaderCache
+{
+public:
+    /**
+     * Requires a current OpenGL context.
+     */
+    static GLShaderCache *instance();
+    static void cleanup();
+
+    bool isEnabled() const {
+        return m_enabled;
+    }
+
+    /**
+     * Returns the key of a program built from the prepared @p vertexSource and
+     * @p fragmentSource with the attribute and fragment data @p bindings.
+     */
+    QByteArray key(const QByteArray &vertexSource, const QByteArray &fragmentSource, const QByteArray &bindings) const;
+
+    /**
+     * Loads the binary stored for @p key into @p program, returns @c false if there is none or
+     * the driver rejected it. The program is linked afterwards if this returns @c true.
+     */
+    bool load(GLuint program, const QByteArray &key);
+    /**
+     * Stores the binary of the linked @p program for @p key.
+     */
+    void store(GLuint program, const QByteArray &key);
+
+private:
+    GLShaderCache();
+    QString filePath(const QByteArray &key) const;
+
+    bool m_enabled = false;
+    QString m_directory;
+
+    static GLShaderCache *s_instance;
+};
+
+}
+
+#endif
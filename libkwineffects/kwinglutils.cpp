@@ -23,6 +23,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 // need to call GLTexturePrivate::initStatic()
 #include "kwingltexture_p.h"
+#include "kwinglshadercache_p.h"
 
 #include "kwineffects.h"
 #include "kwinglplatform.h"
@@ -86,6 +87,7 @@ void initGL(const std::function<resolveFuncPtr(const char*)> &resolveFunction)
 void cleanupGL()
 {
     ShaderManager::cleanup();
+    GLShaderCache::cleanup();
     GLTexturePrivate::cleanup();
     GLRenderTarget::cleanup();
     GLVertexBuffer::cleanup();
@@ -151,6 +153,7 @@ GLShader::GLShader(unsigned int flags)
     : mValid(false)
     , mLocationsResolved(false)
     , mExplicitLinking(flags & ExplicitLinking)
+    , mCompilePending(false)
 {
     mProgram = glCreateProgram();
 }
@@ -159,6 +162,7 @@ GLShader::GLShader(const QString& vertexfile, const QString& fragmentfile, unsig
     : mValid(false)
     , mLocationsResolved(false)
     , mExplicitLinking(flags & ExplicitLinking)
+    , mCompilePending(false)
 {
     mProgram = glCreateProgram();
     loadFromFiles(vertexfile, fragmentfile);
@@ -192,6 +196,34 @@ bool GLShader::loadFromFiles(const QString &vertexFile, const QString &fragmentF
 
 bool GLShader::link()
 {
+    // relinking may assign new locations
+    mUniformLocations.clear();
+    mLocationsResolved = false;
+
+    QByteArray cacheKey;
+    if (mCompilePending) {
+        mCompilePending = false;
+        GLShaderCache *cache = GLShaderCache::instance();
+        cacheKey = cache->key(prepareSource(GL_VERTEX_SHADER, mVertexSource),
+                              prepareSource(GL_FRAGMENT_SHADER, mFragmentSource),
+                              mBindings);
+        const QByteArray vertexSource = mVertexSource;
+        const QByteArray fragmentSource = mFragmentSource;
+        mVertexSource.clear();
+        mFragmentSource.clear();
+
+        if (cache->load(mProgram, cacheKey)) {
+            mValid = true;
+            return mValid;
+        }
+        if ((!vertexSource.isEmpty() && !compile(mProgram, GL_VERTEX_SHADER, vertexSource)) ||
+            (!fragmentSource.isEmpty() && !compile(mProgram, GL_FRAGMENT_SHADER, fragmentSource))) {
+            mValid = false;
+            return mValid;
+        }
+        glProgramParameteri(mProgram, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
+
     // Be optimistic
     mValid = true;
 
@@ -215,6 +247,10 @@ bool GLShader::link()
         qCDebug(LIBKWINGLUTILS) << "Shader link log:" << log;
     }
 
+    if (mValid && !cacheKey.isEmpty()) {
+        GLShaderCache::instance()->store(mProgram, cacheKey);
+    }
+
     return mValid;
 }
 
@@ -284,6 +320,17 @@ bool GLShader::load(const QByteArray &vertexSource, const QByteArray &fragmentSo
 
     mValid = false;
 
+    if (GLShaderCache::instance()->isEnabled()) {
+        // Compiling is deferred to link(), after the attribute locations are bound,
+        // as those are part of the cached program binary.
+        mVertexSource = vertexSource;
+        mFragmentSource = fragmentSource;
+        mCompilePending = true;
+        if (mExplicitLinking)
+            return true;
+        return link();
+    }
+
     // Compile the vertex shader
     if (!vertexSource.isEmpty()) {
         bool success = compile(mProgram, GL_VERTEX_SHADER, vertexSource);
@@ -310,10 +357,12 @@ bool GLShader::load(const QByteArray &vertexSource, const QByteArray &fragmentSo
 void GLShader::bindAttributeLocation(const char *name, int index)
 {
     glBindAttribLocation(mProgram, index, name);
+    mBindings += QByteArrayLiteral("attribute ") + name + ' ' + QByteArray::number(index) + ';';
 }
 
 void GLShader::bindFragDataLocation(const char *name, int index)
 {
+    mBindings += QByteArrayLiteral("fragdata ") + name + ' ' + QByteArray::number(index) + ';';
     if (!GLPlatform::instance()->isGLES() && (hasGLVersion(3, 0) || hasGLExtension(QByteArrayLiteral("GL_EXT_gpu_shader4"))))
         glBindFragDataLocation(mProgram, index, name);
 }
@@ -354,7 +403,14 @@ void GLShader::resolveLocations()
 
 int GLShader::uniformLocation(const char *name)
 {
+    // looked up without copying the name, it's only copied when inserted
+    const QByteArray key = QByteArray::fromRawData(name, qstrlen(name));
+    auto it = mUniformLocations.constFind(key);
+    if (it != mUniformLocations.constEnd()) {
+        return it.value();
+    }
     const int location = glGetUniformLocation(mProgram, name);
+    mUniformLocations.insert(QByteArray(name), location);
     return location;
 }
 
@@ -1748,6 +1804,7 @@ public:
         , bufferEnd(0)
         , mappedSize(0)
         , frameSize(0)
+        , lastFrameSize(0)
         , nextOffset(0)
         , baseAddress(0)
         , map(nullptr)
@@ -1802,6 +1859,7 @@ public:
     intptr_t bufferEnd;
     size_t mappedSize;
     size_t frameSize;
+    size_t lastFrameSize;
     intptr_t nextOffset;
     intptr_t baseAddress;
     uint8_t *map;
@@ -2237,8 +2295,12 @@ void GLVertexBuffer::reset()
 
 void GLVertexBuffer::endOfFrame()
 {
-    if (!d->persistent)
+    d->lastFrameSize = d->frameSize;
+
+    if (!d->persistent) {
+        d->frameSize = 0;
         return;
+    }
 
     // Emit a fence if we have uploaded data
     if (d->frameSize > 0) {
@@ -2280,6 +2342,16 @@ void GLVertexBuffer::framePosted()
     }
 }
 
+bool GLVertexBuffer::isPersistent() const
+{
+    return d->persistent;
+}
+
+size_t GLVertexBuffer::lastFrameSize() const
+{
+    return d->lastFrameSize;
+}
+
 void GLVertexBuffer::initStatic()
 {
     if (GLPlatform::instance()->isGLES()) {
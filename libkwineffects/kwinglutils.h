@@ -28,6 +28,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "kwingltexture.h"
 
 // Qt
+#include <QHash>
 #include <QSize>
 #include <QStack>
 
@@ -86,6 +87,13 @@ public:
 
     bool link();
 
+    /**
+     * Returns the location of the uniform @p name, which stays valid until the shader gets
+     * linked again. Effects setting uniforms in per window paths should resolve the
+     * locations once and use the setUniform overloads taking a location. The setUniform
+     * overloads taking a name look the location up in a per shader cache instead of
+     * querying OpenGL each time.
+     */
     int uniformLocation(const char* name);
 
     bool setUniform(const char* name, float value);
@@ -171,6 +179,12 @@ private:
     bool mValid:1;
     bool mLocationsResolved:1;
     bool mExplicitLinking:1;
+    bool mCompilePending:1;
+    // sources compiled in link(), unless the program is in the GLShaderCache
+    QByteArray mVertexSource;
+    QByteArray mFragmentSource;
+    QByteArray mBindings;
+    QHash<QByteArray, int> mUniformLocations;
     int mMatrixLocation[MatrixCount];
     int mVec2Location[Vec2UniformCount];
     int mVec4Location[Vec4UniformCount];
@@ -780,6 +794,18 @@ public:
      */
     void framePosted();
 
+    /**
+     * @returns whether the buffer is a persistently mapped ring buffer
+     * @since 5.19
+     */
+    bool isPersistent() const;
+
+    /**
+     * @returns the number of bytes streamed through the buffer in the last completed frame
+     * @since 5.19
+     */
+    size_t lastFrameSize() const;
+
     /**
      * @internal
      */
@@ -114,12 +114,14 @@ Options::Options(QObject *parent)
     , m_maxFpsInterval(Options::defaultMaxFpsInterval())
     , m_refreshRate(Options::defaultRefreshRate())
     , m_vBlankTime(Options::defaultVBlankTime())
+    , m_renderSafetyMargin(Options::defaultRenderSafetyMargin())
     , m_glStrictBinding(Options::defaultGlStrictBinding())
     , m_glStrictBindingFollowsDriver(Options::defaultGlStrictBindingFollowsDriver())
     , m_glCoreProfile(Options::defaultGLCoreProfile())
     , m_glPreferBufferSwap(Options::defaultGlPreferBufferSwap())
     , m_glPlatformInterface(Options::defaultGlPlatformInterface())
     , m_windowsBlockCompositing(true)
+    , m_glPixelUploadBufferSize(Options::defaultGlPixelUploadBufferSize())
     , OpTitlebarDblClick(Options::defaultOperationTitlebarDblClick())
     , CmdActiveTitlebar1(Options::defaultCommandActiveTitlebar1())
     , CmdActiveTitlebar2(Options::defaultCommandActiveTitlebar2())
@@ -634,6 +636,15 @@ void Options::setVBlankTime(qint64 vBlankTime)
     emit vBlankTimeChanged();
 }
 
+void Options::setRenderSafetyMargin(qint64 renderSafetyMargin)
+{
+    if (m_renderSafetyMargin == renderSafetyMargin) {
+        return;
+    }
+    m_renderSafetyMargin = renderSafetyMargin;
+    emit renderSafetyMarginChanged();
+}
+
 void Options::setGlStrictBinding(bool glStrictBinding)
 {
     if (m_glStrictBinding == glStrictBinding) {
@@ -670,6 +681,15 @@ void Options::setWindowsBlockCompositing(bool value)
     emit windowsBlockCompositingChanged();
 }
 
+void Options::setGlPixelUploadBufferSize(int size)
+{
+    if (m_glPixelUploadBufferSize == size) {
+        return;
+    }
+    m_glPixelUploadBufferSize = size;
+    emit glPixelUploadBufferSizeChanged();
+}
+
 void Options::setGlPreferBufferSwap(char glPreferBufferSwap)
 {
     if (glPreferBufferSwap == 'a') {
@@ -786,6 +806,7 @@ void Options::loadConfig()
     setMaxFpsInterval(1 * 1000 * 1000 * 1000 / config.readEntry("MaxFPS", Options::defaultMaxFps()));
     setRefreshRate(config.readEntry("RefreshRate", Options::defaultRefreshRate()));
     setVBlankTime(config.readEntry("VBlankTime", Options::defaultVBlankTime()) * 1000); // config in micro, value in nano resolution
+    setRenderSafetyMargin(config.readEntry("RenderSafetyMargin", Options::defaultRenderSafetyMargin()) * 1000); // config in micro, value in nano resolution
 
     // Modifier Only Shortcuts
     config = KConfigGroup(m_settings->config(), "ModifierOnlyShortcuts");
@@ -917,6 +938,7 @@ void Options::reloadCompositingSettings(bool force)
         setGlStrictBinding(config.readEntry("GLStrictBinding", Options::defaultGlStrictBinding()));
     }
     setGLCoreProfile(config.readEntry("GLCore", Options::defaultGLCoreProfile()));
+    setGlPixelUploadBufferSize(qMax(0, config.readEntry("GLPixelUploadBufferSize", Options::defaultGlPixelUploadBufferSize())));
 
     char c = 0;
     const QString s = config.readEntry("GLPreferBufferSwap", QString(Options::defaultGlPreferBufferSwap()));
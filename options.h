@@ -173,6 +173,11 @@ class KWIN_EXPORT Options : public QObject
     Q_PROPERTY(qint64 maxFpsInterval READ maxFpsInterval WRITE setMaxFpsInterval NOTIFY maxFpsIntervalChanged)
     Q_PROPERTY(uint refreshRate READ refreshRate WRITE setRefreshRate NOTIFY refreshRateChanged)
     Q_PROPERTY(qint64 vBlankTime READ vBlankTime WRITE setVBlankTime NOTIFY vBlankTimeChanged)
+    /**
+     * Time in nanoseconds the compositor keeps between the predicted end of painting a frame
+     * and the vblank it is meant for.
+     */
+    Q_PROPERTY(qint64 renderSafetyMargin READ renderSafetyMargin WRITE setRenderSafetyMargin NOTIFY renderSafetyMarginChanged)
     Q_PROPERTY(bool glStrictBinding READ isGlStrictBinding WRITE setGlStrictBinding NOTIFY glStrictBindingChanged)
     /**
      * Whether strict binding follows the driver or has been overwritten by a user defined config value.
@@ -184,6 +189,11 @@ class KWIN_EXPORT Options : public QObject
     Q_PROPERTY(GlSwapStrategy glPreferBufferSwap READ glPreferBufferSwap WRITE setGlPreferBufferSwap NOTIFY glPreferBufferSwapChanged)
     Q_PROPERTY(KWin::OpenGLPlatformInterface glPlatformInterface READ glPlatformInterface WRITE setGlPlatformInterface NOTIFY glPlatformInterfaceChanged)
     Q_PROPERTY(bool windowsBlockCompositing READ windowsBlockCompositing WRITE setWindowsBlockCompositing NOTIFY windowsBlockCompositingChanged)
+    /**
+     * The maximum amount of memory in MiB used for pixel buffer objects streaming the contents
+     * of shared memory client buffers to the GPU. @c 0 disables the streaming.
+     */
+    Q_PROPERTY(int glPixelUploadBufferSize READ glPixelUploadBufferSize WRITE setGlPixelUploadBufferSize NOTIFY glPixelUploadBufferSizeChanged)
 public:
 
     explicit Options(QObject *parent = nullptr);
@@ -557,6 +567,9 @@ public:
     qint64 vBlankTime() const {
         return m_vBlankTime;
     }
+    qint64 renderSafetyMargin() const {
+        return m_renderSafetyMargin;
+    }
     bool isGlStrictBinding() const {
         return m_glStrictBinding;
     }
@@ -580,6 +593,10 @@ public:
         return m_windowsBlockCompositing;
     }
 
+    int glPixelUploadBufferSize() const {
+        return m_glPixelUploadBufferSize;
+    }
+
     QStringList modifierOnlyDBusShortcut(Qt::KeyboardModifier mod) const;
 
     // setters
@@ -633,12 +650,14 @@ public:
     void setMaxFpsInterval(qint64 maxFpsInterval);
     void setRefreshRate(uint refreshRate);
     void setVBlankTime(qint64 vBlankTime);
+    void setRenderSafetyMargin(qint64 renderSafetyMargin);
     void setGlStrictBinding(bool glStrictBinding);
     void setGlStrictBindingFollowsDriver(bool glStrictBindingFollowsDriver);
     void setGLCoreProfile(bool glCoreProfile);
     void setGlPreferBufferSwap(char glPreferBufferSwap);
     void setGlPlatformInterface(OpenGLPlatformInterface interface);
     void setWindowsBlockCompositing(bool set);
+    void setGlPixelUploadBufferSize(int size);
 
     // default values
     static WindowOperation defaultOperationTitlebarDblClick() {
@@ -728,6 +747,9 @@ public:
     static uint defaultVBlankTime() {
         return 6000; // 6ms
     }
+    static uint defaultRenderSafetyMargin() {
+        return 1500; // 1.5ms
+    }
     static bool defaultGlStrictBinding() {
         return true;
     }
@@ -743,6 +765,9 @@ public:
     static OpenGLPlatformInterface defaultGlPlatformInterface() {
         return kwinApp()->shouldUseWaylandForCompositing() ? EglPlatformInterface : GlxPlatformInterface;
     }
+    static int defaultGlPixelUploadBufferSize() {
+        return 32; // MiB
+    }
     /**
      * Performs loading all settings except compositing related.
      */
@@ -809,12 +834,14 @@ Q_SIGNALS:
     void maxFpsIntervalChanged();
     void refreshRateChanged();
     void vBlankTimeChanged();
+    void renderSafetyMarginChanged();
     void glStrictBindingChanged();
     void glStrictBindingFollowsDriverChanged();
     void glCoreProfileChanged();
     void glPreferBufferSwapChanged();
     void glPlatformInterfaceChanged();
     void windowsBlockCompositingChanged();
+    void glPixelUploadBufferSizeChanged();
     void animationSpeedChanged();
 
     void configChanged();
@@ -853,12 +880,14 @@ private:
     // Settings that should be auto-detected
     uint m_refreshRate;
     qint64 m_vBlankTime;
+    qint64 m_renderSafetyMargin;
     bool m_glStrictBinding;
     bool m_glStrictBindingFollowsDriver;
     bool m_glCoreProfile;
     GlSwapStrategy m_glPreferBufferSwap;
     OpenGLPlatformInterface m_glPlatformInterface;
     bool m_windowsBlockCompositing;
+    int m_glPixelUploadBufferSize;
 
     WindowOperation OpTitlebarDblClick;
     WindowOperation opMaxButtonRightClick = defaultOperationMaxButtonRightClick();
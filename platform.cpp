@@ -191,6 +191,16 @@ AbstractOutput *Platform::findOutput(const QByteArray &uuid)
     return nullptr;
 }
 
+AbstractOutput *Platform::findOutput(int screen) const
+{
+    return enabledOutputs().value(screen);
+}
+
+int Platform::screenForOutput(const AbstractOutput *output) const
+{
+    return enabledOutputs().indexOf(const_cast<AbstractOutput *>(output));
+}
+
 void Platform::setSoftWareCursor(bool set)
 {
     if (qEnvironmentVariableIsSet("KWIN_FORCE_SW_CURSOR")) {
@@ -427,6 +427,15 @@ public:
         return Outputs();
     }
     AbstractOutput *findOutput(const QByteArray &uuid);
+    /**
+     * The output shown as screen @p screen, @c nullptr if there is none. The screens are
+     * the enabled outputs in their order, see OutputScreens.
+     */
+    AbstractOutput *findOutput(int screen) const;
+    /**
+     * The screen showing @p output, -1 if the output is not enabled.
+     */
+    int screenForOutput(const AbstractOutput *output) const;
 
     /**
      * A string of information to include in kwin debug output
@@ -19,6 +19,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 *********************************************************************/
 #include "abstract_egl_backend.h"
 #include "egl_dmabuf.h"
+#include "pixel_upload_ring.h"
 #include "texture.h"
 #include "composite.h"
 #include "egl_context_attribute_builder.h"
@@ -80,6 +81,8 @@ void AbstractEglBackend::unbindWaylandDisplay()
 
 void AbstractEglBackend::cleanup()
 {
+    delete m_pixelUploadRing;
+    m_pixelUploadRing = nullptr;
     cleanupGL();
     doneCurrent();
     eglDestroyContext(m_display, m_context);
@@ -176,6 +179,11 @@ void AbstractEglBackend::initWayland()
 
     Q_ASSERT(!m_dmaBuf);
     m_dmaBuf = EglDmabuf::factory(this);
+
+    Q_ASSERT(!m_pixelUploadRing);
+    if (options->glPixelUploadBufferSize() > 0 && PixelUploadRing::isSupported()) {
+        m_pixelUploadRing = new PixelUploadRing(size_t(options->glPixelUploadBufferSize()) * 1024 * 1024);
+    }
 }
 
 void AbstractEglBackend::initClientExtensions()
@@ -434,36 +442,97 @@ void AbstractEglTexture::updateTexture(WindowPixmap *pixmap)
         }
     }
     Q_ASSERT(image.size() == m_size);
-    q->bind();
     const QRegion damage = s->trackedDamage();
     s->resetTrackedDamage();
-    auto scale = s->scale(); //damage is normalised, so needs converting up to match texture
 
-    // TODO: this should be shared with GLTexture::update
-    if (GLPlatform::instance()->isGLES()) {
-        if (s_supportsARGB32 && (image.format() == QImage::Format_ARGB32 || image.format() == QImage::Format_ARGB32_Premultiplied)) {
-            const QImage im = image.convertToFormat(QImage::Format_ARGB32_Premultiplied);
-            for (const QRect &rect : damage) {
-                auto scaledRect = QRect(rect.x() * scale, rect.y() * scale, rect.width() * scale, rect.height() * scale);
-                glTexSubImage2D(m_target, 0, scaledRect.x(), scaledRect.y(), scaledRect.width(), scaledRect.height(),
-                                GL_BGRA_EXT, GL_UNSIGNED_BYTE, im.copy(scaledRect).bits());
-            }
+    // damage is normalised, so needs converting up to match texture
+    updateFromImage(image, damage, s->scale());
+}
+
+/**
+ * Uploading every damaged rect on its own is expensive when a client damages a lot of
+ * small areas, e.g. a terminal. Past this number of rects only the bounding rect is
+ * uploaded.
+ */
+static const int s_maxDamageUploads = 8;
+
+static QVector<QRect> uploadRects(const QRegion &damage, qreal scale, const QSize &size)
+{
+    const QRect imageRect(QPoint(0, 0), size);
+    QVector<QRect> rects;
+    auto append = [&rects, scale, imageRect] (const QRect &rect) {
+        const QRect scaledRect = QRect(rect.x() * scale, rect.y() * scale,
+                                       rect.width() * scale, rect.height() * scale) & imageRect;
+        if (!scaledRect.isEmpty()) {
+            rects << scaledRect;
+        }
+    };
+    if (damage.rectCount() > s_maxDamageUploads) {
+        append(damage.boundingRect());
+        return rects;
+    }
+    rects.reserve(damage.rectCount());
+    for (const QRect &rect : damage) {
+        append(rect);
+    }
+    return rects;
+}
+
+void AbstractEglTexture::updateFromImage(const QImage &image, const QRegion &damage, qreal scale)
+{
+    const QVector<QRect> rects = uploadRects(damage, scale, image.size());
+    if (rects.isEmpty()) {
+        return;
+    }
+
+    // Buffers which already have a layout matching the texture are uploaded straight
+    // from the client's memory without converting or copying them first.
+    GLenum glFormat = GL_BGRA;
+    QImage im;
+    if (!GLPlatform::instance()->isGLES()) {
+        // The texture of a Format_RGB32 buffer has no alpha channel, so the undefined
+        // alpha byte can be uploaded as it is.
+        if (image.format() == QImage::Format_ARGB32_Premultiplied || image.format() == QImage::Format_RGB32) {
+            im = image;
         } else {
-            const QImage im = image.convertToFormat(QImage::Format_RGBA8888_Premultiplied);
-            for (const QRect &rect : damage) {
-                auto scaledRect = QRect(rect.x() * scale, rect.y() * scale, rect.width() * scale, rect.height() * scale);
-                glTexSubImage2D(m_target, 0, scaledRect.x(), scaledRect.y(), scaledRect.width(), scaledRect.height(),
-                                GL_RGBA, GL_UNSIGNED_BYTE, im.copy(scaledRect).bits());
-            }
+            im = image.convertToFormat(QImage::Format_ARGB32_Premultiplied);
         }
+    } else if (s_supportsARGB32 && (image.format() == QImage::Format_ARGB32 || image.format() == QImage::Format_ARGB32_Premultiplied)) {
+        glFormat = GL_BGRA_EXT;
+        im = image.convertToFormat(QImage::Format_ARGB32_Premultiplied);
     } else {
-        const QImage im = image.convertToFormat(QImage::Format_ARGB32_Premultiplied);
-        for (const QRect &rect : damage) {
-            auto scaledRect = QRect(rect.x() * scale, rect.y() * scale, rect.width() * scale, rect.height() * scale);
-            glTexSubImage2D(m_target, 0, scaledRect.x(), scaledRect.y(), scaledRect.width(), scaledRect.height(),
-                            GL_BGRA, GL_UNSIGNED_BYTE, im.copy(scaledRect).bits());
+        glFormat = GL_RGBA;
+        im = image.convertToFormat(QImage::Format_RGBA8888_Premultiplied);
+    }
+
+    const int bytesPerPixel = 4;
+    const bool useUnpack = s_supportsUnpack && im.bytesPerLine() % bytesPerPixel == 0;
+    const bool tightlyPacked = im.bytesPerLine() == im.width() * bytesPerPixel;
+
+    q->bind();
+    // Prefer streaming through the pixel buffer ring, it returns before the GPU has read
+    // the data. When the ring is busy the pixels are uploaded from client memory.
+    PixelUploadRing *ring = m_backend->pixelUploadRing();
+    if (ring && ring->upload(m_target, im, rects, glFormat)) {
+        q->unbind();
+        return;
+    }
+    if (useUnpack) {
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, im.bytesPerLine() / bytesPerPixel);
+    }
+    for (const QRect &rect : rects) {
+        if (useUnpack || (tightlyPacked && rect.width() == im.width())) {
+            const uchar *data = im.constScanLine(rect.y()) + rect.x() * bytesPerPixel;
+            glTexSubImage2D(m_target, 0, rect.x(), rect.y(), rect.width(), rect.height(),
+                            glFormat, GL_UNSIGNED_BYTE, data);
+        } else {
+            glTexSubImage2D(m_target, 0, rect.x(), rect.y(), rect.width(), rect.height(),
+                            glFormat, GL_UNSIGNED_BYTE, im.copy(rect).constBits());
         }
     }
+    if (useUnpack) {
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    }
     q->unbind();
 }
 
@@ -660,8 +729,6 @@ bool AbstractEglTexture::updateFromFBO(const QSharedPointer<QOpenGLFramebufferOb
 
 bool AbstractEglTexture::updateFromInternalImageObject(WindowPixmap *pixmap)
 {
-    // FIXME: Share some code with the shm fallback in updateTexture().
-
     const QImage image = pixmap->internalImage();
     if (image.isNull()) {
         return false;
@@ -672,38 +739,7 @@ bool AbstractEglTexture::updateFromInternalImageObject(WindowPixmap *pixmap)
         return loadInternalImageObject(pixmap);
     }
 
-    const QRegion damage = pixmap->toplevel()->damage();
-    const qreal scale = image.devicePixelRatio();
-
-    q->bind();
-
-    // TODO: this should be shared with GLTexture::update
-    if (GLPlatform::instance()->isGLES()) {
-        if (s_supportsARGB32 && (image.format() == QImage::Format_ARGB32 || image.format() == QImage::Format_ARGB32_Premultiplied)) {
-            const QImage im = image.convertToFormat(QImage::Format_ARGB32_Premultiplied);
-            for (const QRect &rect : damage) {
-                auto scaledRect = QRect(rect.x() * scale, rect.y() * scale, rect.width() * scale, rect.height() * scale);
-                glTexSubImage2D(m_target, 0, scaledRect.x(), scaledRect.y(), scaledRect.width(), scaledRect.height(),
-                                GL_BGRA_EXT, GL_UNSIGNED_BYTE, im.copy(scaledRect).bits());
-            }
-        } else {
-            const QImage im = image.convertToFormat(QImage::Format_RGBA8888_Premultiplied);
-            for (const QRect &rect : damage) {
-                auto scaledRect = QRect(rect.x() * scale, rect.y() * scale, rect.width() * scale, rect.height() * scale);
-                glTexSubImage2D(m_target, 0, scaledRect.x(), scaledRect.y(), scaledRect.width(), scaledRect.height(),
-                                GL_RGBA, GL_UNSIGNED_BYTE, im.copy(scaledRect).bits());
-            }
-        }
-    } else {
-        const QImage im = image.convertToFormat(QImage::Format_ARGB32_Premultiplied);
-        for (const QRect &rect : damage) {
-            auto scaledRect = QRect(rect.x() * scale, rect.y() * scale, rect.width() * scale, rect.height() * scale);
-            glTexSubImage2D(m_target, 0, scaledRect.x(), scaledRect.y(), scaledRect.width(), scaledRect.height(),
-                            GL_BGRA, GL_UNSIGNED_BYTE, im.copy(scaledRect).bits());
-        }
-    }
-
-    q->unbind();
+    updateFromImage(image, pixmap->toplevel()->damage(), image.devicePixelRatio());
 
     return true;
 }
@@ -40,6 +40,7 @@ namespace KWin
 {
 
 class EglDmabuf;
+class PixelUploadRing;
 
 class KWIN_EXPORT AbstractEglBackend : public QObject, public OpenGLBackend
 {
@@ -61,6 +62,12 @@ public:
     EGLConfig config() const {
         return m_config;
     }
+    /**
+     * @returns the ring used to stream shared memory buffers, @c null if not available
+     */
+    PixelUploadRing *pixelUploadRing() const {
+        return m_pixelUploadRing;
+    }
 
 protected:
     AbstractEglBackend();
@@ -88,6 +95,7 @@ private:
     EGLConfig m_config = nullptr;
     QList<QByteArray> m_clientExtensions;
     EglDmabuf *m_dmaBuf = nullptr;
+    PixelUploadRing *m_pixelUploadRing = nullptr;
 };
 
 class KWIN_EXPORT AbstractEglTexture : public SceneOpenGLTexturePrivate
@@ -118,6 +126,7 @@ private:
     EGLImageKHR attach(const QPointer<KWayland::Server::BufferInterface> &buffer);
     bool updateFromFBO(const QSharedPointer<QOpenGLFramebufferObject> &fbo);
     bool updateFromInternalImageObject(WindowPixmap *pixmap);
+    void updateFromImage(const QImage &image, const QRegion &damage, qreal scale);
     SceneOpenGLTexture *q;
     AbstractEglBackend *m_backend;
     EGLImageKHR m_image;
@@ -103,6 +103,25 @@ bool OpenGLBackend::perScreenRendering() const
     return false;
 }
 
+bool OpenGLBackend::scanout(int screenId, KWayland::Server::SurfaceInterface *surface)
+{
+    Q_UNUSED(screenId)
+    Q_UNUSED(surface)
+    return false;
+}
+
+bool OpenGLBackend::supportsOverlayPlanes() const
+{
+    return false;
+}
+
+QVector<KWayland::Server::SurfaceInterface *> OpenGLBackend::assignOverlayPlanes(int screenId, const QVector<OverlayCandidate> &candidates)
+{
+    Q_UNUSED(screenId)
+    Q_UNUSED(candidates)
+    return QVector<KWayland::Server::SurfaceInterface *>();
+}
+
 void OpenGLBackend::copyPixels(const QRegion &region)
 {
     const int height = screens()->size().height();
@@ -23,9 +23,18 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <QElapsedTimer>
 #include <QRegion>
+#include <QVector>
 
 #include <kwin_export.h>
 
+namespace KWayland
+{
+namespace Server
+{
+class SurfaceInterface;
+}
+}
+
 namespace KWin
 {
 class OpenGLBackend;
@@ -91,6 +100,40 @@ public:
      */
     virtual bool perScreenRendering() const;
     virtual QRegion prepareRenderingForScreen(int screenId);
+    /**
+     * @brief Presents the current buffer of @p surface on screen @p screenId without compositing.
+     *
+     * Only called for per screen rendering, in place of prepareRenderingForScreen() and
+     * endRenderingFrameForScreen(). The surface covers the whole screen.
+     * Default implementation returns @c false.
+     *
+     * @return bool Whether the buffer is presented, if not the screen has to be composited
+     */
+    virtual bool scanout(int screenId, KWayland::Server::SurfaceInterface *surface);
+    /**
+     * @brief A surface which could be shown on an overlay plane instead of being composited.
+     */
+    struct OverlayCandidate {
+        KWayland::Server::SurfaceInterface *surface;
+        /**
+         * Where the surface's buffer is shown, in logical coordinates.
+         */
+        QRect geometry;
+    };
+    /**
+     * @brief Whether assignOverlayPlanes() can put surfaces on overlay planes.
+     * Default implementation returns @c false.
+     */
+    virtual bool supportsOverlayPlanes() const;
+    /**
+     * @brief Shows as many of @p candidates as possible on overlay planes of screen @p screenId.
+     *
+     * Only called for per screen rendering, before prepareRenderingForScreen(). The candidates
+     * are ordered from bottom to top and don't overlap. The assignment applies with the next
+     * frame on the screen, surfaces which are not returned have to be composited in it.
+     * Default implementation returns an empty list.
+     */
+    virtual QVector<KWayland::Server::SurfaceInterface *> assignOverlayPlanes(int screenId, const QVector<OverlayCandidate> &candidates);
     /**
      * @brief Compositor is going into idle mode, flushes any pending paints.
      */
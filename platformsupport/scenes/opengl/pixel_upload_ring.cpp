@@ -0,0 +1,198 @@
+/********************************************************************
+ KWin - the KDE window manager
+ This file is part of the KDE project.
+
+Copyright (C) 2020 The KWin developers <kwin@kde.org>
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*********************************************************************/
+#include "pixel_upload_ring.h"
+#include "logging.h"
+
+#include <kwinglplatform.h>
+#include <kwinglutils.h>
+
+#include <QImage>
+
+#include <cstring>
+
+namespace KWin
+{
+
+// Rows are copied with memcpy, keep every upload aligned for SSE
+static const int s_uploadAlignment = 16;
+
+template <typename T>
+static T align(T value, int bytes)
+{
+    return (value + bytes - 1) & ~T(bytes - 1);
+}
+
+PixelUploadRing::PixelUploadRing(size_t maxSize)
+    : m_maxSize(maxSize)
+{
+}
+
+PixelUploadRing::~PixelUploadRing()
+{
+    deleteFences();
+    if (m_buffer != 0) {
+        glDeleteBuffers(1, &m_buffer);
+    }
+}
+
+bool PixelUploadRing::isSupported()
+{
+    if (GLPlatform::instance()->isGLES()) {
+        return hasGLVersion(3, 0) && hasGLExtension(QByteArrayLiteral("GL_EXT_buffer_storage"));
+    }
+    return (hasGLVersion(4, 4) || hasGLExtension(QByteArrayLiteral("GL_ARB_buffer_storage"))) &&
+           (hasGLVersion(3, 2) || hasGLExtension(QByteArrayLiteral("GL_ARB_sync")));
+}
+
+void PixelUploadRing::deleteFences()
+{
+    for (const Fence &fence : m_fences) {
+        glDeleteSync(fence.sync);
+    }
+    m_fences.clear();
+}
+
+void PixelUploadRing::reallocate(size_t size)
+{
+    if (m_buffer != 0) {
+        // This also unmaps the buffer, pending uploads keep the old storage alive
+        glDeleteBuffers(1, &m_buffer);
+        m_buffer = 0;
+        m_map = nullptr;
+        deleteFences();
+    }
+
+    const size_t minSize = qMin<size_t>(4 * 1024 * 1024, m_maxSize);
+    m_bufferSize = qMin(align(qMax(size, minSize), 64 * 1024), m_maxSize);
+
+    const GLbitfield storage = GL_DYNAMIC_STORAGE_BIT;
+    const GLbitfield access = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+    glGenBuffers(1, &m_buffer);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_buffer);
+    glBufferStorage(GL_PIXEL_UNPACK_BUFFER, m_bufferSize, nullptr, storage | access);
+    m_map = static_cast<uint8_t *>(glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, m_bufferSize, access));
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    if (!m_map) {
+        qCWarning(KWIN_OPENGL) << "Failed to map the pixel upload buffer, uploading textures directly";
+        glDeleteBuffers(1, &m_buffer);
+        m_buffer = 0;
+        m_bufferSize = 0;
+        m_disabled = true;
+    }
+
+    m_nextOffset = 0;
+    m_bufferEnd = m_bufferSize;
+}
+
+uint8_t *PixelUploadRing::getIdleRange(size_t size)
+{
+    if (size > m_bufferSize) {
+        reallocate(size * 2);
+        if (size > m_bufferSize) {
+            return nullptr;
+        }
+    }
+
+    // Handle wrap-around
+    if (m_nextOffset + intptr_t(size) > intptr_t(m_bufferSize)) {
+        m_nextOffset = 0;
+        m_bufferEnd -= m_bufferSize;
+
+        for (Fence &fence : m_fences) {
+            fence.nextEnd -= m_bufferSize;
+        }
+
+        // Everything uploaded so far is from the previous lap
+        Fence fence;
+        fence.sync = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        fence.nextEnd = m_bufferSize;
+        m_fences.emplace_back(fence);
+    }
+
+    // Fences signal in order, so stop at the first one which is still pending
+    while (m_nextOffset + intptr_t(size) > m_bufferEnd) {
+        if (m_fences.empty()) {
+            return nullptr;
+        }
+        const Fence &fence = m_fences.front();
+        GLint status = GL_UNSIGNALED;
+        glGetSynciv(fence.sync, GL_SYNC_STATUS, 1, nullptr, &status);
+        if (status != GL_SIGNALED) {
+            return nullptr;
+        }
+        m_bufferEnd = fence.nextEnd;
+        glDeleteSync(fence.sync);
+        m_fences.pop_front();
+    }
+
+    return m_map + m_nextOffset;
+}
+
+bool PixelUploadRing::upload(GLenum target, const QImage &image, const QVector<QRect> &rects, GLenum format)
+{
+    const int bytesPerPixel = 4;
+    Q_ASSERT(image.depth() == bytesPerPixel * 8);
+
+    size_t size = 0;
+    for (const QRect &rect : rects) {
+        size += align<size_t>(size_t(rect.width()) * rect.height() * bytesPerPixel, s_uploadAlignment);
+    }
+    if (m_disabled || size == 0 || size > m_maxSize) {
+        return false;
+    }
+
+    uint8_t *map = getIdleRange(size);
+    if (!map) {
+        return false;
+    }
+
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_buffer);
+
+    intptr_t offset = m_nextOffset;
+    for (const QRect &rect : rects) {
+        const size_t rowSize = size_t(rect.width()) * bytesPerPixel;
+        uint8_t *dst = map + (offset - m_nextOffset);
+        if (rect.width() == image.width() && image.bytesPerLine() == int(rowSize)) {
+            std::memcpy(dst, image.constScanLine(rect.y()), rowSize * rect.height());
+        } else {
+            for (int y = 0; y < rect.height(); ++y) {
+                std::memcpy(dst + y * rowSize, image.constScanLine(rect.y() + y) + rect.x() * bytesPerPixel, rowSize);
+            }
+        }
+        glTexSubImage2D(target, 0, rect.x(), rect.y(), rect.width(), rect.height(),
+                        format, GL_UNSIGNED_BYTE, reinterpret_cast<const GLvoid *>(offset));
+        offset += align<size_t>(rowSize * rect.height(), s_uploadAlignment);
+    }
+
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    m_nextOffset = offset;
+
+    Fence fence;
+    fence.sync = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    fence.nextEnd = m_nextOffset + m_bufferSize;
+    m_fences.emplace_back(fence);
+
+    return true;
+}
+
+}
@@ -0,0 +1,94 @@
+/********************************************************************
+ KWin - the KDE window manager
+ This file is part of the KDE project.
+
+Copyright (C) 2020 The KWin developers <kwin@kde.org>
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*********************************************************************/
+#ifndef KWIN_SCENE_OPENGL_PIXEL_UPLOAD_RING_H
+#define KWIN_SCENE_OPENGL_PIXEL_UPLOAD_RING_H
+
+#include <QRect>
+#include <QVector>
+
+#include <epoxy/gl.h>
+
+#include <deque>
+
+class QImage;
+
+namespace KWin
+{
+
+/**
+ * @short Streams texture uploads through a persistently mapped pixel buffer object.
+ *
+ * The damaged pixels are copied into a ring buffer and the texture is updated from the
+ * buffer object, so the driver does not have to copy the client's memory before
+ * glTexSubImage2D returns. Every upload is followed by a fence; a range of the ring is
+ * only written again once the fence protecting it has signaled.
+ *
+ * The ring never waits for the GPU. If there is not enough idle space, upload() returns
+ * @c false and the caller is expected to upload the pixels directly. If the driver fails
+ * to map the buffer, the ring is disabled for the rest of the session.
+ *
+ * All methods must be called with the OpenGL context current.
+ */
+class PixelUploadRing
+{
+public:
+    /**
+     * @param maxSize The maximum size of the ring in bytes
+     */
+    explicit PixelUploadRing(size_t maxSize);
+    ~PixelUploadRing();
+
+    /**
+     * Uploads the @p rects of @p image into level 0 of the texture bound to @p target.
+     * The image must have four bytes per pixel and @p format has to describe its layout.
+     *
+     * @returns @c false if nothing was uploaded because the ring is busy or disabled
+     */
+    bool upload(GLenum target, const QImage &image, const QVector<QRect> &rects, GLenum format);
+
+    /**
+     * @returns whether the current context provides buffer storage and sync objects
+     */
+    static bool isSupported();
+
+private:
+    struct Fence {
+        GLsync sync;
+        intptr_t nextEnd;
+    };
+
+    uint8_t *getIdleRange(size_t size);
+    void reallocate(size_t size);
+    void deleteFences();
+
+    GLuint m_buffer = 0;
+    uint8_t *m_map = nullptr;
+    size_t m_maxSize;
+    size_t m_bufferSize = 0;
+    // set once mapping the buffer failed, trying again would fail every upload the same way
+    bool m_disabled = false;
+    intptr_t m_nextOffset = 0;
+    intptr_t m_bufferEnd = 0;
+    std::deque<Fence> m_fences;
+};
+
+}
+
+#endif
@@ -40,6 +40,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #endif
 // KWayland
 #include <KWayland/Server/seat_interface.h>
+#include <KWayland/Server/buffer_interface.h>
 // KF5
 #include <KConfigGroup>
 #include <KCoreAddons>
@@ -48,6 +49,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 // Qt
 #include <QCryptographicHash>
 #include <QSocketNotifier>
+#include <QTimer>
 #include <QPainter>
 // system
 #include <algorithm>
@@ -88,6 +90,7 @@ DrmBackend::DrmBackend(QObject *parent)
 DrmBackend::~DrmBackend()
 {
 #if HAVE_GBM
+    m_dmabufFramebuffers.clear();
     if (m_gbmDevice) {
         gbm_device_destroy(m_gbmDevice);
     }
@@ -98,6 +101,13 @@ DrmBackend::~DrmBackend()
             QCoreApplication::processEvents(QEventLoop::WaitForMoreEvents);
         }
 
+        for (DrmPlane *plane : qAsConst(m_planes)) {
+            if (plane->type() == DrmPlane::TypeIndex::Cursor) {
+                // the cursor buffers belong to the outputs
+                plane->setCurrent(nullptr);
+                plane->setNext(nullptr);
+            }
+        }
         qDeleteAll(m_planes);
         qDeleteAll(m_crtcs);
         qDeleteAll(m_connectors);
@@ -207,7 +217,10 @@ void DrmBackend::reactivate()
     // restart compositor
     m_pageFlipsPending = 0;
     if (Compositor *compositor = Compositor::self()) {
-        compositor->bufferSwapComplete();
+        if (m_swapPending) {
+            m_swapPending = false;
+            compositor->bufferSwapComplete();
+        }
         compositor->addRepaintFull();
     }
 }
@@ -218,7 +231,8 @@ void DrmBackend::deactivate()
         return;
     }
     // block compositor
-    if (m_pageFlipsPending == 0 && Compositor::self()) {
+    if (!m_swapPending && Compositor::self()) {
+        m_swapPending = true;
         Compositor::self()->aboutToSwapBuffers();
     }
     // hide cursor and disable
@@ -233,19 +247,39 @@ void DrmBackend::pageFlipHandler(int fd, unsigned int frame, unsigned int sec, u
 {
     Q_UNUSED(fd)
     Q_UNUSED(frame)
-    Q_UNUSED(sec)
-    Q_UNUSED(usec)
     auto output = reinterpret_cast<DrmOutput*>(data);
 
+    DrmBackend *backend = output->m_backend;
+    // a flip of the cursor plane alone tells nothing about the frames
+    const bool frameFlipped = !output->m_cursorCommitPending;
     output->pageFlipped();
-    output->m_backend->m_pageFlipsPending--;
-    if (output->m_backend->m_pageFlipsPending == 0) {
-        // TODO: improve, this currently means we wait for all page flips or all outputs.
-        // It would be better to driver the repaint per output
+    backend->m_pageFlipsPending--;
+    if (output->hasQueuedFrame() && !output->commitQueuedFrame()) {
+        // the frame was already counted as pending when it got queued
+        backend->m_pageFlipsPending--;
+    }
+    if (output->m_cursorPlaneDirty) {
+        // the cursor moved while the commit was pending
+        backend->scheduleCursorCommit();
+    }
 
-        if (Compositor::self()) {
-            Compositor::self()->bufferSwapComplete();
-        }
+    Compositor *compositor = Compositor::self();
+    if (!compositor) {
+        return;
+    }
+    if (backend->m_monotonicTimestamps && frameFlipped) {
+        compositor->notifyVBlank(backend->screenForOutput(output),
+                                 qint64(sec) * 1000 * 1000 * 1000 + qint64(usec) * 1000);
+    }
+    if (backend->m_swapPending) {
+        // The output is ready for a new frame again, let the compositor continue.
+        // Outputs which are still waiting for their page flip get their damage
+        // deferred until they are ready, see Compositor::performCompositing.
+        backend->m_swapPending = false;
+        compositor->bufferSwapComplete();
+    } else {
+        // Pick up the damage deferred for this output while the page flip was pending.
+        compositor->scheduleRepaint();
     }
 }
 
@@ -280,6 +314,10 @@ void DrmBackend::openDrm()
     );
     m_drmId = device->sysNum();
 
+    // the compositor schedules its frames against the page flip timestamps
+    uint64_t capability = 0;
+    m_monotonicTimestamps = drmGetCap(m_fd, DRM_CAP_TIMESTAMP_MONOTONIC, &capability) == 0 && capability;
+
     // trying to activate Atomic Mode Setting (this means also Universal Planes)
     if (!qEnvironmentVariableIsSet("KWIN_DRM_NO_AMS")) {
         if (drmSetClientCap(m_fd, DRM_CLIENT_CAP_ATOMIC, 1) == 0) {
@@ -505,6 +543,17 @@ void DrmBackend::updateOutputs()
     }
 }
 
+static DrmOutput::VrrPolicy vrrPolicyFromString(const QString &policy)
+{
+    if (policy == QLatin1String("Never")) {
+        return DrmOutput::VrrPolicy::Never;
+    }
+    if (policy == QLatin1String("Always")) {
+        return DrmOutput::VrrPolicy::Always;
+    }
+    return DrmOutput::VrrPolicy::Automatic;
+}
+
 void DrmBackend::readOutputsConfiguration()
 {
     if (m_outputs.isEmpty()) {
@@ -522,6 +571,7 @@ void DrmBackend::readOutputsConfiguration()
         // TODO: add mode
         if (outputConfig.hasKey("Scale"))
             (*it)->setScale(outputConfig.readEntry("Scale", 1.0));
+        (*it)->setVrrPolicy(vrrPolicyFromString(outputConfig.readEntry("VrrPolicy", QStringLiteral("Automatic"))));
         pos.setX(pos.x() + (*it)->geometry().width());
     }
 }
@@ -593,10 +643,7 @@ bool DrmBackend::present(DrmBuffer *buffer, DrmOutput *output)
     }
 
     if (output->present(buffer)) {
-        m_pageFlipsPending++;
-        if (m_pageFlipsPending == 1 && Compositor::self()) {
-            Compositor::self()->aboutToSwapBuffers();
-        }
+        pageFlipQueued();
         return true;
     } else if (m_deleteBufferAfterPageFlip) {
         delete buffer;
@@ -604,6 +651,45 @@ bool DrmBackend::present(DrmBuffer *buffer, DrmOutput *output)
     return false;
 }
 
+bool DrmBackend::scanout(DrmBuffer *buffer, DrmOutput *output)
+{
+    if (buffer->bufferId() != 0 && output->scanout(buffer)) {
+        pageFlipQueued();
+        return true;
+    }
+    delete buffer;
+    return false;
+}
+
+bool DrmBackend::presentOverlayPlanes(DrmOutput *output)
+{
+    if (output->presentOverlayPlanes()) {
+        pageFlipQueued();
+        return true;
+    }
+    return false;
+}
+
+void DrmBackend::pageFlipQueued()
+{
+    m_pageFlipsPending++;
+    // Only block the compositor once no output can take a new frame. As long as
+    // one output is ready it gets composited at its own refresh rate.
+    if (!m_swapPending && allOutputsFramePending() && Compositor::self()) {
+        m_swapPending = true;
+        Compositor::self()->aboutToSwapBuffers();
+    }
+}
+
+bool DrmBackend::allOutputsFramePending() const
+{
+    return std::all_of(m_enabledOutputs.constBegin(), m_enabledOutputs.constEnd(),
+        [] (DrmOutput *o) {
+            return o->isFramePending() || !o->isDpmsEnabled();
+        }
+    );
+}
+
 void DrmBackend::initCursor()
 {
 
@@ -659,6 +745,7 @@ void DrmBackend::setCursor()
                 setSoftWareCursor(true);
             }
         }
+        scheduleCursorCommit();
     }
     markCursorAsRendered();
 }
@@ -697,6 +784,7 @@ void DrmBackend::doHideCursor()
     for (auto it = m_outputs.constBegin(); it != m_outputs.constEnd(); ++it) {
         (*it)->hideCursor();
     }
+    scheduleCursorCommit();
 }
 
 void DrmBackend::moveCursor()
@@ -707,6 +795,50 @@ void DrmBackend::moveCursor()
     for (auto it = m_outputs.constBegin(); it != m_outputs.constEnd(); ++it) {
         (*it)->moveCursor(Cursor::pos());
     }
+    scheduleCursorCommit();
+}
+
+void DrmBackend::scheduleCursorCommit()
+{
+    if (!m_atomicModeSetting || m_cursorCommitScheduled) {
+        return;
+    }
+    m_cursorCommitScheduled = true;
+    QTimer::singleShot(0, this, &DrmBackend::commitCursors);
+}
+
+void DrmBackend::commitCursors()
+{
+    m_cursorCommitScheduled = false;
+    Compositor *compositor = Compositor::self();
+    if (compositor && compositor->isRepaintScheduled()) {
+        // A cursor commit of its own would hold back the frame until the next vblank
+        m_cursorCommitDeferred = true;
+        connect(compositor, &Compositor::compositingPassCompleted,
+                this, &DrmBackend::commitDeferredCursors, Qt::UniqueConnection);
+        return;
+    }
+    m_cursorCommitDeferred = false;
+    commitCursorPlanes();
+}
+
+void DrmBackend::commitDeferredCursors()
+{
+    if (!m_cursorCommitDeferred) {
+        return;
+    }
+    m_cursorCommitDeferred = false;
+    commitCursorPlanes();
+}
+
+void DrmBackend::commitCursorPlanes()
+{
+    for (DrmOutput *output : qAsConst(m_enabledOutputs)) {
+        // Outputs waiting for a page flip send the cursor along with their next commit
+        if (output->commitCursorPlane()) {
+            pageFlipQueued();
+        }
+    }
 }
 
 Screens *DrmBackend::createScreens(QObject *parent)
@@ -737,9 +869,9 @@ OpenGLBackend *DrmBackend::createOpenGLBackend()
 #endif
 }
 
-DrmDumbBuffer *DrmBackend::createBuffer(const QSize &size)
+DrmDumbBuffer *DrmBackend::createBuffer(const QSize &size, bool hasAlpha)
 {
-    DrmDumbBuffer *b = new DrmDumbBuffer(m_fd, size);
+    DrmDumbBuffer *b = new DrmDumbBuffer(m_fd, size, hasAlpha);
     return b;
 }
 
@@ -749,6 +881,22 @@ DrmSurfaceBuffer *DrmBackend::createBuffer(const std::shared_ptr<GbmSurface> &su
     DrmSurfaceBuffer *b = new DrmSurfaceBuffer(m_fd, surface);
     return b;
 }
+
+DrmDmabufBuffer *DrmBackend::createBuffer(KWayland::Server::BufferInterface *buffer)
+{
+    auto it = m_dmabufFramebuffers.find(buffer);
+    if (it == m_dmabufFramebuffers.end()) {
+        // a failed import is cached as well, the client buffer won't become scanout capable
+        it = m_dmabufFramebuffers.insert(buffer, std::make_shared<DrmDmabufBuffer::Framebuffer>(m_fd, m_gbmDevice, buffer));
+        connect(buffer, &KWayland::Server::BufferInterface::aboutToBeDestroyed, this,
+            [this, buffer] {
+                m_dmabufFramebuffers.remove(buffer);
+            }
+        );
+    }
+    DrmDmabufBuffer *b = new DrmDmabufBuffer(m_fd, it.value(), buffer);
+    return b;
+}
 #endif
 
 void DrmBackend::updateOutputsEnabled()
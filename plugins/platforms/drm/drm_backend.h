@@ -30,6 +30,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "drm_pointer.h"
 
 #include <QElapsedTimer>
+#include <QHash>
 #include <QImage>
 #include <QPointer>
 #include <QSize>
@@ -71,11 +72,23 @@ public:
     void init() override;
     void prepareShutdown() override;
 
-    DrmDumbBuffer *createBuffer(const QSize &size);
+    DrmDumbBuffer *createBuffer(const QSize &size, bool hasAlpha = false);
 #if HAVE_GBM
     DrmSurfaceBuffer *createBuffer(const std::shared_ptr<GbmSurface> &surface);
+    DrmDmabufBuffer *createBuffer(KWayland::Server::BufferInterface *buffer);
 #endif
     bool present(DrmBuffer *buffer, DrmOutput *output);
+    /**
+     * Presents the client @p buffer on the primary plane of @p output, if a test commit
+     * succeeds. Unlike present() a failure doesn't revert the output to its last working
+     * state. The buffer is deleted if it is not presented.
+     */
+    bool scanout(DrmBuffer *buffer, DrmOutput *output);
+    /**
+     * Commits the pending overlay plane changes of @p output for a frame without
+     * new composited content.
+     */
+    bool presentOverlayPlanes(DrmOutput *output);
 
     int fd() const {
         return m_fd;
@@ -159,12 +172,24 @@ private:
     void setCursor();
     void updateCursor();
     void moveCursor();
+    /**
+     * Commits the cursor planes once control returns to the event loop, so that all
+     * pointer motion processed until then ends up in one commit. If the compositor is
+     * about to paint, the cursor goes along with the frames and only outputs which didn't
+     * get one are committed after the compositing pass.
+     */
+    void scheduleCursorCommit();
+    void commitCursors();
+    void commitDeferredCursors();
+    void commitCursorPlanes();
     void initCursor();
     void readOutputsConfiguration();
     void writeOutputsConfiguration();
     QByteArray generateOutputConfigurationUuid() const;
     DrmOutput *findOutput(quint32 connector);
     void updateOutputsEnabled();
+    bool allOutputsFramePending() const;
+    void pageFlipQueued();
     QScopedPointer<Udev> m_udev;
     QScopedPointer<UdevMonitor> m_udevMonitor;
     int m_fd = -1;
@@ -181,8 +206,13 @@ private:
     bool m_deleteBufferAfterPageFlip;
     bool m_atomicModeSetting = false;
     bool m_cursorEnabled = false;
+    bool m_cursorCommitScheduled = false;
+    bool m_cursorCommitDeferred = false;
     QSize m_cursorSize;
+    bool m_monotonicTimestamps = false;
     int m_pageFlipsPending = 0;
+    // whether the Compositor is held back until the next page flip
+    bool m_swapPending = false;
     bool m_active = false;
     QByteArray m_devNode;
 #if HAVE_EGL_STREAMS
@@ -193,6 +223,10 @@ private:
     QVector<DrmPlane*> m_overlayPlanes;
     QScopedPointer<DpmsInputEventFilter> m_dpmsFilter;
     gbm_device *m_gbmDevice = nullptr;
+#if HAVE_GBM
+    // client buffers are imported once and dropped together with the client buffer
+    QHash<KWayland::Server::BufferInterface*, std::shared_ptr<DrmDmabufBuffer::Framebuffer>> m_dmabufFramebuffers;
+#endif
 };
 
 
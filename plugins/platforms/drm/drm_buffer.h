@@ -57,7 +57,11 @@ protected:
 class DrmDumbBuffer : public DrmBuffer
 {
 public:
-    DrmDumbBuffer(int fd, const QSize &size);
+    /**
+     * @param hasAlpha Whether the framebuffer is ARGB instead of XRGB, which matters for
+     * planes blending it with what is below them
+     */
+    DrmDumbBuffer(int fd, const QSize &size, bool hasAlpha = false);
     ~DrmDumbBuffer() override;
 
     bool needsModeChange(DrmBuffer *b) const override;
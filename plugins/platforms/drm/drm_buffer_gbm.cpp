@@ -21,16 +21,21 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "drm_buffer_gbm.h"
 #include "gbm_surface.h"
 
+#include "linux_dmabuf.h"
 #include "logging.h"
 
+#include <KWayland/Server/buffer_interface.h>
+
 // system
 #include <sys/mman.h>
 // c++
 #include <cerrno>
+#include <cstring>
 // drm
 #include <xf86drm.h>
 #include <xf86drmMode.h>
 #include <gbm.h>
+#include <drm_fourcc.h>
 
 namespace KWin
 {
@@ -66,4 +71,93 @@ void DrmSurfaceBuffer::releaseGbm()
     m_bo = nullptr;
 }
 
+// DrmDmabufBuffer
+DrmDmabufBuffer::Framebuffer::Framebuffer(int fd, gbm_device *device, KWayland::Server::BufferInterface *buffer)
+    : m_fd(fd)
+{
+    using namespace KWayland::Server;
+    auto *dmabuf = static_cast<DmabufBuffer *>(buffer->linuxDmabufBuffer());
+    const QVector<DmabufBuffer::Plane> &planes = dmabuf->planes();
+    if (planes.isEmpty() || planes.count() > 4) {
+        return;
+    }
+    m_size = dmabuf->size();
+    m_format = dmabuf->format();
+
+    gbm_import_fd_modifier_data importData = {};
+    importData.width = m_size.width();
+    importData.height = m_size.height();
+    importData.format = m_format;
+    importData.num_fds = planes.count();
+    importData.modifier = planes.first().modifier;
+    for (int i = 0; i < planes.count(); ++i) {
+        importData.fds[i] = planes[i].fd;
+        importData.strides[i] = planes[i].stride;
+        importData.offsets[i] = planes[i].offset;
+    }
+    m_bo = gbm_bo_import(device, GBM_BO_IMPORT_FD_MODIFIER, &importData, GBM_BO_USE_SCANOUT);
+    if (!m_bo) {
+        qCDebug(KWIN_DRM) << "Importing a client buffer failed:" << strerror(errno);
+        return;
+    }
+
+    uint32_t handles[4] = {};
+    uint32_t strides[4] = {};
+    uint32_t offsets[4] = {};
+    uint64_t modifiers[4] = {};
+    for (int i = 0; i < planes.count(); ++i) {
+        handles[i] = gbm_bo_get_handle_for_plane(m_bo, i).u32;
+        strides[i] = importData.strides[i];
+        offsets[i] = importData.offsets[i];
+        modifiers[i] = importData.modifier;
+    }
+    int ret;
+    if (importData.modifier != DRM_FORMAT_MOD_INVALID) {
+        ret = drmModeAddFB2WithModifiers(fd, m_size.width(), m_size.height(), m_format,
+                                         handles, strides, offsets, modifiers,
+                                         &m_id, DRM_MODE_FB_MODIFIERS);
+    } else {
+        ret = drmModeAddFB2(fd, m_size.width(), m_size.height(), m_format,
+                            handles, strides, offsets, &m_id, 0);
+    }
+    if (ret != 0) {
+        // not every client buffer can be scanned out, the caller composites it instead
+        qCDebug(KWIN_DRM) << "Creating a framebuffer for a client buffer failed:" << strerror(errno);
+        m_id = 0;
+    }
+}
+
+DrmDmabufBuffer::Framebuffer::~Framebuffer()
+{
+    if (m_id) {
+        drmModeRmFB(m_fd, m_id);
+    }
+    if (m_bo) {
+        gbm_bo_destroy(m_bo);
+    }
+}
+
+DrmDmabufBuffer::DrmDmabufBuffer(int fd, const std::shared_ptr<Framebuffer> &framebuffer, KWayland::Server::BufferInterface *buffer)
+    : DrmBuffer(fd)
+    , m_framebuffer(framebuffer)
+    , m_buffer(buffer)
+    , m_format(framebuffer->format())
+{
+    using namespace KWayland::Server;
+    m_buffer->ref();
+    m_bufferDestroyedConnection = QObject::connect(m_buffer.data(), &BufferInterface::aboutToBeDestroyed,
+                                                   m_buffer.data(), &BufferInterface::unref);
+    m_bufferId = m_framebuffer->id();
+    m_size = m_framebuffer->size();
+}
+
+DrmDmabufBuffer::~DrmDmabufBuffer()
+{
+    // the framebuffer is shared with the backend's cache and released with the last reference
+    if (m_buffer) {
+        QObject::disconnect(m_bufferDestroyedConnection);
+        m_buffer->unref();
+    }
+}
+
 }
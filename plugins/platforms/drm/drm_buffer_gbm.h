@@ -23,9 +23,20 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "drm_buffer.h"
 
+#include <QPointer>
+
 #include <memory>
 
 struct gbm_bo;
+struct gbm_device;
+
+namespace KWayland
+{
+namespace Server
+{
+class BufferInterface;
+}
+}
 
 namespace KWin
 {
@@ -61,6 +72,67 @@ private:
     gbm_bo *m_bo = nullptr;
 };
 
+/**
+ * Framebuffer for the linux-dmabuf buffer of a client, used to show the buffer on a
+ * plane without compositing. The client buffer is referenced for the lifetime of the
+ * framebuffer, so the client gets it released only once it is not scanned out anymore.
+ */
+class DrmDmabufBuffer : public DrmBuffer
+{
+public:
+    /**
+     * The framebuffer imported from the client buffer, shared by all DrmDmabufBuffers of
+     * the same client buffer. Clients cycle through a few buffers, so every buffer is only
+     * imported once instead of on every frame.
+     */
+    class Framebuffer
+    {
+    public:
+        Framebuffer(int fd, gbm_device *device, KWayland::Server::BufferInterface *buffer);
+        ~Framebuffer();
+
+        // 0 if the client buffer can't be scanned out
+        uint32_t id() const {
+            return m_id;
+        }
+        const QSize &size() const {
+            return m_size;
+        }
+        uint32_t format() const {
+            return m_format;
+        }
+
+    private:
+        int m_fd;
+        gbm_bo *m_bo = nullptr;
+        uint32_t m_id = 0;
+        QSize m_size;
+        uint32_t m_format = 0;
+    };
+
+    DrmDmabufBuffer(int fd, const std::shared_ptr<Framebuffer> &framebuffer, KWayland::Server::BufferInterface *buffer);
+    ~DrmDmabufBuffer() override;
+
+    bool needsModeChange(DrmBuffer *b) const override {
+        Q_UNUSED(b)
+        // only used with atomic mode setting
+        return false;
+    }
+
+    uint32_t format() const {
+        return m_format;
+    }
+    KWayland::Server::BufferInterface *clientBuffer() const {
+        return m_buffer;
+    }
+
+private:
+    std::shared_ptr<Framebuffer> m_framebuffer;
+    QPointer<KWayland::Server::BufferInterface> m_buffer;
+    QMetaObject::Connection m_bufferDestroyedConnection;
+    uint32_t m_format = 0;
+};
+
 }
 
 #endif
@@ -100,6 +100,13 @@ void DrmObject::setValue(int prop, uint64_t new_value)
     }
 }
 
+uint64_t DrmObject::value(int prop) const
+{
+    Q_ASSERT(prop < m_props.size());
+    auto property = m_props.at(prop);
+    return property ? property->value() : 0;
+}
+
 bool DrmObject::propHasEnum(int prop, uint64_t value) const
 {
     auto property = m_props.at(prop);
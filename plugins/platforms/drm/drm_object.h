@@ -72,6 +72,10 @@ public:
     virtual bool atomicPopulate(drmModeAtomicReq *req) const;
 
     void setValue(int prop, uint64_t new_value);
+    /**
+     * @returns the value of @p prop, @c 0 if the object doesn't have it
+     */
+    uint64_t value(int prop) const;
     bool propHasEnum(int prop, uint64_t value) const;
 
 protected:
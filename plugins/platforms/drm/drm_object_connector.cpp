@@ -51,6 +51,7 @@ bool DrmConnector::atomicInit()
 bool DrmConnector::initProps()
 {
     setPropertyNames( {
+        QByteArrayLiteral("vrr_capable"),
         QByteArrayLiteral("CRTC_ID"),
     });
 
@@ -69,6 +70,16 @@ bool DrmConnector::initProps()
     return true;
 }
 
+bool DrmConnector::atomicPopulate(drmModeAtomicReq *req) const
+{
+    return doAtomicPopulate(req, 1);
+}
+
+bool DrmConnector::isVrrCapable() const
+{
+    return value(int(PropertyIndex::VrrCapable)) == 1;
+}
+
 bool DrmConnector::isConnected()
 {
     DrmScopedPointer<drmModeConnector> con(drmModeGetConnector(fd(), m_id));
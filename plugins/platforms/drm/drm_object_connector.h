@@ -35,7 +35,8 @@ public:
     bool atomicInit() override;
 
     enum class PropertyIndex {
-        CrtcId = 0,
+        VrrCapable = 0,  // immutable, not populated
+        CrtcId,
         Count
     };
 
@@ -44,7 +45,12 @@ public:
     }
     
     bool initProps() override;
+    bool atomicPopulate(drmModeAtomicReq *req) const override;
     bool isConnected();
+    /**
+     * Whether the display supports adaptive sync, it can then be enabled on the CRTC.
+     */
+    bool isVrrCapable() const;
 
 
 private:
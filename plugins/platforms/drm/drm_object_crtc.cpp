@@ -40,6 +40,12 @@ DrmCrtc::DrmCrtc(uint32_t crtc_id, DrmBackend *backend, int resIndex)
 
 DrmCrtc::~DrmCrtc()
 {
+    if (m_pendingGammaBlob) {
+        drmModeDestroyPropertyBlob(fd(), m_pendingGammaBlob);
+    }
+    if (m_gammaBlob) {
+        drmModeDestroyPropertyBlob(fd(), m_gammaBlob);
+    }
 }
 
 bool DrmCrtc::atomicInit()
@@ -55,8 +61,11 @@ bool DrmCrtc::atomicInit()
 bool DrmCrtc::initProps()
 {
     setPropertyNames({
+        QByteArrayLiteral("GAMMA_LUT_SIZE"),
         QByteArrayLiteral("MODE_ID"),
         QByteArrayLiteral("ACTIVE"),
+        QByteArrayLiteral("VRR_ENABLED"),
+        QByteArrayLiteral("GAMMA_LUT"),
     });
 
     DrmScopedPointer<drmModeObjectProperties> properties(
@@ -74,6 +83,11 @@ bool DrmCrtc::initProps()
     return true;
 }
 
+bool DrmCrtc::atomicPopulate(drmModeAtomicReq *req) const
+{
+    return doAtomicPopulate(req, 1);
+}
+
 void DrmCrtc::flipBuffer()
 {
     if (m_currentBuffer && m_backend->deleteBufferAfterPageFlip() && m_currentBuffer != m_nextBuffer) {
@@ -125,4 +139,54 @@ bool DrmCrtc::setGammaRamp(const GammaRamp &gamma)
     return !isError;
 }
 
+bool DrmCrtc::stageGammaLut(const GammaRamp &gamma)
+{
+    QVector<drm_color_lut> lut(gamma.size());
+    for (uint32_t i = 0; i < gamma.size(); ++i) {
+        lut[i].red = gamma.red()[i];
+        lut[i].green = gamma.green()[i];
+        lut[i].blue = gamma.blue()[i];
+        lut[i].reserved = 0;
+    }
+    uint32_t blob = 0;
+    if (drmModeCreatePropertyBlob(fd(), lut.constData(), lut.size() * sizeof(drm_color_lut), &blob) != 0) {
+        qCWarning(KWIN_DRM) << "Failed to create gamma lut blob for crtc" << m_id;
+        return false;
+    }
+
+    // Test the lut on its own, once staged it goes along with every commit until one succeeds
+    bool ok = false;
+    if (drmModeAtomicReq *req = drmModeAtomicAlloc()) {
+        ok = drmModeAtomicAddProperty(req, m_id, m_props.at(int(PropertyIndex::GammaLut))->propId(), blob) > 0
+            && drmModeAtomicCommit(fd(), req, DRM_MODE_ATOMIC_TEST_ONLY, nullptr) == 0;
+        drmModeAtomicFree(req);
+    }
+    if (!ok) {
+        qCWarning(KWIN_DRM) << "Gamma lut rejected by crtc" << m_id;
+        drmModeDestroyPropertyBlob(fd(), blob);
+        return false;
+    }
+
+    if (m_pendingGammaBlob) {
+        // superseded before it made it to the screen
+        drmModeDestroyPropertyBlob(fd(), m_pendingGammaBlob);
+    }
+    m_pendingGammaBlob = blob;
+    setValue(int(PropertyIndex::GammaLut), blob);
+    return true;
+}
+
+void DrmCrtc::gammaLutCommitted()
+{
+    if (!m_pendingGammaBlob) {
+        return;
+    }
+    // the kernel holds on to the lut in use, the id is only needed to populate it again
+    if (m_gammaBlob) {
+        drmModeDestroyPropertyBlob(fd(), m_gammaBlob);
+    }
+    m_gammaBlob = m_pendingGammaBlob;
+    m_pendingGammaBlob = 0;
+}
+
 }
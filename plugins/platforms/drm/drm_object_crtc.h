@@ -40,12 +40,16 @@ public:
     bool atomicInit() override;
 
     enum class PropertyIndex {
-        ModeId = 0,
+        GammaLutSize = 0,  // immutable, not populated
+        ModeId,
         Active,
+        VrrEnabled,
+        GammaLut,
         Count
     };
 
     bool initProps() override;
+    bool atomicPopulate(drmModeAtomicReq *req) const override;
 
     int resIndex() const {
         return m_resIndex;
@@ -69,9 +73,49 @@ public:
     }
     bool setGammaRamp(const GammaRamp &gamma);
 
+    /**
+     * Whether the gamma can be set through the GAMMA_LUT property in atomic commits.
+     */
+    bool supportsGammaLut() const {
+        return m_props.at(int(PropertyIndex::GammaLut)) != nullptr;
+    }
+    int gammaLutSize() const {
+        return value(int(PropertyIndex::GammaLutSize));
+    }
+    /**
+     * Stages @p gamma as GAMMA_LUT, it is applied with the next atomic commit which
+     * includes the CRTC. Replaces a lut that is still pending. Returns @c false if the
+     * driver rejects the lut in a test commit.
+     */
+    bool stageGammaLut(const GammaRamp &gamma);
+    bool hasPendingGammaLut() const {
+        return m_pendingGammaBlob != 0;
+    }
+    /**
+     * Called after the pending lut got committed, the previous one is released.
+     */
+    void gammaLutCommitted();
+
+    /**
+     * Whether the driver can refresh the CRTC as soon as a frame arrives, if the
+     * connected display is capable of it.
+     */
+    bool supportsVrr() const {
+        return m_props.at(int(PropertyIndex::VrrEnabled)) != nullptr;
+    }
+    bool isVrrEnabled() const {
+        return value(int(PropertyIndex::VrrEnabled)) == 1;
+    }
+    void setVrrEnabled(bool enable) {
+        setValue(int(PropertyIndex::VrrEnabled), enable);
+    }
+
 private:
     int m_resIndex;
     uint32_t m_gammaRampSize = 0;
+    // the committed and the staged GAMMA_LUT blob, if created by us
+    uint32_t m_gammaBlob = 0;
+    uint32_t m_pendingGammaBlob = 0;
 
     DrmBuffer *m_currentBuffer = nullptr;
     DrmBuffer *m_nextBuffer = nullptr;
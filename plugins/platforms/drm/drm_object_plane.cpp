@@ -158,6 +158,31 @@ void DrmPlane::setNext(DrmBuffer *b)
     m_next = b;
 }
 
+void DrmPlane::setGeometry(uint32_t crtcId, const QRect &geometry)
+{
+    setValue(int(PropertyIndex::SrcX), 0);
+    setValue(int(PropertyIndex::SrcY), 0);
+    setValue(int(PropertyIndex::SrcW), uint64_t(geometry.width()) << 16);
+    setValue(int(PropertyIndex::SrcH), uint64_t(geometry.height()) << 16);
+    setValue(int(PropertyIndex::CrtcX), geometry.x());
+    setValue(int(PropertyIndex::CrtcY), geometry.y());
+    setValue(int(PropertyIndex::CrtcW), geometry.width());
+    setValue(int(PropertyIndex::CrtcH), geometry.height());
+    setValue(int(PropertyIndex::CrtcId), crtcId);
+}
+
+QRect DrmPlane::geometry() const
+{
+    return QRect(int(value(int(PropertyIndex::CrtcX))), int(value(int(PropertyIndex::CrtcY))),
+                 int(value(int(PropertyIndex::CrtcW))), int(value(int(PropertyIndex::CrtcH))));
+}
+
+void DrmPlane::disable()
+{
+    setNext(nullptr);
+    setGeometry(0, QRect());
+}
+
 void DrmPlane::setTransformation(Transformations t)
 {
     // TODO: When being pedantic, this should go through the enum mapping. Just remember
@@ -167,7 +192,7 @@ void DrmPlane::setTransformation(Transformations t)
     }
 }
 
-DrmPlane::Transformations DrmPlane::transformation()
+DrmPlane::Transformations DrmPlane::transformation() const
 {
     if (auto property = m_props.at(int(PropertyIndex::Rotation))) {
         return Transformations(int(property->value()));
@@ -175,6 +200,17 @@ DrmPlane::Transformations DrmPlane::transformation()
     return Transformations(Transformation::Rotate0);
 }
 
+bool DrmPlane::canScanout(uint32_t format, const QSize &size, const QSize &modeSize) const
+{
+    if (size != modeSize) {
+        return false;
+    }
+    if (transformation() != Transformations(Transformation::Rotate0)) {
+        return false;
+    }
+    return supportsFormat(format);
+}
+
 void DrmPlane::flipBuffer()
 {
     m_current = m_next;
@@ -21,6 +21,8 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "drm_object.h"
 
+#include <QRect>
+
 #include <xf86drmMode.h>
 
 namespace KWin
@@ -78,6 +80,15 @@ public:
     QVector<uint32_t> formats() const {
         return m_formats;
     }
+    /**
+     * Checks whether a framebuffer of @p format and @p size can be shown by this plane as is
+     * on a CRTC driving a mode of @p modeSize, that is without scaling, rotation or format
+     * conversion.
+     */
+    bool canScanout(uint32_t format, const QSize &size, const QSize &modeSize) const;
+    bool supportsFormat(uint32_t format) const {
+        return m_formats.contains(format);
+    }
 
     DrmBuffer *current() const {
         return m_current;
@@ -89,8 +100,20 @@ public:
         m_current = b;
     }
     void setNext(DrmBuffer *b);
+    /**
+     * Shows the next buffer unscaled in @p geometry of the CRTC @p crtcId, all sizes in pixels.
+     */
+    void setGeometry(uint32_t crtcId, const QRect &geometry);
+    /**
+     * The geometry on the CRTC as last set with setGeometry().
+     */
+    QRect geometry() const;
+    /**
+     * Removes the next buffer and detaches the plane from its CRTC.
+     */
+    void disable();
     void setTransformation(Transformations t);
-    Transformations transformation();
+    Transformations transformation() const;
 
     void flipBuffer();
     void flipBufferWithDelete();
@@ -105,7 +128,6 @@ private:
     DrmBuffer *m_current = nullptr;
     DrmBuffer *m_next = nullptr;
 
-    // TODO: See weston drm_output_check_plane_format for future use of these member variables
     QVector<uint32_t> m_formats;        // Possible formats, which can be presented on this plane
 
     // TODO: when using overlay planes in the future: restrict possible screens / crtcs of planes
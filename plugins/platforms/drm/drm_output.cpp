@@ -23,12 +23,14 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "drm_object_crtc.h"
 #include "drm_object_connector.h"
 
+#include "abstract_client.h"
 #include "composite.h"
 #include "logind.h"
 #include "logging.h"
 #include "main.h"
 #include "screens_drm.h"
 #include "wayland_server.h"
+#include "workspace.h"
 // KWayland
 #include <KWayland/Server/output_interface.h>
 // KF5
@@ -40,6 +42,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <QCryptographicHash>
 #include <QPainter>
 // c++
+#include <algorithm>
 #include <cerrno>
 // drm
 #include <xf86drm.h>
@@ -70,8 +73,18 @@ void DrmOutput::teardown()
     hideCursor();
     m_crtc->blank();
 
+    if (m_cursorPlane) {
+        m_cursorPlane->disable();
+        m_cursorPlane->setOutput(nullptr);
+    }
+
+    for (DrmPlane *plane : m_backend->overlayPlanes()) {
+        if (plane->output() == this) {
+            releaseOverlayPlane(plane);
+        }
+    }
+
     if (m_primaryPlane) {
-        // TODO: when having multiple planes, also clean up these
         m_primaryPlane->setOutput(nullptr);
 
         if (m_backend->deleteBufferAfterPageFlip()) {
@@ -103,11 +116,31 @@ void DrmOutput::releaseGbm()
 
 bool DrmOutput::hideCursor()
 {
+    if (m_cursorPlane) {
+        m_cursorPlaneBuffer = nullptr;
+        m_cursorPlaneDirty = true;
+        return true;
+    }
     return drmModeSetCursor(m_backend->fd(), m_crtc->id(), 0, 0, 0) == 0;
 }
 
 bool DrmOutput::showCursor(DrmDumbBuffer *c)
 {
+    if (m_cursorPlane) {
+        m_cursorPlaneBuffer = c;
+        m_cursorPlaneDirty = true;
+        if (m_modesetRequested || m_dpmsModePending != DpmsMode::On || !LogindIntegration::self()->isActiveSession()) {
+            // can't be tested now, a failing commit keeps the cursor hidden
+            return true;
+        }
+        updateCursorPlane(true);
+        if (!testPlanes({m_cursorPlane})) {
+            qCDebug(KWIN_DRM) << "Cursor plane" << m_cursorPlane->id() << "can't show the cursor";
+            m_cursorPlaneBuffer = nullptr;
+            return false;
+        }
+        return true;
+    }
     const QSize &s = c->size();
     return drmModeSetCursor(m_backend->fd(), m_crtc->id(), c->handle(), s.width(), s.height()) == 0;
 }
@@ -210,6 +243,12 @@ void DrmOutput::moveCursor(const QPoint &globalPos)
     }
     pos *= scale();
     pos -= hotspotMatrix.map(m_backend->softwareCursorHotspot());
+    if (m_cursorPlane) {
+        // DrmBackend commits the new position
+        m_cursorPlanePos = pos;
+        m_cursorPlaneDirty = true;
+        return;
+    }
     drmModeMoveCursor(m_backend->fd(), m_crtc->id(), pos.x(), pos.y());
 }
 
@@ -264,6 +303,10 @@ bool DrmOutput::init(drmModeConnector *connector)
         if (!initPrimaryPlane()) {
             return false;
         }
+        if (!qEnvironmentVariableIsSet("KWIN_DRM_NO_CURSOR_PLANE")) {
+            // without a cursor plane the legacy cursor ioctls are used
+            initCursorPlane();
+        }
     }
 
     setInternal(connector->connector_type == DRM_MODE_CONNECTOR_LVDS || connector->connector_type == DRM_MODE_CONNECTOR_eDP
@@ -423,7 +466,7 @@ bool DrmOutput::initPrimaryPlane()
     return false;
 }
 
-bool DrmOutput::initCursorPlane()       // TODO: Add call in init (but needs layer support in general first)
+bool DrmOutput::initCursorPlane()
 {
     for (int i = 0; i < m_backend->planes().size(); ++i) {
         DrmPlane* p = m_backend->planes()[i];
@@ -443,6 +486,8 @@ bool DrmOutput::initCursorPlane()       // TODO: Add call in init (but needs lay
             continue;
         }
         p->setOutput(this);
+        // the cursor image gets rotated when it is painted
+        p->setTransformation(DrmPlane::Transformation::Rotate0);
         m_cursorPlane = p;
         qCDebug(KWIN_DRM) << "Initialized cursor plane" << p->id() << "on CRTC" << m_crtc->id();
         return true;
@@ -453,7 +498,8 @@ bool DrmOutput::initCursorPlane()       // TODO: Add call in init (but needs lay
 bool DrmOutput::initCursor(const QSize &cursorSize)
 {
     auto createCursor = [this, cursorSize] (int index) {
-        m_cursor[index] = m_backend->createBuffer(cursorSize);
+        // the cursor plane blends the buffer with the planes below
+        m_cursor[index] = m_backend->createBuffer(cursorSize, true);
         if (!m_cursor[index]->map(QImage::Format_ARGB32_Premultiplied)) {
             return false;
         }
@@ -747,20 +793,25 @@ void DrmOutput::pageFlipped()
     }
     // Egl based surface buffers get destroyed, QPainter based dumb buffers not
     // TODO: split up DrmOutput in two for dumb and egl/gbm surface buffer compatible subclasses completely?
-    if (m_backend->deleteBufferAfterPageFlip()) {
+    if (m_cursorCommitPending) {
+        // only the cursor plane was updated
+        m_cursorCommitPending = false;
+    } else if (m_backend->deleteBufferAfterPageFlip()) {
         if (m_backend->atomicModeSetting()) {
-            if (!m_primaryPlane->next()) {
+            if (m_nextPlanesFlipList.isEmpty()) {
                 // on manual vt switch
-                // TODO: when we later use overlay planes it might happen, that we have a page flip with only
-                //       damage on one of these, and therefore the primary plane has no next buffer
-                //       -> Then we don't want to return here!
                 if (m_primaryPlane->current()) {
                     m_primaryPlane->current()->releaseGbm();
                 }
                 return;
             }
+            // The primary plane is not in the list if only overlay planes were updated
             for (DrmPlane *p : m_nextPlanesFlipList) {
                 p->flipBufferWithDelete();
+                if (p != m_primaryPlane && !p->current()) {
+                    // other outputs may use the plane again
+                    p->setOutput(nullptr);
+                }
             }
             m_nextPlanesFlipList.clear();
         } else {
@@ -789,6 +840,50 @@ void DrmOutput::pageFlipped()
     }
 }
 
+bool DrmOutput::isVrrActive() const
+{
+    return m_vrrActive;
+}
+
+void DrmOutput::setVrrPolicy(VrrPolicy policy)
+{
+    m_vrrPolicy = policy;
+}
+
+bool DrmOutput::isVrrCapable() const
+{
+    return m_backend->atomicModeSetting() && m_crtc && m_crtc->supportsVrr() && m_conn->isVrrCapable();
+}
+
+bool DrmOutput::wantsVrr() const
+{
+    if (!isVrrCapable()) {
+        return false;
+    }
+    switch (m_vrrPolicy) {
+    case VrrPolicy::Never:
+        return false;
+    case VrrPolicy::Always:
+        return true;
+    case VrrPolicy::Automatic: {
+        const AbstractClient *client = workspace() ? workspace()->activeClient() : nullptr;
+        return client && client->isFullScreen() && client->frameGeometry() == geometry();
+    }
+    }
+    Q_UNREACHABLE();
+    return false;
+}
+
+bool DrmOutput::isFramePending() const
+{
+    if (m_backend->atomicModeSetting()) {
+        // a cursor commit doesn't keep the output from taking a frame
+        return m_pageFlipPending && (!m_cursorCommitPending || m_frameQueued);
+    }
+    // In legacy mode the queued buffer is kept as next buffer on the crtc until the flip.
+    return m_crtc && m_crtc->next();
+}
+
 bool DrmOutput::present(DrmBuffer *buffer)
 {
     if (m_dpmsModePending != DpmsMode::On) {
@@ -805,7 +900,7 @@ bool DrmOutput::dpmsAtomicOff()
 {
     m_atomicOffPending = false;
 
-    // TODO: With multiple planes: deactivate all of them here
+    // overlay planes get disabled by atomicReqModesetPopulate()
     delete m_primaryPlane->next();
     m_primaryPlane->setNext(nullptr);
     m_nextPlanesFlipList << m_primaryPlane;
@@ -824,6 +919,210 @@ bool DrmOutput::dpmsAtomicOff()
     return true;
 }
 
+bool DrmOutput::scanout(DrmBuffer *buffer)
+{
+    // Modesets and DPMS changes are left to the composited path, which knows how to recover
+    if (!m_backend->atomicModeSetting() || m_modesetRequested || m_dpmsModePending != DpmsMode::On) {
+        return false;
+    }
+    if (!LogindIntegration::self()->isActiveSession() || m_pageFlipPending) {
+        return false;
+    }
+
+    if (!m_nextPlanesFlipList.isEmpty()) {
+        // overlay planes are waiting to be disabled, which has to happen in a composited frame
+        return false;
+    }
+
+    m_primaryPlane->setNext(buffer);
+    m_nextPlanesFlipList << m_primaryPlane;
+
+    // The error handler resets the primary plane and the flip list on failure
+    if (!doAtomicCommit(AtomicCommitMode::Test)) {
+        qCDebug(KWIN_DRM) << "Atomic test commit with a client buffer failed, compositing instead.";
+        return false;
+    }
+    if (!doAtomicCommit(AtomicCommitMode::Real)) {
+        qCDebug(KWIN_DRM) << "Atomic commit with a client buffer failed. This should have never happened!";
+        return false;
+    }
+    m_pageFlipPending = true;
+    return true;
+}
+
+QVector<bool> DrmOutput::assignOverlayPlanes(const QVector<DrmOverlayAssigner::Layer> &layers)
+{
+    QVector<bool> assigned(layers.count(), false);
+    if (!m_backend->atomicModeSetting() || !m_crtc || m_deleted) {
+        return assigned;
+    }
+
+    QVector<DrmPlane *> planes;
+    bool hasPlanes = false;
+    for (DrmPlane *plane : m_backend->overlayPlanes()) {
+        if (plane->output() == this) {
+            planes << plane;
+            hasPlanes = true;
+        } else if (!plane->output() && plane->isCrtcSupported(m_crtc->resIndex())) {
+            planes << plane;
+        }
+    }
+    if (planes.isEmpty() || (layers.isEmpty() && !hasPlanes)) {
+        return assigned;
+    }
+
+    // Without a test commit the layers are composited, planes in use get disabled
+    const bool canTest = !m_modesetRequested && m_dpmsModePending == DpmsMode::On &&
+                         !m_pageFlipPending && m_nextPlanesFlipList.isEmpty() &&
+                         LogindIntegration::self()->isActiveSession();
+    const DrmOverlayAssigner assigner(m_crtc->id(), planes);
+    const QVector<DrmPlane *> assignment = assigner.assign(canTest ? layers : QVector<DrmOverlayAssigner::Layer>(),
+        [this] (const QVector<DrmPlane *> &planes) {
+            return testPlanes(planes);
+        }
+    );
+
+    for (DrmPlane *plane : planes) {
+        if (plane->output() == this || assignment.contains(plane)) {
+            plane->setOutput(this);
+            if (!m_nextPlanesFlipList.contains(plane)) {
+                m_nextPlanesFlipList << plane;
+            }
+        }
+    }
+    for (int i = 0; i < assignment.count(); ++i) {
+        assigned[i] = assignment.at(i) != nullptr;
+    }
+    return assigned;
+}
+
+bool DrmOutput::presentOverlayPlanes()
+{
+    if (m_nextPlanesFlipList.isEmpty() || m_pageFlipPending || m_dpmsModePending != DpmsMode::On) {
+        return false;
+    }
+    if (!LogindIntegration::self()->isActiveSession()) {
+        return false;
+    }
+    // The error handler takes the overlay buffers back
+    if (!doAtomicCommit(AtomicCommitMode::Real)) {
+        qCDebug(KWIN_DRM) << "Atomic commit of the overlay planes failed.";
+        return false;
+    }
+    m_pageFlipPending = true;
+    return true;
+}
+
+bool DrmOutput::hasPendingOverlayPlanes() const
+{
+    return std::any_of(m_nextPlanesFlipList.constBegin(), m_nextPlanesFlipList.constEnd(),
+        [this] (DrmPlane *plane) {
+            return plane != m_primaryPlane;
+        }
+    );
+}
+
+bool DrmOutput::commitQueuedFrame()
+{
+    Q_ASSERT(m_frameQueued && !m_pageFlipPending);
+    m_frameQueued = false;
+
+    // The error handler resets the flip list, the buffer is ours since present() accepted it
+    DrmBuffer *buffer = m_primaryPlane->next();
+    if (m_deleted) {
+        m_primaryPlane->setNext(nullptr);
+        m_nextPlanesFlipList.clear();
+        if (m_backend->deleteBufferAfterPageFlip()) {
+            delete buffer;
+        }
+        return false;
+    }
+    if (!doAtomicCommit(AtomicCommitMode::Test) || !doAtomicCommit(AtomicCommitMode::Real)) {
+        qCDebug(KWIN_DRM) << "Atomic commit of the queued frame failed.";
+        if (m_backend->deleteBufferAfterPageFlip()) {
+            delete buffer;
+        }
+        if (Compositor *compositor = Compositor::self()) {
+            compositor->addRepaint(geometry());
+        }
+        return false;
+    }
+    m_pageFlipPending = true;
+    return true;
+}
+
+bool DrmOutput::commitCursorPlane()
+{
+    if (!m_cursorPlane || !m_cursorPlaneDirty || m_deleted) {
+        return false;
+    }
+    if (m_pageFlipPending || m_modesetRequested || m_dpmsModePending != DpmsMode::On) {
+        return false;
+    }
+    if (!LogindIntegration::self()->isActiveSession()) {
+        return false;
+    }
+    drmModeAtomicReq *req = drmModeAtomicAlloc();
+    if (!req) {
+        return false;
+    }
+    updateCursorPlane(true);
+    bool ret = m_cursorPlane->atomicPopulate(req);
+    if (ret && drmModeAtomicCommit(m_backend->fd(), req, DRM_MODE_ATOMIC_NONBLOCK | DRM_MODE_PAGE_FLIP_EVENT, this) != 0) {
+        qCDebug(KWIN_DRM) << "Atomic cursor commit failed:" << strerror(errno);
+        ret = false;
+    }
+    drmModeAtomicFree(req);
+    if (!ret) {
+        return false;
+    }
+    m_cursorPlaneDirty = false;
+    m_cursorCommitPending = true;
+    m_pageFlipPending = true;
+    return true;
+}
+
+void DrmOutput::updateCursorPlane(bool enable)
+{
+    if (enable && m_cursorPlaneBuffer) {
+        m_cursorPlane->setNext(m_cursorPlaneBuffer);
+        m_cursorPlane->setGeometry(m_crtc->id(), QRect(m_cursorPlanePos, m_cursorPlaneBuffer->size()));
+    } else {
+        m_cursorPlane->disable();
+    }
+}
+
+bool DrmOutput::testPlanes(const QVector<DrmPlane *> &planes) const
+{
+    drmModeAtomicReq *req = drmModeAtomicAlloc();
+    if (!req) {
+        return false;
+    }
+    bool ret = true;
+    for (DrmPlane *plane : planes) {
+        ret &= plane->atomicPopulate(req);
+    }
+    if (ret) {
+        ret = drmModeAtomicCommit(m_backend->fd(), req, DRM_MODE_ATOMIC_TEST_ONLY, nullptr) == 0;
+    }
+    drmModeAtomicFree(req);
+    return ret;
+}
+
+void DrmOutput::releaseOverlayPlane(DrmPlane *plane)
+{
+    if (m_backend->deleteBufferAfterPageFlip()) {
+        if (plane->next() != plane->current()) {
+            delete plane->next();
+        }
+        delete plane->current();
+    }
+    plane->setCurrent(nullptr);
+    plane->disable();
+    plane->setOutput(nullptr);
+    m_nextPlanesFlipList.removeOne(plane);
+}
+
 bool DrmOutput::presentAtomically(DrmBuffer *buffer)
 {
     if (!LogindIntegration::self()->isActiveSession()) {
@@ -832,6 +1131,13 @@ bool DrmOutput::presentAtomically(DrmBuffer *buffer)
     }
 
     if (m_pageFlipPending) {
+        if (m_cursorCommitPending && !m_frameQueued && !m_modesetRequested) {
+            // only the cursor is in flight, the frame follows with its page flip
+            m_primaryPlane->setNext(buffer);
+            m_nextPlanesFlipList << m_primaryPlane;
+            m_frameQueued = true;
+            return true;
+        }
         qCWarning(KWIN_DRM) << "Page not yet flipped.";
         return false;
     }
@@ -946,12 +1252,19 @@ bool DrmOutput::doAtomicCommit(AtomicCommitMode mode)
             }
         }
 
-        // TODO: see above, rework later for overlay planes!
         for (DrmPlane *p : m_nextPlanesFlipList) {
+            // The caller takes care of the primary plane's buffer, the overlay planes own theirs
+            if (p != m_primaryPlane && m_backend->deleteBufferAfterPageFlip() && p->next() != p->current()) {
+                delete p->next();
+            }
             p->setNext(nullptr);
+            if (p != m_primaryPlane && !p->current()) {
+                p->setOutput(nullptr);
+            }
         }
         m_nextPlanesFlipList.clear();
-
+        // A pending gamma lut stays staged, it passed a test of its own and goes
+        // along with the next commit
     };
 
     if (!req) {
@@ -962,6 +1275,12 @@ bool DrmOutput::doAtomicCommit(AtomicCommitMode mode)
 
     uint32_t flags = 0;
 
+    // The CRTC is populated by mode sets, otherwise only if the refresh mode or the gamma changes
+    const bool vrr = m_dpmsModePending == DpmsMode::On && wantsVrr();
+    if (m_crtc->supportsVrr()) {
+        m_crtc->setVrrEnabled(vrr);
+    }
+
     // Do we need to set a new mode?
     if (m_modesetRequested) {
         if (m_dpmsModePending == DpmsMode::On) {
@@ -1003,6 +1322,14 @@ bool DrmOutput::doAtomicCommit(AtomicCommitMode mode)
         DrmPlane *p = m_nextPlanesFlipList[i];
         ret &= p->atomicPopulate(req);
     }
+    if (m_cursorPlane) {
+        // Pending cursor changes go along, the cursor plane can't stay on a disabled crtc
+        updateCursorPlane(m_dpmsModePending == DpmsMode::On);
+        ret &= m_cursorPlane->atomicPopulate(req);
+    }
+    if ((vrr != m_vrrActive || m_crtc->hasPendingGammaLut()) && !(flags & DRM_MODE_ATOMIC_ALLOW_MODESET)) {
+        ret &= m_crtc->atomicPopulate(req);
+    }
 
     if (!ret) {
         qCWarning(KWIN_DRM) << "Failed to populate atomic planes. Abort atomic commit!";
@@ -1016,6 +1343,14 @@ bool DrmOutput::doAtomicCommit(AtomicCommitMode mode)
         return false;
     }
 
+    if (mode == AtomicCommitMode::Real) {
+        m_cursorPlaneDirty = false;
+        m_crtc->gammaLutCommitted();
+        if (vrr != m_vrrActive) {
+            qCDebug(KWIN_DRM) << "Variable refresh rate" << (vrr ? "enabled" : "disabled") << "on" << name();
+            m_vrrActive = vrr;
+        }
+    }
     if (mode == AtomicCommitMode::Real && (flags & DRM_MODE_ATOMIC_ALLOW_MODESET)) {
         qCDebug(KWIN_DRM) << "Atomic Modeset successful.";
         m_modesetRequested = false;
@@ -1060,6 +1395,15 @@ bool DrmOutput::atomicReqModesetPopulate(drmModeAtomicReq *req, bool enable)
     m_crtc->setValue(int(DrmCrtc::PropertyIndex::Active), enable);
 
     bool ret = true;
+    if (!enable) {
+        // overlay planes can't stay on a disabled crtc
+        for (DrmPlane *plane : m_backend->overlayPlanes()) {
+            if (plane->output() == this) {
+                releaseOverlayPlane(plane);
+                ret &= plane->atomicPopulate(req);
+            }
+        }
+    }
     ret &= m_conn->atomicPopulate(req);
     ret &= m_crtc->atomicPopulate(req);
 
@@ -1077,14 +1421,36 @@ bool DrmOutput::supportsTransformations() const
         || transformations.testFlag(DrmPlane::Transformation::Rotate270);
 }
 
+bool DrmOutput::hasAtomicGamma() const
+{
+#if HAVE_EGL_STREAMS
+    if (m_backend->useEglStreams()) {
+        // frames are flipped through EGL, a staged lut would wait for the next mode set
+        return false;
+    }
+#endif
+    return m_backend->atomicModeSetting() && m_crtc->supportsGammaLut();
+}
+
 int DrmOutput::gammaRampSize() const
 {
-    return m_crtc->gammaRampSize();
+    return hasAtomicGamma() ? m_crtc->gammaLutSize() : m_crtc->gammaRampSize();
 }
 
 bool DrmOutput::setGammaRamp(const GammaRamp &gamma)
 {
-    return m_crtc->setGammaRamp(gamma);
+    if (!hasAtomicGamma()) {
+        return m_crtc->setGammaRamp(gamma);
+    }
+    // Applied with the next frame instead of a blocking call of its own, so that all
+    // outputs change together with their content
+    if (!m_crtc->stageGammaLut(gamma)) {
+        return false;
+    }
+    if (Compositor *compositor = Compositor::self()) {
+        compositor->addRepaint(geometry());
+    }
+    return true;
 }
 
 }
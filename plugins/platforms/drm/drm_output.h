@@ -24,6 +24,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "drm_pointer.h"
 #include "drm_object.h"
 #include "drm_object_plane.h"
+#include "drm_overlay_assigner.h"
 #include "edid.h"
 
 #include <QObject>
@@ -58,7 +59,61 @@ public:
     void moveCursor(const QPoint &globalPos);
     bool init(drmModeConnector *connector);
     bool present(DrmBuffer *buffer);
+    /**
+     * Puts the client @p buffer on the primary plane, if a test commit with it succeeds.
+     * A failed test leaves the output as it is, the frame has to be composited instead.
+     */
+    bool scanout(DrmBuffer *buffer);
+    /**
+     * Puts @p layers on the overlay planes for the next commit, planes which are not needed
+     * anymore are disabled with it. The layers are ordered from bottom to top and must not
+     * overlap.
+     *
+     * @returns for every layer whether it is shown on a plane. The output takes over the
+     * buffers of those layers, the other buffers stay with the caller.
+     */
+    QVector<bool> assignOverlayPlanes(const QVector<DrmOverlayAssigner::Layer> &layers);
+    /**
+     * Commits the changes of the overlay planes without a new frame on the primary plane.
+     */
+    bool presentOverlayPlanes();
+    /**
+     * Whether a change of the overlay planes waits for a commit or for its page flip.
+     */
+    bool hasPendingOverlayPlanes() const;
+    /**
+     * Commits the changes of the cursor plane on their own, unless a commit is pending.
+     * Otherwise they go along with the next commit of the output.
+     */
+    bool commitCursorPlane();
+    /**
+     * Whether a frame waits for a cursor commit to complete. Frames presented while only
+     * the cursor is in flight are not held back, they get committed right after its page flip.
+     */
+    bool hasQueuedFrame() const {
+        return m_frameQueued;
+    }
+    bool commitQueuedFrame();
     void pageFlipped();
+    bool isFramePending() const override;
+    bool isVrrActive() const override;
+
+    /**
+     * When the output uses a variable refresh rate, if it is capable of it.
+     */
+    enum class VrrPolicy {
+        Never,
+        Always,
+        /**
+         * While a fullscreen window is active on the output, e.g. a game or a video.
+         */
+        Automatic
+    };
+    VrrPolicy vrrPolicy() const {
+        return m_vrrPolicy;
+    }
+    void setVrrPolicy(VrrPolicy policy);
+    bool isVrrCapable() const;
 
     // These values are defined by the kernel
     enum class DpmsMode {
@@ -111,6 +166,13 @@ private:
         Real
     };
     bool doAtomicCommit(AtomicCommitMode mode);
+    /**
+     * Test commit of the next state of @p planes, nothing else is changed.
+     */
+    bool testPlanes(const QVector<DrmPlane *> &planes) const;
+    void updateCursorPlane(bool enable);
+    bool wantsVrr() const;
+    void releaseOverlayPlane(DrmPlane *plane);
 
     bool presentLegacy(DrmBuffer *buffer);
     bool setModeLegacy(DrmBuffer *buffer);
@@ -142,6 +204,10 @@ private:
 
     int gammaRampSize() const override;
     bool setGammaRamp(const GammaRamp &gamma) override;
+    /**
+     * Whether the gamma ramp goes along with the atomic commits of the frames.
+     */
+    bool hasAtomicGamma() const;
     QMatrix4x4 matrixDisplay(const QSize &s) const;
 
     DrmBackend *m_backend;
@@ -173,6 +239,14 @@ private:
     DrmDumbBuffer *m_cursor[2] = {nullptr, nullptr};
     int m_cursorIndex = 0;
     bool m_hasNewCursor = false;
+    // the state of the cursor plane, if the output has one
+    DrmDumbBuffer *m_cursorPlaneBuffer = nullptr;
+    QPoint m_cursorPlanePos;
+    bool m_cursorPlaneDirty = false;
+    bool m_cursorCommitPending = false;
+    bool m_frameQueued = false;
+    VrrPolicy m_vrrPolicy = VrrPolicy::Automatic;
+    bool m_vrrActive = false;
     bool m_deleted = false;
 };
 
@@ -0,0 +1,67 @@
+/********************************************************************
+ KWin - the KDE window manager
+ This file is part of the KDE project.
+
+Copyright (C) 2020 The KWin developers <kwin@kde.org>
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*********************************************************************/
+#include "drm_overlay_assigner.h"
+#include "drm_buffer.h"
+#include "drm_object_plane.h"
+
+namespace KWin
+{
+
+DrmOverlayAssigner::DrmOverlayAssigner(uint32_t crtcId, const QVector<DrmPlane *> &planes)
+    : m_crtcId(crtcId)
+    , m_planes(planes)
+{
+}
+
+QVector<DrmPlane *> DrmOverlayAssigner::assign(const QVector<Layer> &layers, const TestFunction &test) const
+{
+    QVector<DrmPlane *> assignment(layers.count(), nullptr);
+
+    // Start from no overlays at all, so every test only sees the layers assigned so far
+    for (DrmPlane *plane : m_planes) {
+        plane->disable();
+    }
+
+    QVector<DrmPlane *> freePlanes = m_planes;
+    for (int i = 0; i < layers.count() && !freePlanes.isEmpty(); ++i) {
+        const Layer &layer = layers.at(i);
+        if (!layer.buffer || layer.buffer->bufferId() == 0 || layer.geometry.isEmpty()) {
+            continue;
+        }
+        for (auto it = freePlanes.begin(); it != freePlanes.end(); ++it) {
+            DrmPlane *plane = *it;
+            if (!plane->supportsFormat(layer.format)) {
+                continue;
+            }
+            plane->setNext(layer.buffer);
+            plane->setGeometry(m_crtcId, layer.geometry);
+            plane->setTransformation(DrmPlane::Transformation::Rotate0);
+            if (test(m_planes)) {
+                assignment[i] = plane;
+                freePlanes.erase(it);
+                break;
+            }
+            plane->disable();
+        }
+    }
+    return assignment;
+}
+
+}
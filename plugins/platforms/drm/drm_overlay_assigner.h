@@ -0,0 +1,79 @@
+/********************************************************************
+ KWin - the KDE window manager
+ This file is part of the KDE project.
+
+Copyright (C) 2020 The KWin developers <kwin@kde.org>
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*********************************************************************/
+#ifndef KWIN_DRM_OVERLAY_ASSIGNER_H
+#define KWIN_DRM_OVERLAY_ASSIGNER_H
+
+#include <QRect>
+#include <QVector>
+
+#include <functional>
+
+namespace KWin
+{
+
+class DrmBuffer;
+class DrmPlane;
+
+/**
+ * @short Distributes client buffers over the overlay planes of a CRTC.
+ *
+ * Every layer is tried on the free planes which support its format, one after the other.
+ * Whether the hardware can show a configuration is decided by the test function, which is
+ * expected to perform an atomic test commit of the passed planes. A layer which fails on
+ * every plane is left to the compositor.
+ *
+ * Overlay planes are stacked above the primary plane, so the layers must not be covered by
+ * anything which is composited.
+ */
+class DrmOverlayAssigner
+{
+public:
+    struct Layer {
+        DrmBuffer *buffer;
+        uint32_t format;
+        /**
+         * Where the buffer is shown on the CRTC, in pixels. The buffer has the same size.
+         */
+        QRect geometry;
+    };
+    using TestFunction = std::function<bool(const QVector<DrmPlane *> &planes)>;
+
+    /**
+     * @param crtcId The CRTC the planes are put on
+     * @param planes The overlay planes which may be used on that CRTC
+     */
+    DrmOverlayAssigner(uint32_t crtcId, const QVector<DrmPlane *> &planes);
+
+    /**
+     * Assigns @p layers to the planes. The next state of every plane is changed, planes
+     * without a layer get disabled.
+     *
+     * @returns for every layer the plane it is shown on, @c nullptr if it has to be composited
+     */
+    QVector<DrmPlane *> assign(const QVector<Layer> &layers, const TestFunction &test) const;
+
+private:
+    uint32_t m_crtcId;
+    QVector<DrmPlane *> m_planes;
+};
+
+}
+
+#endif
@@ -21,13 +21,20 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 // kwin
 #include "composite.h"
 #include "drm_backend.h"
+#include "drm_buffer_gbm.h"
 #include "drm_output.h"
+#include "drm_object_plane.h"
 #include "gbm_surface.h"
+#include "linux_dmabuf.h"
 #include "logging.h"
 #include "options.h"
 #include "screens.h"
 // kwin libs
 #include <kwinglplatform.h>
+// KWayland
+#include <KWayland/Server/buffer_interface.h>
+#include <KWayland/Server/output_interface.h>
+#include <KWayland/Server/surface_interface.h>
 // Qt
 #include <QOpenGLContext>
 // system
@@ -485,12 +492,19 @@ void EglGbmBackend::setViewport(const Output &output) const
 
 QRegion EglGbmBackend::prepareRenderingForScreen(int screenId)
 {
-    const Output &output = m_outputs.at(screenId);
+    Output &output = m_outputs[screenId];
 
     makeContextCurrent(output);
     prepareRenderFramebuffer(output);
     setViewport(output);
 
+    if (output.directScanout) {
+        // The screen showed a client buffer, the back buffer has to be painted completely
+        output.directScanout = false;
+        output.damageHistory.clear();
+        return output.output->geometry();
+    }
+
     if (supportsBufferAge()) {
         QRegion region;
 
@@ -520,7 +534,8 @@ void EglGbmBackend::endRenderingFrameForScreen(int screenId,
     Output &output = m_outputs[screenId];
     renderFramebufferToSurface(output);
 
-    if (damagedRegion.intersected(output.output->geometry()).isEmpty() && screenId == 0) {
+    const QRegion outputDamage = damagedRegion.intersected(output.output->geometry());
+    if (outputDamage.isEmpty()) {
 
         // If the damaged region of a window is fully occluded, the only
         // rendering done, if any, will have been to repair a reused back
@@ -528,31 +543,162 @@ void EglGbmBackend::endRenderingFrameForScreen(int screenId,
         //
         // In this case we won't post the back buffer. Instead we'll just
         // set the buffer age to 1, so the repaired regions won't be
-        // rendered again in the next frame.
+        // rendered again in the next frame. Other outputs are not affected,
+        // they keep running at their own pace.
         if (!renderedRegion.intersected(output.output->geometry()).isEmpty())
             glFlush();
 
-        for (auto &output: m_outputs) {
-            output.bufferAge = 1;
-        }
+        output.bufferAge = 1;
+        // overlay planes may still have changed
+        m_backend->presentOverlayPlanes(output.output);
         return;
     }
     presentOnOutput(output);
 
     // Save the damaged region to history
-    // Note: damage history is only collected for the first screen. For any other screen full
-    // repaints are triggered. This is due to a limitation in Scene::paintGenericScreen which resets
-    // the Toplevel's repaint. So multiple calls to Scene::paintScreen as it's done in multi-output
-    // rendering only have correct damage information for the first screen. If we try to track
-    // damage nevertheless, it creates artifacts. So for the time being we work around the problem
-    // by only supporting buffer age on the first output. To properly support buffer age on all
-    // outputs the rendering needs to be refactored in general.
-    if (supportsBufferAge() && screenId == 0) {
+    // The Compositor passes the complete damage including the window repaints to every
+    // output, so the damage history is valid for each output on its own.
+    if (supportsBufferAge()) {
         if (output.damageHistory.count() > 10) {
             output.damageHistory.removeLast();
         }
-        output.damageHistory.prepend(damagedRegion.intersected(output.output->geometry()));
+        output.damageHistory.prepend(outputDamage);
+    }
+}
+
+bool EglGbmBackend::scanout(int screenId, KWayland::Server::SurfaceInterface *surface)
+{
+    static const bool s_disabled = qEnvironmentVariableIntValue("KWIN_DRM_NO_DIRECT_SCANOUT") != 0;
+    if (s_disabled) {
+        return false;
+    }
+    Output &output = m_outputs[screenId];
+    if (output.render.framebuffer || output.output->transform() != DrmOutput::Transform::Normal) {
+        // the output is rotated in software
+        return false;
+    }
+    KWayland::Server::BufferInterface *buffer = surface->buffer();
+    if (!buffer || !buffer->linuxDmabufBuffer()) {
+        return false;
+    }
+    auto *dmabuf = static_cast<DmabufBuffer *>(buffer->linuxDmabufBuffer());
+    if (dmabuf->flags()) {
+        // the buffer is inverted or interlaced
+        return false;
+    }
+    if (surface->transform() != KWayland::Server::OutputInterface::Transform::Normal) {
+        // the primary plane can't rotate or flip the buffer like the client asked for
+        return false;
+    }
+    const DrmPlane *primaryPlane = output.output->primaryPlane();
+    if (!primaryPlane || !primaryPlane->canScanout(dmabuf->format(), dmabuf->size(), output.output->modeSize())) {
+        return false;
+    }
+
+    if (!m_backend->scanout(m_backend->createBuffer(buffer), output.output)) {
+        return false;
+    }
+    output.directScanout = true;
+    return true;
+}
+
+bool EglGbmBackend::supportsOverlayPlanes() const
+{
+    static const bool s_disabled = qEnvironmentVariableIntValue("KWIN_DRM_NO_OVERLAY_PLANES") != 0;
+    return !s_disabled && m_backend->atomicModeSetting() && !m_backend->overlayPlanes().isEmpty();
+}
+
+QVector<KWayland::Server::SurfaceInterface *> EglGbmBackend::assignOverlayPlanes(int screenId, const QVector<OverlayCandidate> &candidates)
+{
+    Output &output = m_outputs[screenId];
+    QVector<OverlayLayer> overlayLayers;
+    QVector<uint32_t> formats;
+    // the planes are put on the crtc as is, software rotation would need them rotated as well
+    if (!output.render.framebuffer && output.output->transform() == DrmOutput::Transform::Normal) {
+        const QRect outputGeometry = output.output->geometry();
+        const qreal scale = output.output->scale();
+        for (const OverlayCandidate &candidate : candidates) {
+            KWayland::Server::BufferInterface *buffer = candidate.surface->buffer();
+            if (!buffer || !buffer->linuxDmabufBuffer()) {
+                continue;
+            }
+            auto *dmabuf = static_cast<DmabufBuffer *>(buffer->linuxDmabufBuffer());
+            if (dmabuf->flags() || candidate.geometry.size() * scale != dmabuf->size()) {
+                // the buffer is inverted, interlaced or scaled
+                continue;
+            }
+            if (candidate.surface->transform() != KWayland::Server::OutputInterface::Transform::Normal) {
+                // the plane would show the buffer without the client's rotation or flip
+                continue;
+            }
+            const QRect geometry((candidate.geometry.topLeft() - outputGeometry.topLeft()) * scale, dmabuf->size());
+            overlayLayers << OverlayLayer{candidate.surface, buffer, geometry};
+            formats << dmabuf->format();
+        }
+    }
+
+    if (overlayPlanesUnchanged(output, overlayLayers)) {
+        // The planes still show these buffers, neither imports nor test commits are needed
+        QVector<KWayland::Server::SurfaceInterface *> ret;
+        for (int i = 0; i < overlayLayers.count(); ++i) {
+            if (output.overlays.assigned.at(i)) {
+                ret << overlayLayers.at(i).surface;
+            }
+        }
+        return ret;
+    }
+
+    QVector<DrmOverlayAssigner::Layer> layers;
+    layers.reserve(overlayLayers.count());
+    for (int i = 0; i < overlayLayers.count(); ++i) {
+        const OverlayLayer &layer = overlayLayers.at(i);
+        layers << DrmOverlayAssigner::Layer{m_backend->createBuffer(layer.buffer), formats.at(i), layer.geometry};
+    }
+
+    const QVector<bool> assigned = output.output->assignOverlayPlanes(layers);
+    QVector<KWayland::Server::SurfaceInterface *> ret;
+    for (int i = 0; i < layers.count(); ++i) {
+        if (assigned.at(i)) {
+            ret << overlayLayers.at(i).surface;
+        } else {
+            delete layers.at(i).buffer;
+        }
+    }
+    output.overlays.layers = overlayLayers;
+    output.overlays.assigned = assigned;
+    return ret;
+}
+
+bool EglGbmBackend::overlayPlanesUnchanged(const Output &output, const QVector<OverlayLayer> &layers) const
+{
+    if (output.overlays.layers != layers || output.output->hasPendingOverlayPlanes()) {
+        return false;
+    }
+    // A failed commit or another output may have taken the planes meanwhile, so the
+    // assigned layers have to be on the planes of this output, and nothing else.
+    int shown = 0;
+    for (DrmPlane *plane : m_backend->overlayPlanes()) {
+        if (plane->output() != output.output) {
+            continue;
+        }
+        auto *buffer = static_cast<DrmDmabufBuffer *>(plane->current());
+        if (!buffer) {
+            return false;
+        }
+        bool found = false;
+        for (int i = 0; i < layers.count(); ++i) {
+            if (output.overlays.assigned.at(i) && layers.at(i).buffer == buffer->clientBuffer()
+                    && layers.at(i).geometry == plane->geometry()) {
+                found = true;
+                break;
+            }
+        }
+        if (!found) {
+            return false;
+        }
+        shown++;
     }
+    return shown == output.overlays.assigned.count(true);
 }
 
 bool EglGbmBackend::usesOverlayWindow() const
@@ -50,6 +50,9 @@ public:
     bool usesOverlayWindow() const override;
     bool perScreenRendering() const override;
     QRegion prepareRenderingForScreen(int screenId) override;
+    bool scanout(int screenId, KWayland::Server::SurfaceInterface *surface) override;
+    bool supportsOverlayPlanes() const override;
+    QVector<KWayland::Server::SurfaceInterface *> assignOverlayPlanes(int screenId, const QVector<OverlayCandidate> &candidates) override;
     void init() override;
 
 protected:
@@ -61,16 +64,36 @@ private:
     bool initBufferConfigs();
     bool initRenderingContext();
     void initRemotePresent();
+    struct OverlayLayer {
+        KWayland::Server::SurfaceInterface *surface;
+        KWayland::Server::BufferInterface *buffer;
+        // in pixels of the output
+        QRect geometry;
+        bool operator==(const OverlayLayer &other) const {
+            return surface == other.surface && buffer == other.buffer && geometry == other.geometry;
+        }
+    };
     struct Output {
         DrmOutput *output = nullptr;
         DrmBuffer *buffer = nullptr;
         std::shared_ptr<GbmSurface> gbmSurface;
         EGLSurface eglSurface = EGL_NO_SURFACE;
         int bufferAge = 0;
+        /**
+         * @brief Whether the output shows a client buffer instead of the surface's front buffer.
+         */
+        bool directScanout = false;
         /**
          * @brief The damage history for the past 10 frames.
          */
         QList<QRegion> damageHistory;
+        /**
+         * @brief The overlay candidates of the last assignment, whether they got a plane.
+         */
+        struct {
+            QVector<OverlayLayer> layers;
+            QVector<bool> assigned;
+        } overlays;
 
         struct {
             GLuint framebuffer = 0;
@@ -94,6 +117,7 @@ private:
     void renderFramebufferToSurface(Output &output);
 
     void presentOnOutput(Output &output);
+    bool overlayPlanesUnchanged(const Output &output, const QVector<OverlayLayer> &layers) const;
 
     void removeOutput(DrmOutput *drmOutput);
     void cleanupOutput(Output &output);
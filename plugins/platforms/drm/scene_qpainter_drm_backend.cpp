@@ -103,6 +103,10 @@ QImage *DrmQPainterBackend::buffer()
 QImage *DrmQPainterBackend::bufferForScreen(int screenId)
 {
     const Output &o = m_outputs.at(screenId);
+    if (o.output->isFramePending()) {
+        // the back buffer is still queued for scanout, painting is deferred
+        return nullptr;
+    }
     return o.buffer[o.index]->image();
 }
 
@@ -114,6 +118,9 @@ bool DrmQPainterBackend::needsFullRepaint() const
 void DrmQPainterBackend::prepareRenderingFrame()
 {
     for (auto it = m_outputs.begin(); it != m_outputs.end(); ++it) {
+        if ((*it).output->isFramePending()) {
+            continue;
+        }
         (*it).index = ((*it).index + 1) % 2;
     }
 }
@@ -127,6 +134,9 @@ void DrmQPainterBackend::present(int mask, const QRegion &damage)
     }
     for (auto it = m_outputs.begin(); it != m_outputs.end(); ++it) {
         const Output &o = *it;
+        if (o.output->isFramePending()) {
+            continue;
+        }
         m_backend->present(o.buffer[o.index], o.output);
     }
 }
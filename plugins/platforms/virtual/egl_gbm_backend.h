@@ -21,8 +21,11 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #define KWIN_EGL_GBM_BACKEND_H
 #include "abstract_egl_backend.h"
 
+#include <QScopedPointer>
+
 namespace KWin
 {
+class FrameCapture;
 class VirtualBackend;
 class GLTexture;
 class GLRenderTarget;
@@ -52,7 +55,7 @@ private:
     VirtualBackend *m_backend;
     GLTexture *m_backBuffer = nullptr;
     GLRenderTarget *m_fbo = nullptr;
-    int m_frameCounter = 0;
+    QScopedPointer<FrameCapture> m_frameCapture;
     friend class EglGbmTexture;
 };
 
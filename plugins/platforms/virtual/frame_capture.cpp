@@ -0,0 +1,274 @@
+/********************************************************************
+ KWin - the KDE window manager
+ This file is part of the KDE project.
+
+Copyright (C) 2020 The KWin developers <kwin@kde.org>
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*********************************************************************/
+#include "frame_capture.h"
+#include <logging.h>
+
+#include <kwinglplatform.h>
+#include <kwinglutils.h>
+
+#include <QFile>
+#include <QThread>
+#include <QtConcurrentRun>
+
+namespace KWin
+{
+
+// Frames being read back at the same time, the GPU is a few frames behind at most
+static const int s_readbackCount = 3;
+
+static void convertFromGLRow(uint *pixels, int width)
+{
+    if (QSysInfo::ByteOrder == QSysInfo::BigEndian) {
+        // OpenGL gives RGBA; Qt wants ARGB
+        for (int x = 0; x < width; ++x) {
+            pixels[x] = (pixels[x] >> 8) | (pixels[x] << 24);
+        }
+    } else {
+        // OpenGL gives ABGR (i.e. RGBA backwards); Qt wants ARGB
+        for (int x = 0; x < width; ++x) {
+            const uint pixel = pixels[x];
+            pixels[x] = ((pixel << 16) & 0xff0000) | ((pixel >> 16) & 0xff) | (pixel & 0xff00ff00);
+        }
+    }
+}
+
+static bool writeRaw(const QImage &image, bool flipped, QFile &file)
+{
+    const qint64 rowSize = image.width() * 4;
+    for (int y = 0; y < image.height(); ++y) {
+        const int row = flipped ? image.height() - 1 - y : y;
+        if (file.write(reinterpret_cast<const char *>(image.constScanLine(row)), rowSize) != rowSize) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool writePpm(const QImage &image, bool flipped, QFile &file)
+{
+    const QByteArray header = QByteArrayLiteral("P6\n") + QByteArray::number(image.width()) + ' ' +
+                              QByteArray::number(image.height()) + QByteArrayLiteral("\n255\n");
+    if (file.write(header) != header.size()) {
+        return false;
+    }
+    QByteArray row(image.width() * 3, Qt::Uninitialized);
+    for (int y = 0; y < image.height(); ++y) {
+        const QRgb *src = reinterpret_cast<const QRgb *>(image.constScanLine(flipped ? image.height() - 1 - y : y));
+        char *dst = row.data();
+        for (int x = 0; x < image.width(); ++x) {
+            *dst++ = qRed(src[x]);
+            *dst++ = qGreen(src[x]);
+            *dst++ = qBlue(src[x]);
+        }
+        if (file.write(row) != row.size()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void writeFrame(QImage image, bool fromGL, bool bgra, const QString &path, VirtualBackend::FrameFormat format)
+{
+    if (fromGL && !bgra) {
+        for (int y = 0; y < image.height(); ++y) {
+            convertFromGLRow(reinterpret_cast<uint *>(image.scanLine(y)), image.width());
+        }
+    }
+    // OpenGL stores the rows bottom to top
+    const bool flipped = fromGL;
+
+    if (format == VirtualBackend::FrameFormat::Png) {
+        if (!(flipped ? image.mirrored() : image).save(path)) {
+            qCWarning(KWIN_VIRTUAL) << "Failed to save frame" << path;
+        }
+        return;
+    }
+
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qCWarning(KWIN_VIRTUAL) << "Failed to open" << path << file.errorString();
+        return;
+    }
+    const bool written = format == VirtualBackend::FrameFormat::Ppm ? writePpm(image, flipped, file)
+                                                                   : writeRaw(image, flipped, file);
+    if (!written) {
+        qCWarning(KWIN_VIRTUAL) << "Failed to write frame" << path << file.errorString();
+    }
+}
+
+static QString fileExtension(VirtualBackend::FrameFormat format)
+{
+    switch (format) {
+    case VirtualBackend::FrameFormat::Raw:
+        return QStringLiteral("raw");
+    case VirtualBackend::FrameFormat::Ppm:
+        return QStringLiteral("ppm");
+    case VirtualBackend::FrameFormat::Png:
+    default:
+        return QStringLiteral("png");
+    }
+}
+
+FrameCapture::FrameCapture(const QString &directory, VirtualBackend::FrameFormat format)
+    : m_directory(directory)
+    , m_format(format)
+{
+    m_encoders.setMaxThreadCount(qMax(1, QThread::idealThreadCount() - 1));
+    // Bounds the memory used by frames waiting to be encoded
+    m_queuedFrames.release(m_encoders.maxThreadCount() * 2);
+}
+
+FrameCapture::~FrameCapture()
+{
+    if (m_glInitialized) {
+        // Save the frames in the order they were rendered
+        for (int i = 0; i < m_readbacks.count(); ++i) {
+            release(m_readbacks[(m_nextReadback + i) % m_readbacks.count()]);
+        }
+        for (const Readback &readback : qAsConst(m_readbacks)) {
+            glDeleteBuffers(1, &readback.buffer);
+        }
+    }
+    m_encoders.waitForDone();
+}
+
+void FrameCapture::initGL()
+{
+    m_glInitialized = true;
+    if (GLPlatform::instance()->isGLES()) {
+        m_asyncReadback = hasGLVersion(3, 0);
+        m_bgra = hasGLExtension(QByteArrayLiteral("GL_EXT_read_format_bgra"));
+    } else {
+        m_asyncReadback = hasGLVersion(3, 2) || (hasGLVersion(3, 0) && hasGLExtension(QByteArrayLiteral("GL_ARB_sync")));
+        m_bgra = true;
+    }
+    // GL_BGRA matches the memory layout of QImage::Format_ARGB32 on little endian only
+    m_bgra = m_bgra && QSysInfo::ByteOrder == QSysInfo::LittleEndian;
+
+    if (m_asyncReadback) {
+        m_readbacks.resize(s_readbackCount);
+        for (Readback &readback : m_readbacks) {
+            glGenBuffers(1, &readback.buffer);
+        }
+    }
+}
+
+void FrameCapture::readFramebuffer(const QSize &size)
+{
+    if (!m_glInitialized) {
+        initGL();
+    }
+    const GLenum format = m_bgra ? GL_BGRA : GL_RGBA;
+    const GLsizeiptr bufferSize = GLsizeiptr(size.width()) * size.height() * 4;
+
+    if (!m_asyncReadback) {
+        QImage image(size, QImage::Format_ARGB32);
+        glReadnPixels(0, 0, size.width(), size.height(), format, GL_UNSIGNED_BYTE, image.sizeInBytes(), image.bits());
+        queue(image, QString::number(m_frameCounter++), true);
+        return;
+    }
+
+    // start encoding whatever the GPU finished meanwhile
+    for (Readback &readback : m_readbacks) {
+        collect(readback, false);
+    }
+    // the oldest readback, it has most likely been saved by now
+    Readback &readback = m_readbacks[m_nextReadback];
+    release(readback);
+    m_nextReadback = (m_nextReadback + 1) % m_readbacks.count();
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.buffer);
+    if (readback.bufferSize != bufferSize) {
+        glBufferData(GL_PIXEL_PACK_BUFFER, bufferSize, nullptr, GL_STREAM_READ);
+        readback.bufferSize = bufferSize;
+    }
+    glReadPixels(0, 0, size.width(), size.height(), format, GL_UNSIGNED_BYTE, nullptr);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    readback.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    readback.size = size;
+    readback.frame = m_frameCounter++;
+}
+
+bool FrameCapture::collect(Readback &readback, bool wait)
+{
+    if (!readback.fence) {
+        return true;
+    }
+    const GLuint64 timeout = wait ? GL_TIMEOUT_IGNORED : 0;
+    const GLenum status = glClientWaitSync(readback.fence, wait ? GL_SYNC_FLUSH_COMMANDS_BIT : 0, timeout);
+    if (status == GL_TIMEOUT_EXPIRED) {
+        return false;
+    }
+    glDeleteSync(readback.fence);
+    readback.fence = nullptr;
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.buffer);
+    const void *data = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, readback.bufferSize, GL_MAP_READ_BIT);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    if (!data) {
+        qCWarning(KWIN_VIRTUAL) << "Failed to map the readback buffer, frame" << readback.frame << "is lost";
+        return true;
+    }
+    readback.mapped = true;
+    // no copy on the compositor thread, the encoder converts the frame if it needs to
+    QImage image(static_cast<const uchar *>(data), readback.size.width(), readback.size.height(),
+                 readback.size.width() * 4, QImage::Format_ARGB32);
+    const QString path = framePath(QString::number(readback.frame));
+    readback.encoding = QtConcurrent::run(&m_encoders, [this, image = std::move(image), path] () mutable {
+        writeFrame(std::move(image), true, m_bgra, path, m_format);
+    });
+    return true;
+}
+
+void FrameCapture::release(Readback &readback)
+{
+    collect(readback, true);
+    if (!readback.mapped) {
+        return;
+    }
+    readback.encoding.waitForFinished();
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.buffer);
+    glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    readback.mapped = false;
+}
+
+QString FrameCapture::framePath(const QString &name) const
+{
+    return QStringLiteral("%1/%2.%3").arg(m_directory, name, fileExtension(m_format));
+}
+
+void FrameCapture::save(const QImage &image, const QString &name)
+{
+    queue(image, name, false);
+}
+
+void FrameCapture::queue(QImage image, const QString &name, bool fromGL)
+{
+    const QString path = framePath(name);
+    // waits for the encoders if they are behind, a capture run must not miss frames
+    m_queuedFrames.acquire();
+    QtConcurrent::run(&m_encoders, [this, image = std::move(image), fromGL, path] () mutable {
+        writeFrame(std::move(image), fromGL, m_bgra, path, m_format);
+        m_queuedFrames.release();
+    });
+}
+
+}
@@ -0,0 +1,107 @@
+/********************************************************************
+ KWin - the KDE window manager
+ This file is part of the KDE project.
+
+Copyright (C) 2020 The KWin developers <kwin@kde.org>
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*********************************************************************/
+#ifndef KWIN_VIRTUAL_FRAME_CAPTURE_H
+#define KWIN_VIRTUAL_FRAME_CAPTURE_H
+
+#include "virtual_backend.h"
+
+#include <QFuture>
+#include <QImage>
+#include <QSemaphore>
+#include <QSize>
+#include <QThreadPool>
+#include <QVector>
+
+#include <epoxy/gl.h>
+
+namespace KWin
+{
+
+/**
+ * @brief Saves the frames rendered by the virtual platform without stalling the compositor.
+ *
+ * The images are encoded and written by a pool of worker threads. No frame is dropped, a
+ * capture run has to be complete to compare it with a reference. If the workers fall
+ * behind, the compositor waits for them instead of queuing an unbounded number of frames.
+ *
+ * For the OpenGL backend, readFramebuffer() copies the bound framebuffer into a ring of
+ * pixel buffer objects. A frame is only mapped once its fence signals that the GPU has
+ * finished copying it, usually a couple of frames later, and the encoder reads it straight
+ * from the mapped buffer. The compositor only waits if the GPU or the encoder is still
+ * busy with the oldest frame of the ring when it is needed again.
+ */
+class FrameCapture
+{
+public:
+    FrameCapture(const QString &directory, VirtualBackend::FrameFormat format);
+    ~FrameCapture();
+
+    /**
+     * Queues @p image to be saved as @p name in the capture directory. The file
+     * extension is added according to the frame format.
+     */
+    void save(const QImage &image, const QString &name);
+
+    /**
+     * Reads the bound framebuffer of @p size and saves it once the readback has finished.
+     * The OpenGL context has to be current, also when destroying the FrameCapture after
+     * the first call.
+     */
+    void readFramebuffer(const QSize &size);
+
+private:
+    struct Readback {
+        GLuint buffer = 0;
+        GLsizeiptr bufferSize = 0;
+        GLsync fence = nullptr;
+        QSize size;
+        int frame = 0;
+        // mapped until the encoder is done with the frame
+        bool mapped = false;
+        QFuture<void> encoding;
+    };
+    void initGL();
+    /**
+     * Hands the frame of @p readback to the encoders if the GPU finished it, or waits for it
+     * if @p wait is set. Returns @c false if the readback is still in progress.
+     */
+    bool collect(Readback &readback, bool wait);
+    /**
+     * Waits until the frame of @p readback is saved, so the buffer can be reused.
+     */
+    void release(Readback &readback);
+    QString framePath(const QString &name) const;
+    void queue(QImage image, const QString &name, bool fromGL);
+
+    QString m_directory;
+    VirtualBackend::FrameFormat m_format;
+    QThreadPool m_encoders;
+    QSemaphore m_queuedFrames;
+    QVector<Readback> m_readbacks;
+    int m_nextReadback = 0;
+    int m_frameCounter = 0;
+    bool m_bgra = false;
+    bool m_asyncReadback = false;
+    bool m_glInitialized = false;
+};
+
+}
+
+#endif
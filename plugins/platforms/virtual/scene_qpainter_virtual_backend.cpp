@@ -18,6 +18,7 @@ You should have received a copy of the GNU General Public License
 along with this program.  If not, see <http://www.gnu.org/licenses/>.
 *********************************************************************/
 #include "scene_qpainter_virtual_backend.h"
+#include "frame_capture.h"
 #include "virtual_backend.h"
 #include "cursor.h"
 #include "screens.h"
@@ -30,6 +31,9 @@ VirtualQPainterBackend::VirtualQPainterBackend(VirtualBackend *backend)
     : QPainterBackend()
     , m_backend(backend)
 {
+    if (m_backend->saveFrames()) {
+        m_frameCapture.reset(new FrameCapture(m_backend->screenshotDirPath(), m_backend->frameFormat()));
+    }
     connect(screens(), &Screens::changed, this, &VirtualQPainterBackend::createOutputs);
     createOutputs();
 }
@@ -69,9 +73,9 @@ void VirtualQPainterBackend::present(int mask, const QRegion &damage)
 {
     Q_UNUSED(mask)
     Q_UNUSED(damage)
-    if (m_backend->saveFrames()) {
+    if (m_frameCapture) {
         for (int i=0; i < m_backBuffers.size() ; i++) {
-            m_backBuffers[i].save(QStringLiteral("%1/screen%2-%3.png").arg(m_backend->screenshotDirPath(), QString::number(i), QString::number(m_frameCounter++)));
+            m_frameCapture->save(m_backBuffers[i], QStringLiteral("screen%1-%2").arg(QString::number(i), QString::number(m_frameCounter++)));
         }
     }
 }
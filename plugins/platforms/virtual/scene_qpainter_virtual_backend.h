@@ -23,11 +23,13 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <platformsupport/scenes/qpainter/backend.h>
 
 #include <QObject>
+#include <QScopedPointer>
 #include <QVector>
 
 namespace KWin
 {
 
+class FrameCapture;
 class VirtualBackend;
 
 class VirtualQPainterBackend : public QObject, public QPainterBackend
@@ -50,6 +52,7 @@ private:
 
     QVector<QImage> m_backBuffers;
     VirtualBackend *m_backend;
+    QScopedPointer<FrameCapture> m_frameCapture;
     int m_frameCounter = 0;
 };
 
@@ -46,6 +46,12 @@ VirtualBackend::VirtualBackend(QObject *parent)
         if (!m_screenshotDir.isNull()) {
             qDebug() << "Screenshots saved to: " << m_screenshotDir->path();
         }
+        const QByteArray format = qgetenv("KWIN_WAYLAND_VIRTUAL_SCREENSHOT_FORMAT").toLower();
+        if (format == QByteArrayLiteral("raw")) {
+            m_frameFormat = FrameFormat::Raw;
+        } else if (format == QByteArrayLiteral("ppm")) {
+            m_frameFormat = FrameFormat::Ppm;
+        }
     }
     setSupportsPointerWarping(true);
     setSupportsGammaControl(true);
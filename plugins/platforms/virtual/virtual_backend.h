@@ -48,6 +48,24 @@ public:
     }
     QString screenshotDirPath() const;
 
+    /**
+     * File format of the saved frames, selected with KWIN_WAYLAND_VIRTUAL_SCREENSHOT_FORMAT.
+     */
+    enum class FrameFormat {
+        /**
+         * The pixels in QImage::Format_ARGB32 without any header.
+         */
+        Raw,
+        /**
+         * Binary portable pixmap, cheap to encode and readable by most tools.
+         */
+        Ppm,
+        Png
+    };
+    FrameFormat frameFormat() const {
+        return m_frameFormat;
+    }
+
     Screens *createScreens(QObject *parent = nullptr) override;
     QPainterBackend* createQPainterBackend() override;
     OpenGLBackend *createOpenGLBackend() override;
@@ -72,6 +90,7 @@ private:
     QVector<VirtualOutput*> m_enabledOutputs;
 
     QScopedPointer<QTemporaryDir> m_screenshotDir;
+    FrameFormat m_frameFormat = FrameFormat::Png;
 };
 
 }
@@ -0,0 +1,186 @@
+/********************************************************************
+ KWin - the KDE window manager
+ This file is part of the KDE project.
+
+Copyright (C) 2020 The KWin developers <kwin@kde.org>
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*********************************************************************/
+#include "decoration_atlas.h"
+
+#include "kwinglutils.h"
+
+#include <QImage>
+
+#include <algorithm>
+
+namespace KWin
+{
+
+// Initial height of the atlas texture, it's as wide as the largest supported texture.
+static const int s_initialHeight = 256;
+static const int s_maximumSize = 4096;
+// Texels left free around every area, one is enough for linear filtering
+static const int s_gutter = 1;
+
+DecorationAtlas &DecorationAtlas::instance()
+{
+    static DecorationAtlas s_instance;
+    return s_instance;
+}
+
+DecorationAtlas::~DecorationAtlas()
+{
+    Q_ASSERT(m_allocations.isEmpty());
+}
+
+int DecorationAtlas::maximumSize() const
+{
+    GLint size = 0;
+    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &size);
+    return qMin(int(size), s_maximumSize);
+}
+
+bool DecorationAtlas::allocate(const SceneOpenGLDecorationRenderer *renderer, const QSize &size)
+{
+    auto it = m_allocations.find(renderer);
+    if (it != m_allocations.end()) {
+        m_packer.release(it.value());
+        m_allocations.erase(it);
+    }
+
+    const int maximum = maximumSize();
+    const QSize area = size + QSize(2 * s_gutter, 2 * s_gutter);
+    if (size.isEmpty() || area.width() > maximum || area.height() > maximum) {
+        release(renderer);
+        return false;
+    }
+
+    QRect rect = m_texture ? m_packer.allocate(area) : QRect();
+    if (!rect.isValid()) {
+        // Repack if the holes left by released decorations are enough to hold the new one,
+        // otherwise grow the texture until it is at most three quarters full.
+        const int usedArea = m_packer.usedArea() + area.width() * area.height();
+        int height = qMax(m_packer.size().height(), qMin(s_initialHeight, maximum));
+        while (height < maximum && usedArea * 4 > maximum * height * 3) {
+            height = qMin(height * 2, maximum);
+        }
+        while (repack(height)) {
+            rect = m_packer.allocate(area);
+            if (rect.isValid() || height == maximum) {
+                break;
+            }
+            height = qMin(height * 2, maximum);
+        }
+    }
+    if (!rect.isValid()) {
+        release(renderer);
+        return false;
+    }
+    m_allocations.insert(renderer, rect);
+    // the area may hold the contents of a released decoration
+    clearArea(rect);
+    return true;
+}
+
+void DecorationAtlas::clearArea(const QRect &area)
+{
+    QImage transparent(area.size(), QImage::Format_ARGB32_Premultiplied);
+    transparent.fill(Qt::transparent);
+    m_texture->update(transparent, area.topLeft());
+}
+
+void DecorationAtlas::release(const SceneOpenGLDecorationRenderer *renderer)
+{
+    auto it = m_allocations.find(renderer);
+    if (it != m_allocations.end()) {
+        m_packer.release(it.value());
+        m_allocations.erase(it);
+    }
+    if (m_allocations.isEmpty()) {
+        m_texture.reset();
+        m_packer = ShelfPacker();
+    }
+}
+
+QRect DecorationAtlas::rect(const SceneOpenGLDecorationRenderer *renderer) const
+{
+    const QRect area = m_allocations.value(renderer);
+    if (!area.isValid()) {
+        return QRect();
+    }
+    return area.adjusted(s_gutter, s_gutter, -s_gutter, -s_gutter);
+}
+
+GLTexture *DecorationAtlas::texture(const SceneOpenGLDecorationRenderer *renderer) const
+{
+    if (!m_allocations.contains(renderer)) {
+        return nullptr;
+    }
+    return m_texture.data();
+}
+
+bool DecorationAtlas::repack(int height)
+{
+    ShelfPacker packer(QSize(maximumSize(), height));
+
+    // Packing the highest areas first leaves the fewest holes in the shelves.
+    QVector<const SceneOpenGLDecorationRenderer*> renderers = m_allocations.keys().toVector();
+    std::sort(renderers.begin(), renderers.end(),
+        [this](const SceneOpenGLDecorationRenderer *a, const SceneOpenGLDecorationRenderer *b) {
+            return m_allocations[a].height() > m_allocations[b].height();
+        }
+    );
+    QHash<const SceneOpenGLDecorationRenderer*, QRect> allocations;
+    for (const SceneOpenGLDecorationRenderer *renderer : renderers) {
+        const QRect rect = packer.allocate(m_allocations[renderer].size());
+        if (!rect.isValid()) {
+            return false;
+        }
+        allocations.insert(renderer, rect);
+    }
+
+    QScopedPointer<GLTexture> texture(new GLTexture(GL_RGBA8, packer.size().width(), packer.size().height()));
+    texture->setYInverted(true);
+    texture->setWrapMode(GL_CLAMP_TO_EDGE);
+    texture->clear();
+
+    if (m_texture && !m_allocations.isEmpty()) {
+        // Move the decorations over on the GPU, they don't need to be rendered again.
+        if (!GLRenderTarget::supported()) {
+            return false;
+        }
+        GLRenderTarget renderTarget(*m_texture);
+        if (!renderTarget.valid()) {
+            return false;
+        }
+        GLRenderTarget::pushRenderTarget(&renderTarget);
+        texture->bind();
+        for (auto it = m_allocations.constBegin(); it != m_allocations.constEnd(); ++it) {
+            const QRect &source = it.value();
+            const QPoint target = allocations[it.key()].topLeft();
+            glCopyTexSubImage2D(GL_TEXTURE_2D, 0, target.x(), target.y(),
+                                source.x(), source.y(), source.width(), source.height());
+        }
+        texture->unbind();
+        GLRenderTarget::popRenderTarget();
+    }
+
+    m_texture.reset(texture.take());
+    m_packer = packer;
+    m_allocations = allocations;
+    return true;
+}
+
+}
@@ -0,0 +1,86 @@
+/********************************************************************
+ KWin - the KDE window manager
+ This file is part of the KDE project.
+
+Copyright (C) 2020 The KWin developers <kwin@kde.org>
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*********************************************************************/
+#ifndef KWIN_DECORATION_ATLAS_H
+#define KWIN_DECORATION_ATLAS_H
+
+#include "shelf_packer.h"
+
+#include <QHash>
+#include <QScopedPointer>
+
+namespace KWin
+{
+
+class GLTexture;
+class SceneOpenGLDecorationRenderer;
+
+/**
+ * @short One texture holding the decorations of all windows.
+ *
+ * Every SceneOpenGLDecorationRenderer gets a sub rectangle of the shared texture for its
+ * parts instead of a texture of its own, so all decorations can be drawn without switching
+ * textures. When an allocation doesn't fit, the contents are repacked on the GPU, which
+ * closes the holes left by released decorations, and the texture grows if that is not enough.
+ * The texture is destroyed together with the last allocation.
+ *
+ * Every area is surrounded by a transparent gutter and cleared when it is allocated, so
+ * filtering a scaled or transformed decoration never samples texels of a neighbouring
+ * decoration or stale contents. The decoration parts pad their edge texels themselves.
+ */
+class DecorationAtlas
+{
+public:
+    ~DecorationAtlas();
+    DecorationAtlas(const DecorationAtlas&) = delete;
+    static DecorationAtlas &instance();
+
+    /**
+     * Reserves an area of @p size texels for @p renderer, replacing a previous allocation.
+     * Returns @c false if the size exceeds what the atlas can provide, the renderer needs
+     * a texture of its own in that case.
+     */
+    bool allocate(const SceneOpenGLDecorationRenderer *renderer, const QSize &size);
+    void release(const SceneOpenGLDecorationRenderer *renderer);
+
+    /**
+     * The area of @p renderer in the atlas texture. The area may move when the atlas gets
+     * repacked, its content moves along.
+     */
+    QRect rect(const SceneOpenGLDecorationRenderer *renderer) const;
+    /**
+     * The atlas texture if @p renderer has an area in it, otherwise @c nullptr.
+     */
+    GLTexture *texture(const SceneOpenGLDecorationRenderer *renderer) const;
+
+private:
+    DecorationAtlas() = default;
+    bool repack(int height);
+    int maximumSize() const;
+    void clearArea(const QRect &area);
+
+    QScopedPointer<GLTexture> m_texture;
+    ShelfPacker m_packer;
+    // the allocated areas including the gutter
+    QHash<const SceneOpenGLDecorationRenderer*, QRect> m_allocations;
+};
+
+}
+
+#endif
@@ -29,6 +29,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 *********************************************************************/
 #include "scene_opengl.h"
 
+#include "abstract_output.h"
 #include "platform.h"
 #include "wayland_server.h"
 #include "platformsupport/scenes/opengl/texture.h"
@@ -39,6 +40,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "utils.h"
 #include "x11client.h"
 #include "composite.h"
+#include "decoration_atlas.h"
 #include "deleted.h"
 #include "effects.h"
 #include "lanczosfilter.h"
@@ -64,6 +66,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <QGraphicsScale>
 #include <QPainter>
 #include <QStringList>
+#include <QtConcurrentMap>
 #include <QVector2D>
 #include <QVector4D>
 #include <QMatrix4x4>
@@ -627,13 +630,56 @@ qint64 SceneOpenGL::paint(QRegion damage, QList<Toplevel *> toplevels)
     QRegion updateRegion, validRegion;
     if (m_backend->perScreenRendering()) {
         // trigger start render timer
-        m_backend->prepareRenderingFrame();
+        {
+            FrameStageTimer timer(this, FrameStage::Swap);
+            m_backend->prepareRenderingFrame();
+        }
         for (int i = 0; i < screens()->count(); ++i) {
+            const AbstractOutput *output = kwinApp()->platform()->findOutput(i);
+            if (output && output->isFramePending()) {
+                // The Compositor deferred the damage of this output, it gets
+                // painted once its pending frame has been presented.
+                continue;
+            }
             const QRect &geo = screens()->geometry(i);
+            QRegion screenDamage = damage.intersected(geo);
+            if (m_backend->supportsOverlayPlanes()) {
+                screenDamage = updateOverlayPlanes(geo, screenDamage,
+                    [this, i] (const QVector<Window *> &windows) {
+                        QVector<OpenGLBackend::OverlayCandidate> candidates;
+                        candidates.reserve(windows.count());
+                        for (Window *window : windows) {
+                            candidates.append({window->window()->surface(), window->window()->bufferGeometry()});
+                        }
+                        const auto surfaces = m_backend->assignOverlayPlanes(i, candidates);
+                        QVector<Window *> assigned;
+                        for (Window *window : windows) {
+                            if (surfaces.contains(window->window()->surface())) {
+                                assigned.append(window);
+                            }
+                        }
+                        return assigned;
+                    }
+                );
+            }
+            if (Window *window = findScanoutCandidate(geo)) {
+                if (screenDamage.isEmpty()) {
+                    // the screen still shows the window's current content
+                    continue;
+                }
+                if (m_backend->scanout(i, window->window()->surface())) {
+                    resetRepaints();
+                    continue;
+                }
+            }
             QRegion update;
             QRegion valid;
             // prepare rendering makes context current on the output
-            QRegion repaint = m_backend->prepareRenderingForScreen(i);
+            QRegion repaint;
+            {
+                FrameStageTimer timer(this, FrameStage::Swap);
+                repaint = m_backend->prepareRenderingForScreen(i);
+            }
             GLVertexBuffer::setVirtualScreenGeometry(geo);
             GLRenderTarget::setVirtualScreenGeometry(geo);
             GLVertexBuffer::setVirtualScreenScale(screens()->scale(i));
@@ -647,18 +693,26 @@ qint64 SceneOpenGL::paint(QRegion damage, QList<Toplevel *> toplevels)
 
             int mask = 0;
             updateProjectionMatrix();
-            paintScreen(&mask, damage.intersected(geo), repaint, &update, &valid, projectionMatrix(), geo);   // call generic implementation
+            paintScreen(&mask, screenDamage, repaint, &update, &valid, projectionMatrix(), geo);   // call generic implementation
             paintCursor();
 
             GLVertexBuffer::streamingBuffer()->endOfFrame();
 
-            m_backend->endRenderingFrameForScreen(i, valid, update);
+            {
+                FrameStageTimer timer(this, FrameStage::Swap);
+                m_backend->endRenderingFrameForScreen(i, valid, update);
+            }
 
             GLVertexBuffer::streamingBuffer()->framePosted();
         }
     } else {
         m_backend->makeCurrent();
-        QRegion repaint = m_backend->prepareRenderingFrame();
+        QRegion repaint;
+        {
+            // some backends present the previous frame when starting a new one
+            FrameStageTimer timer(this, FrameStage::Swap);
+            repaint = m_backend->prepareRenderingFrame();
+        }
 
         const GLenum status = glGetGraphicsResetStatus();
         if (status != GL_NO_ERROR) {
@@ -691,7 +745,10 @@ qint64 SceneOpenGL::paint(QRegion damage, QList<Toplevel *> toplevels)
 
         GLVertexBuffer::streamingBuffer()->endOfFrame();
 
-        m_backend->endRenderingFrame(validRegion, updateRegion);
+        {
+            FrameStageTimer timer(this, FrameStage::Swap);
+            m_backend->endRenderingFrame(validRegion, updateRegion);
+        }
 
         GLVertexBuffer::streamingBuffer()->framePosted();
     }
@@ -1091,6 +1148,7 @@ bool OpenGLWindow::bindTexture()
     if (!window()->damage().isEmpty())
         m_scene->insertWait();
 
+    Scene::FrameStageTimer timer(m_scene, Scene::FrameStage::TextureUpload);
     return pixmap->bind();
 }
 
@@ -1193,7 +1251,7 @@ void OpenGLWindow::endRenderWindow()
     }
 }
 
-GLTexture *OpenGLWindow::getDecorationTexture() const
+const SceneOpenGLDecorationRenderer *OpenGLWindow::getDecorationRenderer() const
 {
     if (AbstractClient *client = dynamic_cast<AbstractClient *>(toplevel)) {
         if (client->noBorder()) {
@@ -1205,16 +1263,14 @@ GLTexture *OpenGLWindow::getDecorationTexture() const
         }
         if (SceneOpenGLDecorationRenderer *renderer = static_cast<SceneOpenGLDecorationRenderer*>(client->decoratedClient()->renderer())) {
             renderer->render();
-            return renderer->texture();
+            return renderer;
         }
     } else if (toplevel->isDeleted()) {
         Deleted *deleted = static_cast<Deleted *>(toplevel);
         if (!deleted->wasClient() || deleted->noBorder()) {
             return nullptr;
         }
-        if (const SceneOpenGLDecorationRenderer *renderer = static_cast<const SceneOpenGLDecorationRenderer*>(deleted->decorationRenderer())) {
-            return renderer->texture();
-        }
+        return static_cast<const SceneOpenGLDecorationRenderer*>(deleted->decorationRenderer());
     }
     return nullptr;
 }
@@ -1252,7 +1308,10 @@ void OpenGLWindow::setupLeafNodes(LeafNode *nodes, const WindowQuadList *quads,
     }
 
     if (!quads[DecorationLeaf].isEmpty()) {
-        nodes[DecorationLeaf].texture = getDecorationTexture();
+        if (const SceneOpenGLDecorationRenderer *renderer = getDecorationRenderer()) {
+            nodes[DecorationLeaf].texture = renderer->texture();
+            nodes[DecorationLeaf].textureOffset = renderer->textureOffset();
+        }
         nodes[DecorationLeaf].opacity = data.opacity();
         nodes[DecorationLeaf].hasAlpha = true;
         nodes[DecorationLeaf].coordinateType = UnnormalizedCoordinates;
@@ -1431,12 +1490,14 @@ void OpenGLWindow::performPaint(int mask, QRegion region, WindowPaintData data)
     const size_t size = verticesPerQuad *
         (quads[0].count() + quads[1].count() + quads[2].count() + quads[3].count()) * sizeof(GLVertex2D);
 
-    GLVertexBuffer *vbo = GLVertexBuffer::streamingBuffer();
-    GLVertex2D *map = (GLVertex2D *) vbo->map(size);
-
+    // Set up the leaves before mapping the buffer, updating the decoration might
+    // have to repack the decoration atlas.
     LeafNode nodes[LeafCount];
     setupLeafNodes(nodes, quads, data);
 
+    GLVertexBuffer *vbo = GLVertexBuffer::streamingBuffer();
+    GLVertex2D *map = (GLVertex2D *) vbo->map(size);
+
     for (int i = 0, v = 0; i < LeafCount; i++) {
         if (quads[i].isEmpty() || !nodes[i].texture)
             continue;
@@ -1444,7 +1505,8 @@ void OpenGLWindow::performPaint(int mask, QRegion region, WindowPaintData data)
         nodes[i].firstVertex = v;
         nodes[i].vertexCount = quads[i].count() * verticesPerQuad;
 
-        const QMatrix4x4 matrix = nodes[i].texture->matrix(nodes[i].coordinateType);
+        QMatrix4x4 matrix = nodes[i].texture->matrix(nodes[i].coordinateType);
+        matrix.translate(nodes[i].textureOffset.x(), nodes[i].textureOffset.y());
 
         quads[i].makeInterleavedArrays(primitiveType, &map[v], matrix);
         v += quads[i].count() * verticesPerQuad;
@@ -2479,6 +2541,15 @@ SceneOpenGLDecorationRenderer::SceneOpenGLDecorationRenderer(Decoration::Decorat
     , m_texture()
 {
     connect(this, &Renderer::renderScheduled, client->client(), static_cast<void (AbstractClient::*)(const QRect&)>(&AbstractClient::addRepaint));
+    // start rasterizing ahead of the paint pass
+    connect(this, &Renderer::renderScheduled, this, &SceneOpenGLDecorationRenderer::startRasterization, Qt::QueuedConnection);
+    connect(&m_rasterizer, &QFutureWatcher<QImage>::finished, this,
+        [this] {
+            if (client()) {
+                client()->client()->addRepaint(m_rasterizedRect);
+            }
+        }
+    );
 }
 
 SceneOpenGLDecorationRenderer::~SceneOpenGLDecorationRenderer()
@@ -2486,31 +2557,20 @@ SceneOpenGLDecorationRenderer::~SceneOpenGLDecorationRenderer()
     if (Scene *scene = Compositor::self()->scene()) {
         scene->makeOpenGLContextCurrent();
     }
+    DecorationAtlas::instance().release(this);
 }
 
-// Rotates the given source rect 90° counter-clockwise,
-// and flips it vertically
-static QImage rotate(const QImage &srcImage, const QRect &srcRect)
+GLTexture *SceneOpenGLDecorationRenderer::texture() const
 {
-    auto dpr = srcImage.devicePixelRatio();
-    QImage image(srcRect.height() * dpr, srcRect.width() * dpr, srcImage.format());
-    image.setDevicePixelRatio(dpr);
-    const QPoint srcPoint(srcRect.x() * dpr, srcRect.y() * dpr);
-
-    const uint32_t *src = reinterpret_cast<const uint32_t *>(srcImage.bits());
-    uint32_t *dst = reinterpret_cast<uint32_t *>(image.bits());
-
-    for (int x = 0; x < image.width(); x++) {
-        const uint32_t *s = src + (srcPoint.y() + x) * srcImage.width() + srcPoint.x();
-        uint32_t *d = dst + x;
-
-        for (int y = 0; y < image.height(); y++) {
-            *d = s[y];
-            d += image.width();
-        }
+    if (m_texture) {
+        return m_texture.data();
     }
+    return DecorationAtlas::instance().texture(this);
+}
 
-    return image;
+QPoint SceneOpenGLDecorationRenderer::textureOffset() const
+{
+    return DecorationAtlas::instance().rect(this).topLeft();
 }
 
 static void clamp_row(int left, int width, int right, const uint32_t *src, uint32_t *dest)
@@ -2559,29 +2619,58 @@ static void clamp(QImage &image, const QRect &viewport)
     }
 }
 
-void SceneOpenGLDecorationRenderer::render()
+namespace {
+
+// Reports the scale of the output to the decoration, so that it picks pixmaps of the right size.
+class DecorationPicture : public QPicture
 {
-    const QRegion scheduled = getScheduled();
-    if (scheduled.isEmpty()) {
-        return;
-    }
-    if (areImageSizesDirty()) {
-        resizeTexture();
-        resetImageSizesDirty();
+public:
+    explicit DecorationPicture(qreal scale)
+        : m_scale(scale)
+    {
+    }
+
+protected:
+    int metric(PaintDeviceMetric metric) const override
+    {
+        switch (metric) {
+        case PdmDevicePixelRatio:
+            return int(m_scale);
+        case PdmDevicePixelRatioScaled:
+            return m_scale * devicePixelRatioFScale();
+        default:
+            return QPicture::metric(metric);
+        }
     }
 
-    if (!m_texture) {
-        // for invalid sizes we get no texture, see BUG 361551
-        return;
-    }
+private:
+    qreal m_scale;
+};
 
-    QRect left, top, right, bottom;
-    client()->client()->layoutDecorationRects(left, top, right, bottom);
+}
+
+bool SceneOpenGLDecorationRenderer::Layout::operator==(const Layout &other) const
+{
+    return left == other.left && top == other.top && right == other.right && bottom == other.bottom
+        && qFuzzyCompare(scale, other.scale);
+}
+
+SceneOpenGLDecorationRenderer::Layout SceneOpenGLDecorationRenderer::layout()
+{
+    Layout layout;
+    client()->client()->layoutDecorationRects(layout.left, layout.top, layout.right, layout.bottom);
+    layout.scale = client()->client()->screenScale();
+    return layout;
+}
+
+QVector<SceneOpenGLDecorationRenderer::Part> SceneOpenGLDecorationRenderer::recordParts(const QRegion &region, const Layout &layout)
+{
+    QVector<Part> parts;
 
     // We pad each part in the decoration atlas in order to avoid texture bleeding.
     const int padding = 1;
 
-    auto renderPart = [=](const QRect &geo, const QRect &partRect, const QPoint &position, bool rotated = false) {
+    auto recordPart = [&](const QRect &geo, const QRect &partRect, const QPoint &position, bool rotated = false) {
         if (!geo.isValid()) {
             return;
         }
@@ -2604,44 +2693,162 @@ void SceneOpenGLDecorationRenderer::render()
             rect.setBottom(rect.bottom() + padding);
         }
 
-        QRect viewport = geo.translated(-rect.x(), -rect.y());
-        const qreal devicePixelRatio = client()->client()->screenScale();
+        Part part;
+        part.clip = geo;
+        part.window = geo;
+        part.viewport = geo.translated(-rect.x(), -rect.y());
+        part.imageSize = rect.size();
+        part.devicePixelRatio = layout.scale;
+        part.rotated = rotated;
+        if (rotated) {
+            // The vertical parts are stored transposed, their texture coordinates swap
+            // the axes back, see Scene::Window::makeDecorationQuads().
+            part.window = QRect(geo.y(), geo.x(), geo.height(), geo.width());
+            part.viewport = QRect(part.viewport.y(), part.viewport.x(), part.viewport.height(), part.viewport.width());
+            part.imageSize.transpose();
+        }
 
-        QImage image(rect.size() * devicePixelRatio, QImage::Format_ARGB32_Premultiplied);
-        image.setDevicePixelRatio(devicePixelRatio);
-        image.fill(Qt::transparent);
+        const QPoint dirtyOffset = geo.topLeft() - partRect.topLeft();
+        part.texturePosition = (position + dirtyOffset - part.viewport.topLeft()) * layout.scale;
 
-        QPainter painter(&image);
-        painter.setRenderHint(QPainter::Antialiasing);
-        painter.setViewport(QRect(viewport.topLeft(), viewport.size() * devicePixelRatio));
-        painter.setWindow(QRect(geo.topLeft(), geo.size() * devicePixelRatio));
+        DecorationPicture picture(layout.scale);
+        QPainter painter(&picture);
         painter.setClipRect(geo);
         renderToPainter(&painter, geo);
         painter.end();
+        part.picture = picture;
 
-        clamp(image, QRect(viewport.topLeft(), viewport.size() * devicePixelRatio));
+        parts << part;
+    };
 
-        if (rotated) {
-            // TODO: get this done directly when rendering to the image
-            image = rotate(image, QRect(QPoint(), rect.size()));
-            viewport = QRect(viewport.y(), viewport.x(), viewport.height(), viewport.width());
+    const QRect geometry = region.boundingRect();
+
+    const QPoint topPosition(padding, padding);
+    const QPoint bottomPosition(padding, topPosition.y() + layout.top.height() + 2 * padding);
+    const QPoint leftPosition(padding, bottomPosition.y() + layout.bottom.height() + 2 * padding);
+    const QPoint rightPosition(padding, leftPosition.y() + layout.left.width() + 2 * padding);
+
+    recordPart(layout.left.intersected(geometry), layout.left, leftPosition, true);
+    recordPart(layout.top.intersected(geometry), layout.top, topPosition);
+    recordPart(layout.right.intersected(geometry), layout.right, rightPosition, true);
+    recordPart(layout.bottom.intersected(geometry), layout.bottom, bottomPosition);
+
+    return parts;
+}
+
+QImage SceneOpenGLDecorationRenderer::rasterizePart(const Part &part)
+{
+    const qreal devicePixelRatio = part.devicePixelRatio;
+
+    QImage image(part.imageSize * devicePixelRatio, QImage::Format_ARGB32_Premultiplied);
+    image.setDevicePixelRatio(devicePixelRatio);
+    image.fill(Qt::transparent);
+
+    QPainter painter(&image);
+    painter.setRenderHint(QPainter::Antialiasing);
+    if (part.rotated) {
+        // Swapping the axes commutes with the window to viewport mapping, which only scales
+        // uniformly and translates, so the transposed window and viewport can be used.
+        painter.setWorldTransform(QTransform(0, 1, 1, 0, 0, 0));
+    }
+    painter.setViewport(QRect(part.viewport.topLeft(), part.viewport.size() * devicePixelRatio));
+    painter.setWindow(QRect(part.window.topLeft(), part.window.size() * devicePixelRatio));
+    painter.setClipRect(part.clip);
+    painter.drawPicture(0, 0, part.picture);
+    painter.end();
+
+    clamp(image, QRect(part.viewport.topLeft(), part.viewport.size() * devicePixelRatio));
+    return image;
+}
+
+void SceneOpenGLDecorationRenderer::upload(const QVector<Part> &parts, const QVector<QImage> &images)
+{
+    GLTexture *texture = this->texture();
+    if (!texture) {
+        return;
+    }
+    const QPoint textureOffset = this->textureOffset();
+    for (int i = 0; i < parts.count(); ++i) {
+        texture->update(images.at(i), textureOffset + parts.at(i).texturePosition);
+    }
+}
+
+void SceneOpenGLDecorationRenderer::startRasterization()
+{
+    if (!client() || !m_rasterizedParts.isEmpty()) {
+        // the parts scheduled meanwhile are picked up once the running job got uploaded
+        return;
+    }
+    const QRegion scheduled = getScheduled();
+    if (scheduled.isEmpty()) {
+        return;
+    }
+    m_rasterizedLayout = layout();
+    m_rasterizedParts = recordParts(scheduled, m_rasterizedLayout);
+    m_rasterizedRect = scheduled.boundingRect();
+    if (!m_rasterizedParts.isEmpty()) {
+        m_rasterizer.setFuture(QtConcurrent::mapped(m_rasterizedParts, &SceneOpenGLDecorationRenderer::rasterizePart));
+    }
+}
+
+void SceneOpenGLDecorationRenderer::finishRasterization(bool wait)
+{
+    if (m_rasterizedParts.isEmpty()) {
+        return;
+    }
+    QFuture<QImage> future = m_rasterizer.future();
+    // A job started before the decoration got resized is outdated, the resize scheduled
+    // the whole decoration again anyway.
+    const bool outdated = !client() || !(m_rasterizedLayout == layout());
+    if (!future.isFinished()) {
+        if (!wait) {
+            return;
+        }
+        if (outdated) {
+            // only the parts already being rasterized are waited for
+            future.cancel();
         }
+        future.waitForFinished();
+    }
+    if (!outdated) {
+        upload(m_rasterizedParts, future.results().toVector());
+        m_uploadedLayout = m_rasterizedLayout;
+    }
+    m_rasterizedParts.clear();
+}
 
-        const QPoint dirtyOffset = geo.topLeft() - partRect.topLeft();
-        m_texture->update(image, (position + dirtyOffset - viewport.topLeft()) * image.devicePixelRatio());
-    };
+void SceneOpenGLDecorationRenderer::render()
+{
+    if (areImageSizesDirty()) {
+        resizeTexture();
+        resetImageSizesDirty();
+    }
 
-    const QRect geometry = scheduled.boundingRect();
+    if (!texture()) {
+        // for invalid sizes we get no texture, see BUG 361551
+        return;
+    }
 
-    const QPoint topPosition(padding, padding);
-    const QPoint bottomPosition(padding, topPosition.y() + top.height() + 2 * padding);
-    const QPoint leftPosition(padding, bottomPosition.y() + bottom.height() + 2 * padding);
-    const QPoint rightPosition(padding, leftPosition.y() + left.width() + 2 * padding);
+    // The quads follow the current layout, e.g. during an interactive resize the texture
+    // may keep its size while the parts move, so contents of another layout can't be shown.
+    const Layout currentLayout = layout();
+    if (!m_renderSynchronously && m_uploadedLayout == currentLayout) {
+        finishRasterization(false);
+        startRasterization();
+        return;
+    }
 
-    renderPart(left.intersected(geometry), left, leftPosition, true);
-    renderPart(top.intersected(geometry), top, topPosition);
-    renderPart(right.intersected(geometry), right, rightPosition, true);
-    renderPart(bottom.intersected(geometry), bottom, bottomPosition);
+    // Nothing which could be shown meanwhile, wait for the parts. They are still rasterized
+    // in parallel, so an interactive resize doesn't render the parts one after another.
+    finishRasterization(true);
+    QRegion region = getScheduled();
+    if (!(m_uploadedLayout == currentLayout)) {
+        region |= QRegion(currentLayout.left) | currentLayout.top | currentLayout.right | currentLayout.bottom;
+    }
+    const QVector<Part> parts = recordParts(region, currentLayout);
+    upload(parts, QtConcurrent::blockingMapped<QVector<QImage>>(parts, &SceneOpenGLDecorationRenderer::rasterizePart));
+    m_uploadedLayout = currentLayout;
+    m_renderSynchronously = false;
 }
 
 static int align(int value, int align)
@@ -2668,21 +2875,32 @@ void SceneOpenGLDecorationRenderer::resizeTexture()
     size.rwidth() = align(size.width(), 128);
 
     size *= client()->client()->screenScale();
-    if (m_texture && m_texture->size() == size)
+    if (texture() && (m_texture ? m_texture->size() : DecorationAtlas::instance().rect(this).size()) == size)
         return;
 
-    if (!size.isEmpty()) {
-        m_texture.reset(new GLTexture(GL_RGBA8, size.width(), size.height()));
-        m_texture->setYInverted(true);
-        m_texture->setWrapMode(GL_CLAMP_TO_EDGE);
-        m_texture->clear();
-    } else {
-        m_texture.reset();
+    m_texture.reset();
+    m_renderSynchronously = true;
+    // the new area is cleared, everything has to be rendered again
+    m_uploadedLayout = Layout();
+    if (size.isEmpty()) {
+        DecorationAtlas::instance().release(this);
+        return;
     }
+    if (DecorationAtlas::instance().allocate(this, size)) {
+        return;
+    }
+
+    // too large for the atlas
+    m_texture.reset(new GLTexture(GL_RGBA8, size.width(), size.height()));
+    m_texture->setYInverted(true);
+    m_texture->setWrapMode(GL_CLAMP_TO_EDGE);
+    m_texture->clear();
 }
 
 void SceneOpenGLDecorationRenderer::reparent(Deleted *deleted)
 {
+    // the decoration can't be painted any more once the client is gone
+    m_renderSynchronously = true;
     render();
     Renderer::reparent(deleted);
 }
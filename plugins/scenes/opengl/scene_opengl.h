@@ -30,10 +30,14 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "decorations/decorationrenderer.h"
 #include "platformsupport/scenes/opengl/backend.h"
 
+#include <QFutureWatcher>
+#include <QPicture>
+
 namespace KWin
 {
 class LanczosFilter;
 class OpenGLBackend;
+class SceneOpenGLDecorationRenderer;
 class SyncManager;
 class SyncObject;
 
@@ -163,6 +167,8 @@ public:
         }
 
         GLTexture *texture;
+        // position of the leaf's texels in an atlas texture
+        QPoint textureOffset;
         int firstVertex;
         int vertexCount;
         float opacity;
@@ -178,7 +184,7 @@ public:
 
 private:
     QMatrix4x4 transformation(int mask, const WindowPaintData &data) const;
-    GLTexture *getDecorationTexture() const;
+    const SceneOpenGLDecorationRenderer *getDecorationRenderer() const;
     QMatrix4x4 modelViewProjectionMatrix(int mask, const WindowPaintData &data) const;
     QVector4D modulate(float opacity, float brightness) const;
     void setBlendEnabled(bool enabled);
@@ -288,16 +294,56 @@ public:
     void render() override;
     void reparent(Deleted *deleted) override;
 
-    GLTexture *texture() {
-        return m_texture.data();
-    }
-    GLTexture *texture() const {
-        return m_texture.data();
-    }
+    /**
+     * The texture holding the decoration parts, usually the shared DecorationAtlas.
+     */
+    GLTexture *texture() const;
+    /**
+     * The position of the decoration parts in texture(), in texels.
+     */
+    QPoint textureOffset() const;
 
 private:
+    /**
+     * A dirty area of a decoration part. The decoration paints into the picture on the
+     * main thread, which is cheap, the picture is rasterized on a worker thread.
+     */
+    struct Part {
+        QPicture picture;
+        QRect clip;
+        QRect window;
+        QRect viewport;
+        QSize imageSize;
+        qreal devicePixelRatio = 1.0;
+        bool rotated = false;
+        // in texels, relative to textureOffset()
+        QPoint texturePosition;
+    };
+    struct Layout {
+        QRect left;
+        QRect top;
+        QRect right;
+        QRect bottom;
+        qreal scale = 1.0;
+        bool operator==(const Layout &other) const;
+    };
+    Layout layout();
+    QVector<Part> recordParts(const QRegion &region, const Layout &layout);
+    static QImage rasterizePart(const Part &part);
+    void upload(const QVector<Part> &parts, const QVector<QImage> &images);
+    void startRasterization();
+    void finishRasterization(bool wait);
     void resizeTexture();
+    // only used if the decoration doesn't fit into the atlas
     QScopedPointer<GLTexture> m_texture;
+    QFutureWatcher<QImage> m_rasterizer;
+    QVector<Part> m_rasterizedParts;
+    Layout m_rasterizedLayout;
+    QRect m_rasterizedRect;
+    // the layout the contents of the texture were rendered for
+    Layout m_uploadedLayout;
+    // set while the texture must not show outdated contents, e.g. right after it got allocated
+    bool m_renderSynchronously = true;
 };
 
 inline bool SceneOpenGL::hasPendingFlush() const
@@ -0,0 +1,128 @@
+/********************************************************************
+ KWin - the KDE window manager
+ This file is part of the KDE project.
+
+Copyright (C) 2020 The KWin developers <kwin@kde.org>
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*********************************************************************/
+#include "shelf_packer.h"
+
+#include <algorithm>
+
+namespace KWin
+{
+
+ShelfPacker::ShelfPacker(const QSize &size)
+    : m_size(size)
+{
+}
+
+void ShelfPacker::setSize(const QSize &size)
+{
+    Q_ASSERT(size.height() >= usedHeight());
+    m_size = size;
+}
+
+int ShelfPacker::usedHeight() const
+{
+    if (m_shelves.isEmpty()) {
+        return 0;
+    }
+    return m_shelves.last().y + m_shelves.last().height;
+}
+
+int ShelfPacker::findGap(const Shelf &shelf, int width, int areaWidth)
+{
+    int x = 0;
+    for (const QRect &item : shelf.items) {
+        if (item.x() - x >= width) {
+            return x;
+        }
+        x = item.x() + item.width();
+    }
+    if (areaWidth - x >= width) {
+        return x;
+    }
+    return -1;
+}
+
+QRect ShelfPacker::allocate(const QSize &size)
+{
+    if (size.isEmpty() || size.width() > m_size.width()) {
+        return QRect();
+    }
+
+    // the lowest shelf with enough room wastes the least space
+    Shelf *best = nullptr;
+    int bestX = -1;
+    for (Shelf &shelf : m_shelves) {
+        if (shelf.height < size.height()) {
+            continue;
+        }
+        if (best && best->height <= shelf.height) {
+            continue;
+        }
+        const int x = findGap(shelf, size.width(), m_size.width());
+        if (x >= 0) {
+            best = &shelf;
+            bestX = x;
+        }
+    }
+
+    if (!best) {
+        const int y = usedHeight();
+        if (y + size.height() > m_size.height()) {
+            return QRect();
+        }
+        m_shelves.append(Shelf{y, size.height(), {}});
+        best = &m_shelves.last();
+        bestX = 0;
+    }
+
+    const QRect rect(QPoint(bestX, best->y), size);
+    auto it = std::lower_bound(best->items.begin(), best->items.end(), rect,
+        [](const QRect &a, const QRect &b) {
+            return a.x() < b.x();
+        }
+    );
+    best->items.insert(it, rect);
+    m_usedArea += size.width() * size.height();
+    return rect;
+}
+
+void ShelfPacker::release(const QRect &rect)
+{
+    for (Shelf &shelf : m_shelves) {
+        if (shelf.y != rect.y()) {
+            continue;
+        }
+        if (shelf.items.removeOne(rect)) {
+            m_usedArea -= rect.width() * rect.height();
+        }
+        break;
+    }
+    // give the space of empty shelves at the end back, so shelves of another height fit in
+    while (!m_shelves.isEmpty() && m_shelves.last().items.isEmpty()) {
+        m_shelves.removeLast();
+    }
+}
+
+void ShelfPacker::clear()
+{
+    m_shelves.clear();
+    m_usedArea = 0;
+}
+
+}
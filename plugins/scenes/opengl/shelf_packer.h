@@ -0,0 +1,85 @@
+/********************************************************************
+ KWin - the KDE window manager
+ This file is part of the KDE project.
+
+Copyright (C) 2020 The KWin developers <kwin@kde.org>
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*********************************************************************/
+#ifndef KWIN_SHELF_PACKER_H
+#define KWIN_SHELF_PACKER_H
+
+#include <QRect>
+#include <QVector>
+
+namespace KWin
+{
+
+/**
+ * @short Sub-allocates rectangles of a fixed size area in horizontal shelves.
+ *
+ * Every shelf has the height of the first rectangle put into it, following rectangles go
+ * into the lowest shelf they fit in, so rectangles of similar height end up next to each
+ * other. Released space is reused by later allocations, but rectangles are never moved;
+ * the owner of the packer has to repack everything to get rid of the fragmentation.
+ */
+class ShelfPacker
+{
+public:
+    explicit ShelfPacker(const QSize &size = QSize());
+
+    QSize size() const {
+        return m_size;
+    }
+    /**
+     * Changes the size of the packed area. Existing allocations are kept, so the
+     * area must not shrink below them.
+     */
+    void setSize(const QSize &size);
+
+    /**
+     * Returns the rectangle reserved for @p size or an invalid rectangle if it doesn't fit.
+     */
+    QRect allocate(const QSize &size);
+    void release(const QRect &rect);
+    void clear();
+
+    /**
+     * The sum of the areas of all allocated rectangles.
+     */
+    int usedArea() const {
+        return m_usedArea;
+    }
+    /**
+     * The height up to which the area is covered by shelves.
+     */
+    int usedHeight() const;
+
+private:
+    struct Shelf {
+        int y;
+        int height;
+        // sorted by x
+        QVector<QRect> items;
+    };
+    static int findGap(const Shelf &shelf, int width, int areaWidth);
+
+    QSize m_size;
+    QVector<Shelf> m_shelves;
+    int m_usedArea = 0;
+};
+
+}
+
+#endif
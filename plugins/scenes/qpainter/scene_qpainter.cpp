@@ -126,6 +126,7 @@ qint64 SceneQPainter::paint(QRegion damage, QList<Toplevel *> toplevels)
             m_painter->end();
         }
         m_backend->showOverlay();
+        FrameStageTimer timer(this, FrameStage::Swap);
         m_backend->present(mask, overallUpdate);
     } else {
         m_painter->begin(m_backend->buffer());
@@ -142,6 +143,7 @@ qint64 SceneQPainter::paint(QRegion damage, QList<Toplevel *> toplevels)
         m_backend->showOverlay();
 
         m_painter->end();
+        FrameStageTimer timer(this, FrameStage::Swap);
         m_backend->present(mask, updateRegion);
     }
 
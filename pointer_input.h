@@ -105,7 +105,8 @@ public:
     /**
      * @internal
      */
-    void processMotion(const QPointF &pos, const QSizeF &delta, const QSizeF &deltaNonAccelerated, uint32_t time, quint64 timeUsec, LibInput::Device *device);
+    void processMotion(const QPointF &pos, const QSizeF &delta, const QSizeF &deltaNonAccelerated, uint32_t time, quint64 timeUsec, LibInput::Device *device,
+                       const QVector<RelativePointerMotion> &motions = QVector<RelativePointerMotion>());
     /**
      * @internal
      */
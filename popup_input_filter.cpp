@@ -30,7 +30,10 @@ namespace KWin
 
 PopupInputFilter::PopupInputFilter()
     : QObject()
+    , InputEventFilter(PointerButtonEvents)
 {
+    // only needed while a popup has a grab
+    setActive(false);
     connect(waylandServer(), &WaylandServer::shellClientAdded, this, &PopupInputFilter::handleClientAdded);
 }
 
@@ -44,12 +47,14 @@ void PopupInputFilter::handleClientAdded(Toplevel *client)
         connect(client, &Toplevel::windowShown, this, &PopupInputFilter::handleClientAdded, Qt::UniqueConnection);
         connect(client, &Toplevel::windowClosed, this, &PopupInputFilter::handleClientRemoved, Qt::UniqueConnection);
         m_popupClients << client;
+        setActive(true);
     }
 }
 
 void PopupInputFilter::handleClientRemoved(Toplevel *client)
 {
     m_popupClients.removeOne(client);
+    setActive(!m_popupClients.isEmpty());
 }
 bool PopupInputFilter::pointerEvent(QMouseEvent *event, quint32 nativeButton)
 {
@@ -83,6 +88,7 @@ void PopupInputFilter::cancelPopups()
         auto c = m_popupClients.takeLast();
         c->popupDone();
     }
+    setActive(false);
 }
 
 }
@@ -22,13 +22,14 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <kconfig.h>
 #include <KXMessages>
-#include <QRegExp>
 #include <QTemporaryFile>
 #include <QFile>
 #include <QFileInfo>
 #include <QDebug>
 #include <QDir>
 
+#include <algorithm>
+
 #ifndef KCMRULES
 #include "x11client.h"
 #include "client_machine.h"
@@ -145,6 +146,7 @@ void Rules::readFromCfg(const KConfigGroup& cfg)
     READ_MATCH_STRING(windowrole, .toLower().toLatin1());
     READ_MATCH_STRING(title,);
     READ_MATCH_STRING(clientmachine, .toLower().toLatin1());
+    compileRegExps();
     types = NET::WindowTypeMask(cfg.readEntry<uint>("types", NET::AllTypesMask));
     READ_FORCE_RULE2(placement, QString(), Placement::policyFromString, false);
     READ_SET_RULE_DEF(position, , invalidPoint);
@@ -375,6 +377,23 @@ QString Rules::readDecoColor(const KConfigGroup &cfg)
                                   QLatin1String("color-schemes/") + themeName + QLatin1String(".colors"));
 }
 
+void Rules::compileRegExps()
+{
+    // rules get matched again on every caption change, compile them only once
+    auto compile = [] (QRegularExpression &regExp, StringMatch match, const QString &pattern) {
+        if (match != RegExpMatch) {
+            regExp = QRegularExpression();
+            return;
+        }
+        regExp.setPattern(pattern);
+        regExp.optimize();
+    };
+    compile(wmclassregexp, wmclassmatch, QString::fromUtf8(wmclass));
+    compile(windowroleregexp, windowrolematch, QString::fromUtf8(windowrole));
+    compile(titleregexp, titlematch, title);
+    compile(clientmachineregexp, clientmachinematch, QString::fromUtf8(clientmachine));
+}
+
 bool Rules::matchType(NET::WindowType match_type) const
 {
     if (types != NET::AllTypesMask) {
@@ -392,7 +411,7 @@ bool Rules::matchWMClass(const QByteArray& match_class, const QByteArray& match_
         // TODO optimize?
         QByteArray cwmclass = wmclasscomplete
                               ? match_name + ' ' + match_class : match_class;
-        if (wmclassmatch == RegExpMatch && QRegExp(QString::fromUtf8(wmclass)).indexIn(QString::fromUtf8(cwmclass)) == -1)
+        if (wmclassmatch == RegExpMatch && !wmclassregexp.match(QString::fromUtf8(cwmclass)).hasMatch())
             return false;
         if (wmclassmatch == ExactMatch && wmclass != cwmclass)
             return false;
@@ -405,7 +424,7 @@ bool Rules::matchWMClass(const QByteArray& match_class, const QByteArray& match_
 bool Rules::matchRole(const QByteArray& match_role) const
 {
     if (windowrolematch != UnimportantMatch) {
-        if (windowrolematch == RegExpMatch && QRegExp(QString::fromUtf8(windowrole)).indexIn(QString::fromUtf8(match_role)) == -1)
+        if (windowrolematch == RegExpMatch && !windowroleregexp.match(QString::fromUtf8(match_role)).hasMatch())
             return false;
         if (windowrolematch == ExactMatch && windowrole != match_role)
             return false;
@@ -418,7 +437,7 @@ bool Rules::matchRole(const QByteArray& match_role) const
 bool Rules::matchTitle(const QString& match_title) const
 {
     if (titlematch != UnimportantMatch) {
-        if (titlematch == RegExpMatch && QRegExp(title).indexIn(match_title) == -1)
+        if (titlematch == RegExpMatch && !titleregexp.match(match_title).hasMatch())
             return false;
         if (titlematch == ExactMatch && title != match_title)
             return false;
@@ -436,7 +455,7 @@ bool Rules::matchClientMachine(const QByteArray& match_machine, bool local) cons
                 && matchClientMachine("localhost", true))
             return true;
         if (clientmachinematch == RegExpMatch
-                && QRegExp(QString::fromUtf8(clientmachine)).indexIn(QString::fromUtf8(match_machine)) == -1)
+                && !clientmachineregexp.match(QString::fromUtf8(match_machine)).hasMatch())
             return false;
         if (clientmachinematch == ExactMatch
                 && clientmachine != match_machine)
@@ -1010,29 +1029,68 @@ void RuleBook::deleteAll()
 {
     qDeleteAll(m_rules);
     m_rules.clear();
+    m_indexDirty = true;
+}
+
+void RuleBook::updateIndex()
+{
+    m_index = Index();
+    for (int i = 0; i < m_rules.count(); ++i) {
+        const Rules *rule = m_rules.at(i);
+        if (rule->wmclassmatch == Rules::ExactMatch) {
+            // the complete class is matched as "name class"
+            m_index.wmclass[rule->wmclass] << i;
+        } else if (rule->windowrolematch == Rules::ExactMatch) {
+            m_index.windowRole[rule->windowrole] << i;
+        } else if (rule->types != NET::AllTypesMask) {
+            // NET::typeMatchesMask() tests the bit of the type
+            for (int type = NET::Normal; type < 32; ++type) {
+                if (rule->types & (1u << type)) {
+                    m_index.type[type] << i;
+                }
+            }
+        } else {
+            m_index.other << i;
+        }
+    }
+    m_indexDirty = false;
 }
 
 WindowRules RuleBook::find(const AbstractClient* c, bool ignore_temporary)
 {
+    if (m_indexDirty) {
+        updateIndex();
+    }
+    // Only the rules which can match the window are tested, in the order of the rule book.
+    NET::WindowType type = c->windowType(true);
+    if (type == NET::Unknown) {
+        type = NET::Normal; // like Rules::matchType()
+    }
+    QVector<int> candidates = m_index.other;
+    candidates << m_index.wmclass.value(c->resourceClass());
+    candidates << m_index.wmclass.value(c->resourceName() + ' ' + c->resourceClass());
+    candidates << m_index.windowRole.value(c->windowRole().toLower());
+    candidates << m_index.type.value(type);
+    std::sort(candidates.begin(), candidates.end());
+
     QVector< Rules* > ret;
-    for (QList< Rules* >::Iterator it = m_rules.begin();
-            it != m_rules.end();
-       ) {
-        if (ignore_temporary && (*it)->isTemporary()) {
-            ++it;
+    QVector< Rules* > matchedTemporary;
+    for (int i : qAsConst(candidates)) {
+        Rules *rule = m_rules.at(i);
+        if (ignore_temporary && rule->isTemporary()) {
             continue;
         }
-        if ((*it)->match(c)) {
-            Rules* rule = *it;
+        if (rule->match(c)) {
             qCDebug(KWIN_CORE) << "Rule found:" << rule << ":" << c;
             if (rule->isTemporary())
-                it = m_rules.erase(it);
-            else
-                ++it;
+                matchedTemporary.append(rule);
             ret.append(rule);
-            continue;
         }
-        ++it;
+    }
+    // temporary rules apply only once
+    for (Rules *rule : qAsConst(matchedTemporary)) {
+        m_rules.removeOne(rule);
+        m_indexDirty = true;
     }
     return WindowRules(ret);
 }
@@ -1075,6 +1133,7 @@ void RuleBook::load()
         Rules* rule = new Rules(cg);
         m_rules.append(rule);
     }
+    m_indexDirty = true;
 }
 
 void RuleBook::save()
@@ -1113,6 +1172,7 @@ void RuleBook::temporaryRulesMessage(const QString& message)
             was_temporary = true;
     Rules* rule = new Rules(message, true);
     m_rules.prepend(rule);   // highest priority first
+    m_indexDirty = true;
     if (!was_temporary)
         QTimer::singleShot(60000, this, SLOT(cleanupTemporaryRules()));
 }
@@ -1125,6 +1185,7 @@ void RuleBook::cleanupTemporaryRules()
        ) {
         if ((*it)->discardTemporary(false)) { // deletes (*it)
             it = m_rules.erase(it);
+            m_indexDirty = true;
         } else {
             if ((*it)->isTemporary())
                 has_temporary = true;
@@ -1149,6 +1210,7 @@ void RuleBook::discardUsed(AbstractClient* c, bool withdrawn)
                 c->removeRule(*it);
                 Rules* r = *it;
                 it = m_rules.erase(it);
+                m_indexDirty = true;
                 delete r;
                 continue;
             }
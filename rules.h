@@ -23,7 +23,9 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 
 #include <netwm_def.h>
+#include <QHash>
 #include <QRect>
+#include <QRegularExpression>
 #include <QVector>
 #include <kconfiggroup.h>
 
@@ -192,6 +194,7 @@ private:
         ForceRuleDummy = 256   // so that it's at least short int
     };
     void readFromCfg(const KConfigGroup& cfg);
+    void compileRegExps();
     static SetRule readSetRule(const KConfigGroup&, const QString& key);
     static ForceRule readForceRule(const KConfigGroup&, const QString& key);
     static NET::WindowType readType(const KConfigGroup&, const QString& key);
@@ -213,6 +216,11 @@ private:
     StringMatch titlematch;
     QByteArray clientmachine;
     StringMatch clientmachinematch;
+    // compiled from the strings above when a rule is read, for RegExpMatch
+    QRegularExpression wmclassregexp;
+    QRegularExpression windowroleregexp;
+    QRegularExpression titleregexp;
+    QRegularExpression clientmachineregexp;
     NET::WindowTypes types; // types for matching
     Placement::Policy placement;
     ForceRule placementrule;
@@ -287,6 +295,7 @@ private:
     QString desktopfile;
     SetRule desktopfilerule;
     friend QDebug& operator<<(QDebug& stream, const Rules*);
+    friend class RuleBook;
 };
 
 #ifndef KCMRULES
@@ -315,9 +324,23 @@ private Q_SLOTS:
 private:
     void deleteAll();
     void initWithX11();
+    void updateIndex();
     QTimer *m_updateTimer;
     bool m_updatesDisabled;
     QList<Rules*> m_rules;
+    /**
+     * Positions in m_rules of the rules which can match a window at all, by exact window
+     * class, exact window role or window type, in that order of preference. Every rule is
+     * in exactly one of them, rules with none of those restrictions are in other.
+     */
+    struct Index {
+        QHash<QByteArray, QVector<int>> wmclass;
+        QHash<QByteArray, QVector<int>> windowRole;
+        QHash<int, QVector<int>> type;
+        QVector<int> other;
+    };
+    Index m_index;
+    bool m_indexDirty = true;
     QScopedPointer<KXMessages> m_temporaryRulesMessages;
     KSharedConfig::Ptr m_config;
 
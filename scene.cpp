@@ -75,6 +75,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "deleted.h"
 #include "effects.h"
 #include "overlaywindow.h"
+#include "platform.h"
 #include "screens.h"
 #include "shadow.h"
 #include "wayland_server.h"
@@ -82,6 +83,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "thumbnailitem.h"
 
 #include <KWayland/Server/buffer_interface.h>
+#include <KWayland/Server/output_interface.h>
 #include <KWayland/Server/subcompositor_interface.h>
 #include <KWayland/Server/surface_interface.h>
 
@@ -94,6 +96,7 @@ namespace KWin
 
 Scene::Scene(QObject *parent)
     : QObject(parent)
+    , m_recordFrameTimings(qEnvironmentVariableIntValue("KWIN_FRAME_TIMINGS") != 0)
 {
     last_time.invalidate(); // Initialize the timer
 }
@@ -121,7 +124,10 @@ void Scene::paintScreen(int* mask, const QRegion &damage, const QRegion &repaint
     pdata.mask = *mask;
     pdata.paint = region;
 
-    effects->prePaintScreen(pdata, time_diff);
+    {
+        FrameStageTimer timer(this, FrameStage::EffectsPrePaint);
+        effects->prePaintScreen(pdata, time_diff);
+    }
     *mask = pdata.mask;
     region = pdata.paint;
 
@@ -146,7 +152,10 @@ void Scene::paintScreen(int* mask, const QRegion &damage, const QRegion &repaint
     }
 
     ScreenPaintData data(projection, outputGeometry);
-    effects->paintScreen(*mask, region, data);
+    {
+        FrameStageTimer timer(this, FrameStage::EffectsPaint);
+        effects->paintScreen(*mask, region, data);
+    }
 
     foreach (Window *w, stacking_order) {
         effects->postPaintWindow(effectWindow(w));
@@ -165,6 +174,31 @@ void Scene::paintScreen(int* mask, const QRegion &damage, const QRegion &repaint
     Q_ASSERT(!PaintClipper::clip());
 }
 
+void Scene::addFrameStageTime(FrameStage stage, qint64 nsecs)
+{
+    switch (stage) {
+    case FrameStage::EffectsPrePaint:
+        m_frameTimings.effectsPrePaint += nsecs;
+        break;
+    case FrameStage::EffectsPaint:
+        m_frameTimings.effectsPaint += nsecs;
+        break;
+    case FrameStage::TextureUpload:
+        m_frameTimings.textureUpload += nsecs;
+        break;
+    case FrameStage::Swap:
+        m_frameTimings.swap += nsecs;
+        break;
+    }
+}
+
+void Scene::finishFrameTimings(qint64 nsecs)
+{
+    m_frameTimings.paint = nsecs;
+    m_lastFrameTimings = m_frameTimings;
+    m_frameTimings = FrameTimings();
+}
+
 // Compute time since the last painting pass.
 void Scene::updateTimeDiff()
 {
@@ -223,7 +257,10 @@ void Scene::paintGenericScreen(int orig_mask, ScreenPaintData)
         data.clip = QRegion();
         data.quads = w->buildQuads();
         // preparation step
-        effects->prePaintWindow(effectWindow(w), data, time_diff);
+        {
+            FrameStageTimer timer(this, FrameStage::EffectsPrePaint);
+            effects->prePaintWindow(effectWindow(w), data, time_diff);
+        }
 #if !defined(QT_NO_DEBUG)
         if (data.quads.isTransformed()) {
             qFatal("Pre-paint calls are not allowed to transform quads!");
@@ -291,7 +328,10 @@ void Scene::paintSimpleScreen(int orig_mask, QRegion region)
         }
         data.quads = window->buildQuads();
         // preparation step
-        effects->prePaintWindow(effectWindow(window), data, time_diff);
+        {
+            FrameStageTimer timer(this, FrameStage::EffectsPrePaint);
+            effects->prePaintWindow(effectWindow(window), data, time_diff);
+        }
 #if !defined(QT_NO_DEBUG)
         if (data.quads.isTransformed()) {
             qFatal("Pre-paint calls are not allowed to transform quads!");
@@ -455,6 +495,145 @@ void Scene::clearStackingOrder()
     stacking_order.clear();
 }
 
+// Planes show the buffer as it is, they can't apply wl_surface.set_buffer_transform
+static bool hasUntransformedBuffer(KWayland::Server::SurfaceInterface *surface)
+{
+    return surface->transform() == KWayland::Server::OutputInterface::Transform::Normal;
+}
+
+// Whether nothing below the window can be seen through its buffer
+static bool isOpaqueBuffer(Toplevel *toplevel)
+{
+    if (toplevel->opacity() != 1.0) {
+        return false;
+    }
+    if (!toplevel->hasAlpha()) {
+        return true;
+    }
+    const QRect clientRect(QPoint(0, 0), toplevel->clientSize());
+    return (QRegion(clientRect) - toplevel->opaqueRegion()).isEmpty();
+}
+
+Scene::Window *Scene::findScanoutCandidate(const QRect &outputGeometry) const
+{
+    if (kwinApp()->platform()->usesSoftwareCursor()) {
+        // the cursor is part of the composited frame
+        return nullptr;
+    }
+    if (static_cast<EffectsHandlerImpl*>(effects)->blocksDirectScanout()) {
+        return nullptr;
+    }
+    // Only the topmost window on the output matters, it has to hide everything below
+    for (auto it = stacking_order.crbegin(); it != stacking_order.crend(); ++it) {
+        Window *window = *it;
+        Toplevel *toplevel = window->window();
+        if (!window->isVisible() || !toplevel->visibleRect().intersects(outputGeometry)) {
+            continue;
+        }
+        AbstractClient *client = qobject_cast<AbstractClient *>(toplevel);
+        if (!client || !client->isFullScreen() || client->isDecorated() ||
+                client->frameGeometry() != outputGeometry) {
+            return nullptr;
+        }
+        KWayland::Server::SurfaceInterface *surface = toplevel->surface();
+        if (!surface || !surface->buffer() || !surface->childSubSurfaces().isEmpty()) {
+            return nullptr;
+        }
+        if (!hasUntransformedBuffer(surface) || !isOpaqueBuffer(toplevel)) {
+            return nullptr;
+        }
+        return window;
+    }
+    return nullptr;
+}
+
+static bool isOverlayCandidate(Scene::Window *window, const QRect &outputGeometry)
+{
+    Toplevel *toplevel = window->window();
+    KWayland::Server::SurfaceInterface *surface = toplevel->surface();
+    if (!surface || !surface->buffer() || !surface->buffer()->linuxDmabufBuffer()) {
+        return false;
+    }
+    if (!surface->childSubSurfaces().isEmpty() || !hasUntransformedBuffer(surface)) {
+        return false;
+    }
+    // A plane shows the buffer only, without decoration, shadow or window opacity
+    if (toplevel->opacity() != 1.0 || !toplevel->bufferGeometry().contains(toplevel->visibleRect())) {
+        return false;
+    }
+    return outputGeometry.contains(toplevel->bufferGeometry());
+}
+
+QVector<Scene::Window *> Scene::findOverlayCandidates(const QRect &outputGeometry) const
+{
+    if (kwinApp()->platform()->usesSoftwareCursor()) {
+        // the cursor is part of the composited frame and would end up below the planes
+        return QVector<Window *>();
+    }
+    if (static_cast<EffectsHandlerImpl*>(effects)->blocksDirectScanout()) {
+        return QVector<Window *>();
+    }
+    if (findScanoutCandidate(outputGeometry)) {
+        return QVector<Window *>();
+    }
+    QVector<Window *> candidates;
+    // Everything composited above a window would end up below its plane
+    QRegion covered;
+    for (auto it = stacking_order.crbegin(); it != stacking_order.crend(); ++it) {
+        Window *window = *it;
+        if (!window->isVisible()) {
+            continue;
+        }
+        const QRect visibleRect = window->window()->visibleRect();
+        if (!visibleRect.intersects(outputGeometry)) {
+            continue;
+        }
+        if (isOverlayCandidate(window, outputGeometry) && !covered.intersects(visibleRect)) {
+            candidates.prepend(window);
+        }
+        covered |= visibleRect;
+    }
+    return candidates;
+}
+
+QRegion Scene::updateOverlayPlanes(const QRect &outputGeometry, const QRegion &damage, const OverlayPlaneAssignment &assign)
+{
+    const QVector<Window *> assigned = assign(findOverlayCandidates(outputGeometry));
+    QRegion ret = damage;
+    for (Window *window : qAsConst(stacking_order)) {
+        const bool wasAssigned = window->overlayPlaneOutput() == outputGeometry;
+        if (!assigned.contains(window)) {
+            if (wasAssigned) {
+                // the window has to be composited again
+                ret |= window->overlayPlaneGeometry();
+                ret |= window->window()->visibleRect();
+                window->setOverlayPlane(QRect(), QRect());
+            }
+            continue;
+        }
+        const QRect geometry = window->window()->bufferGeometry();
+        if (!wasAssigned || window->overlayPlaneGeometry() != geometry) {
+            // the composited frame must not show the window anymore
+            if (wasAssigned) {
+                ret |= window->overlayPlaneGeometry();
+            }
+            ret |= geometry;
+            window->setOverlayPlane(outputGeometry, geometry);
+        } else if (isOpaqueBuffer(window->window())) {
+            // nothing below the plane can be seen, the window's damage doesn't need compositing
+            ret -= geometry;
+        }
+    }
+    return ret & outputGeometry;
+}
+
+void Scene::resetRepaints()
+{
+    for (Window *window : qAsConst(stacking_order)) {
+        window->window()->resetRepaints();
+    }
+}
+
 static Scene::Window *s_recursionCheck = nullptr;
 
 void Scene::paintWindow(Window* w, int mask, QRegion region, WindowQuadList quads)
@@ -846,6 +1025,10 @@ void Scene::Window::resetPaintingEnabled()
     }
     if (!toplevel->isOnCurrentActivity())
         disable_painting |= PAINT_DISABLED_BY_ACTIVITY;
+    if (!m_overlayPlaneOutput.isNull() && m_overlayPlaneGeometry == toplevel->bufferGeometry()) {
+        // a window which moved is composited until its plane is updated
+        disable_painting |= PAINT_DISABLED_BY_OVERLAY_PLANE;
+    }
     if (AbstractClient *c = dynamic_cast<AbstractClient*>(toplevel)) {
         if (c->isMinimized())
             disable_painting |= PAINT_DISABLED_BY_MINIMIZE;
@@ -855,6 +1038,12 @@ void Scene::Window::resetPaintingEnabled()
     }
 }
 
+void Scene::Window::setOverlayPlane(const QRect &outputGeometry, const QRect &geometry)
+{
+    m_overlayPlaneOutput = outputGeometry;
+    m_overlayPlaneGeometry = geometry;
+}
+
 void Scene::Window::enablePainting(int reason)
 {
     disable_painting &= ~reason;
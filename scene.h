@@ -28,6 +28,8 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <QElapsedTimer>
 #include <QMatrix4x4>
 
+#include <functional>
+
 class QOpenGLFramebufferObject;
 
 namespace KWayland
@@ -198,6 +200,90 @@ public:
      */
     virtual QVector<QByteArray> openGLPlatformInterfaceExtensions() const;
 
+    /**
+     * Stages of painting a frame whose duration is tracked by the Scene.
+     */
+    enum class FrameStage {
+        /**
+         * The prePaintScreen() and prePaintWindow() passes of the effects.
+         */
+        EffectsPrePaint,
+        /**
+         * The paintScreen() pass of the effects, including drawing the windows.
+         */
+        EffectsPaint,
+        /**
+         * Updating window textures from the client buffers.
+         */
+        TextureUpload,
+        /**
+         * Starting and finishing the frame in the backend, which includes swapping buffers.
+         */
+        Swap
+    };
+    /**
+     * Time spent on the compositor thread painting a frame, in nanoseconds.
+     *
+     * The stages overlap: @c paint covers the whole paint() call, @c effectsPaint
+     * includes painting the windows, which runs their prePaintWindow() pass and the
+     * @c textureUpload.
+     */
+    struct FrameTimings {
+        qint64 paint = 0;
+        qint64 effectsPrePaint = 0;
+        qint64 effectsPaint = 0;
+        qint64 textureUpload = 0;
+        qint64 swap = 0;
+    };
+    /**
+     * Whether the frame timings are recorded, which is enabled by setting the environment
+     * variable KWIN_FRAME_TIMINGS to 1. Otherwise lastFrameTimings() stays empty.
+     */
+    bool recordsFrameTimings() const {
+        return m_recordFrameTimings;
+    }
+    /**
+     * Adds @p nsecs to the time spent in @p stage during the current frame.
+     */
+    void addFrameStageTime(FrameStage stage, qint64 nsecs);
+    /**
+     * Completes the timings of the current frame, @p nsecs is the duration of paint().
+     * Invoked by the Compositor.
+     */
+    void finishFrameTimings(qint64 nsecs);
+    /**
+     * The timings of the last frame painted by the Scene.
+     */
+    const FrameTimings &lastFrameTimings() const {
+        return m_lastFrameTimings;
+    }
+
+    /**
+     * Adds the time until it goes out of scope to a FrameStage of the current frame,
+     * if the Scene records frame timings.
+     */
+    class FrameStageTimer
+    {
+    public:
+        FrameStageTimer(Scene *scene, FrameStage stage)
+            : m_scene(scene)
+            , m_stage(stage)
+        {
+            if (m_scene->recordsFrameTimings()) {
+                m_timer.start();
+            }
+        }
+        ~FrameStageTimer() {
+            if (m_timer.isValid()) {
+                m_scene->addFrameStageTime(m_stage, m_timer.nsecsElapsed());
+            }
+        }
+    private:
+        Scene *m_scene;
+        FrameStage m_stage;
+        QElapsedTimer m_timer;
+    };
+
 Q_SIGNALS:
     void frameRendered();
     void resetCompositing();
@@ -211,6 +297,30 @@ protected:
     virtual Window *createWindow(Toplevel *toplevel) = 0;
     void createStackingOrder(QList<Toplevel *> toplevels);
     void clearStackingOrder();
+    /**
+     * Returns the window which alone covers the output at @p outputGeometry and whose
+     * buffer can be presented on that output as is, or @c nullptr if the output needs
+     * to be composited.
+     */
+    Window *findScanoutCandidate(const QRect &outputGeometry) const;
+    /**
+     * Resets the repaints of all windows in the stacking order, for outputs which were
+     * updated without going through paintScreen().
+     */
+    void resetRepaints();
+    /**
+     * Returns the windows on the output at @p outputGeometry which could be shown on
+     * overlay planes, ordered from bottom to top. Nothing composited is above them.
+     */
+    QVector<Window *> findOverlayCandidates(const QRect &outputGeometry) const;
+    using OverlayPlaneAssignment = std::function<QVector<Window *>(const QVector<Window *> &candidates)>;
+    /**
+     * Lets @p assign put the overlay candidates of the output at @p outputGeometry on
+     * overlay planes. Windows on a plane are not painted.
+     *
+     * @returns @p damage adjusted to the windows which moved to or from a plane
+     */
+    QRegion updateOverlayPlanes(const QRect &outputGeometry, const QRegion &damage, const OverlayPlaneAssignment &assign);
     // shared implementation, starts painting the screen
     void paintScreen(int *mask, const QRegion &damage, const QRegion &repaint,
                      QRegion *updateRegion, QRegion *validRegion, const QMatrix4x4 &projection = QMatrix4x4(), const QRect &outputGeometry = QRect());
@@ -268,6 +378,9 @@ private:
     QHash< Toplevel*, Window* > m_windows;
     // windows in their stacking order
     QVector< Window* > stacking_order;
+    FrameTimings m_frameTimings;
+    FrameTimings m_lastFrameTimings;
+    bool m_recordFrameTimings;
 };
 
 /**
@@ -324,12 +437,28 @@ public:
         // Window will not be painted because it is minimized
         PAINT_DISABLED_BY_MINIMIZE     = 1 << 3,
         // Window will not be painted because it's not on the current activity
-        PAINT_DISABLED_BY_ACTIVITY     = 1 << 5
+        PAINT_DISABLED_BY_ACTIVITY     = 1 << 5,
+        // Window will not be painted because it is shown on an overlay plane
+        PAINT_DISABLED_BY_OVERLAY_PLANE = 1 << 6
     };
     void enablePainting(int reason);
     void disablePainting(int reason);
     // is the window visible at all
     bool isVisible() const;
+    /**
+     * The geometry of the output on whose overlay plane the window is shown, a null
+     * rect if the window is composited.
+     */
+    QRect overlayPlaneOutput() const {
+        return m_overlayPlaneOutput;
+    }
+    /**
+     * Where the overlay plane shows the window.
+     */
+    QRect overlayPlaneGeometry() const {
+        return m_overlayPlaneGeometry;
+    }
+    void setOverlayPlane(const QRect &outputGeometry, const QRect &geometry);
     // is the window fully opaque
     bool isOpaque() const;
     // shape of the window
@@ -382,6 +511,8 @@ private:
     QScopedPointer<WindowPixmap> m_previousPixmap;
     int m_referencePixmapCounter;
     int disable_painting;
+    QRect m_overlayPlaneOutput;
+    QRect m_overlayPlaneGeometry;
     mutable QRegion m_bufferShape;
     mutable bool m_bufferShapeIsValid = false;
     mutable QScopedPointer<WindowQuadList> cached_quad_list;
@@ -1159,6 +1159,7 @@ bool TabBox::toggleMode(TabBoxMode mode)
         return false;
     m_noModifierGrab = m_tabGrab = true;
     setMode(mode);
+    emit grabbedChanged();
     reset();
     show();
     return true;
@@ -1171,6 +1172,7 @@ bool TabBox::startKDEWalkThroughWindows(TabBoxMode mode)
     m_tabGrab = true;
     m_noModifierGrab = false;
     setMode(mode);
+    emit grabbedChanged();
     reset();
     return true;
 }
@@ -1182,6 +1184,7 @@ bool TabBox::startWalkThroughDesktops(TabBoxMode mode)
     m_desktopGrab = true;
     m_noModifierGrab = false;
     setMode(mode);
+    emit grabbedChanged();
     reset();
     return true;
 }
@@ -1413,6 +1416,7 @@ void TabBox::close(bool abort)
     m_tabGrab = false;
     m_desktopGrab = false;
     m_noModifierGrab = false;
+    emit grabbedChanged();
 }
 
 void TabBox::accept(bool closeTabBox)
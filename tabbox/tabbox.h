@@ -295,6 +295,10 @@ Q_SIGNALS:
     void tabBoxClosed();
     void tabBoxUpdated();
     void tabBoxKeyEvent(QKeyEvent*);
+    /**
+     * Emitted when the tabbox may have established or released its grab, see isGrabbed().
+     */
+    void grabbedChanged();
 
 private:
     explicit TabBox(QObject *parent);
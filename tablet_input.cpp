@@ -91,7 +91,7 @@ void TabletInputRedirection::tabletToolEvent(KWin::InputRedirection::TabletEvent
                     Qt::NoModifier, serialId, button, button);
 
     input()->processSpies(std::bind(&InputEventSpy::tabletToolEvent, std::placeholders::_1, &ev));
-    input()->processFilters(
+    input()->processFilters(InputEventFilter::TabletEvents,
         std::bind(&InputEventFilter::tabletToolEvent, std::placeholders::_1, &ev));
 
     m_tipDown = tipDown;
@@ -107,8 +107,8 @@ void KWin::TabletInputRedirection::tabletToolButtonEvent(uint button, bool isPre
 
     input()->processSpies(std::bind(&InputEventSpy::tabletToolButtonEvent,
                                     std::placeholders::_1, m_toolPressedButtons));
-    input()->processFilters(std::bind( &InputEventFilter::tabletToolButtonEvent,
-                                      std::placeholders::_1, m_toolPressedButtons));
+    input()->processFilters(InputEventFilter::TabletEvents,
+        std::bind(&InputEventFilter::tabletToolButtonEvent, std::placeholders::_1, m_toolPressedButtons));
 }
 
 void KWin::TabletInputRedirection::tabletPadButtonEvent(uint button, bool isPressed)
@@ -121,24 +121,24 @@ void KWin::TabletInputRedirection::tabletPadButtonEvent(uint button, bool isPres
 
     input()->processSpies(std::bind( &InputEventSpy::tabletPadButtonEvent,
                                      std::placeholders::_1, m_padPressedButtons));
-    input()->processFilters(std::bind( &InputEventFilter::tabletPadButtonEvent,
-                                       std::placeholders::_1, m_padPressedButtons));
+    input()->processFilters(InputEventFilter::TabletEvents,
+        std::bind(&InputEventFilter::tabletPadButtonEvent, std::placeholders::_1, m_padPressedButtons));
 }
 
 void KWin::TabletInputRedirection::tabletPadStripEvent(int number, int position, bool isFinger)
 {
     input()->processSpies(std::bind( &InputEventSpy::tabletPadStripEvent,
                                      std::placeholders::_1, number, position, isFinger));
-    input()->processFilters(std::bind( &InputEventFilter::tabletPadStripEvent,
-                                       std::placeholders::_1, number, position, isFinger));
+    input()->processFilters(InputEventFilter::TabletEvents,
+        std::bind(&InputEventFilter::tabletPadStripEvent, std::placeholders::_1, number, position, isFinger));
 }
 
 void KWin::TabletInputRedirection::tabletPadRingEvent(int number, int position, bool isFinger)
 {
     input()->processSpies(std::bind( &InputEventSpy::tabletPadRingEvent,
                                      std::placeholders::_1, number, position, isFinger));
-    input()->processFilters(std::bind( &InputEventFilter::tabletPadRingEvent,
-                                       std::placeholders::_1, number, position, isFinger));
+    input()->processFilters(InputEventFilter::TabletEvents,
+        std::bind(&InputEventFilter::tabletPadRingEvent, std::placeholders::_1, number, position, isFinger));
 }
 
 void TabletInputRedirection::cleanupDecoration(Decoration::DecoratedClientImpl *old,
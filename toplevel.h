@@ -660,6 +660,11 @@ Q_SIGNALS:
      * This signal is emitted when the Toplevel's frame geometry changes.
      */
     void frameGeometryChanged(KWin::Toplevel *toplevel, const QRect &oldGeometry);
+    /**
+     * This signal is emitted when the input geometry changes while the frame geometry
+     * stays the same, e.g. when the resize only borders of the decoration change.
+     */
+    void inputGeometryChanged();
 
 protected Q_SLOTS:
     /**
@@ -547,6 +547,8 @@ Workspace::~Workspace()
         if (!c) {
             continue;
         }
+        // The window ids are gone once the window is released
+        unindexClientWindows(c);
         // Only release the window
         c->releaseWindow(true);
         // No removeClient() is called, it does more than just removing.
@@ -556,6 +558,7 @@ Workspace::~Workspace()
         m_allClients.removeAll(c);
         desktops.removeAll(c);
     }
+    m_clientWindowIds.clear();
     X11Client::cleanupX11();
 
     if (waylandServer()) {
@@ -657,6 +660,7 @@ void Workspace::addClient(X11Client *c)
         clients.append(c);
         m_allClients.append(c);
     }
+    indexClientWindows(c);
     if (!unconstrained_stacking_order.contains(c))
         unconstrained_stacking_order.append(c);   // Raise if it hasn't got any stacking position yet
     if (!stacking_order.contains(c))    // It'll be updated later, and updateToolWindows() requires
@@ -681,9 +685,43 @@ void Workspace::addClient(X11Client *c)
 void Workspace::addUnmanaged(Unmanaged* c)
 {
     unmanaged.append(c);
+    m_unmanagedWindowIds.insert(c->window(), c);
     markXStackingOrderAsDirty();
 }
 
+void Workspace::indexClientWindows(X11Client *c)
+{
+    const xcb_window_t ids[] = { c->window(), c->wrapperId(), c->frameId(), c->inputId() };
+    for (xcb_window_t id : ids) {
+        if (id != XCB_WINDOW_NONE) {
+            m_clientWindowIds.insert(id, c);
+        }
+    }
+}
+
+void Workspace::unindexClientWindows(X11Client *c)
+{
+    const xcb_window_t ids[] = { c->window(), c->wrapperId(), c->frameId(), c->inputId() };
+    for (xcb_window_t id : ids) {
+        auto it = m_clientWindowIds.find(id);
+        if (it != m_clientWindowIds.end() && it.value() == c) {
+            m_clientWindowIds.erase(it);
+        }
+    }
+}
+
+void Workspace::updateClientInputId(X11Client *c, xcb_window_t oldInputId)
+{
+    auto it = m_clientWindowIds.find(oldInputId);
+    if (it != m_clientWindowIds.end() && it.value() == c) {
+        m_clientWindowIds.erase(it);
+    }
+    // only managed clients are indexed
+    if (c->inputId() != XCB_WINDOW_NONE && m_clientWindowIds.value(c->window()) == c) {
+        m_clientWindowIds.insert(c->inputId(), c);
+    }
+}
+
 /**
  * Destroys the client \a c
  */
@@ -707,6 +745,7 @@ void Workspace::removeClient(X11Client *c)
     clients.removeAll(c);
     m_allClients.removeAll(c);
     desktops.removeAll(c);
+    unindexClientWindows(c);
     markXStackingOrderAsDirty();
     attention_chain.removeAll(c);
     Group* group = findGroup(c->window());
@@ -733,6 +772,7 @@ void Workspace::removeUnmanaged(Unmanaged* c)
 {
     Q_ASSERT(unmanaged.contains(c));
     unmanaged.removeAll(c);
+    m_unmanagedWindowIds.remove(c->window());
     emit unmanagedRemoved(c);
     markXStackingOrderAsDirty();
 }
@@ -1680,30 +1720,25 @@ Unmanaged *Workspace::findUnmanaged(std::function<bool (const Unmanaged*)> func)
 
 Unmanaged *Workspace::findUnmanaged(xcb_window_t w) const
 {
-    return findUnmanaged([w](const Unmanaged *u) {
-        return u->window() == w;
-    });
+    return m_unmanagedWindowIds.value(w);
 }
 
 X11Client *Workspace::findClient(Predicate predicate, xcb_window_t w) const
 {
+    // All windows of a client share one index, check that w is the requested kind
+    X11Client *c = m_clientWindowIds.value(w);
+    if (!c) {
+        return nullptr;
+    }
     switch (predicate) {
     case Predicate::WindowMatch:
-        return findClient([w](const X11Client *c) {
-            return c->window() == w;
-        });
+        return c->window() == w ? c : nullptr;
     case Predicate::WrapperIdMatch:
-        return findClient([w](const X11Client *c) {
-            return c->wrapperId() == w;
-        });
+        return c->wrapperId() == w ? c : nullptr;
     case Predicate::FrameIdMatch:
-        return findClient([w](const X11Client *c) {
-            return c->frameId() == w;
-        });
+        return c->frameId() == w ? c : nullptr;
     case Predicate::InputIdMatch:
-        return findClient([w](const X11Client *c) {
-            return c->inputId() == w;
-        });
+        return c->inputId() == w ? c : nullptr;
     }
     return nullptr;
 }
@@ -29,6 +29,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "sm.h"
 #include "utils.h"
 // Qt
+#include <QHash>
 #include <QTimer>
 #include <QVector>
 // std
@@ -327,6 +328,7 @@ public:
     void sendPingToWindow(xcb_window_t w, xcb_timestamp_t timestamp);   // Called from X11Client::pingWindow()
 
     void removeClient(X11Client *);   // Only called from X11Client::destroyClient() or X11Client::releaseWindow()
+    void updateClientInputId(X11Client *c, xcb_window_t oldInputId);   // Called when the decoration input window changes
     void setActiveClient(AbstractClient*);
     Group* findGroup(xcb_window_t leader) const;
     void addGroup(Group* group);
@@ -564,6 +566,8 @@ private:
     void addClient(X11Client *c);
     Unmanaged* createUnmanaged(xcb_window_t w);
     void addUnmanaged(Unmanaged* c);
+    void indexClientWindows(X11Client *c);
+    void unindexClientWindows(X11Client *c);
 
     //---------------------------------------------------------------------
 
@@ -601,6 +605,10 @@ private:
     QList<X11Client *> desktops;
     QList<Unmanaged *> unmanaged;
     QList<Deleted *> deleted;
+    // X11 window ids of the managed clients (client, wrapper, frame and input window)
+    // and of the unmanaged windows, to dispatch X events without walking the lists
+    QHash<xcb_window_t, X11Client *> m_clientWindowIds;
+    QHash<xcb_window_t, Unmanaged *> m_unmanagedWindowIds;
     QList<InternalClient *> m_internalClients;
 
     QList<Toplevel *> unconstrained_stacking_order; // Topmost last
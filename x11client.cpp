@@ -998,7 +998,11 @@ void X11Client::updateInputWindow()
     }
 
     if (region.isEmpty()) {
-        m_decoInputExtent.reset();
+        if (m_decoInputExtent.isValid()) {
+            const xcb_window_t oldInputId = m_decoInputExtent;
+            m_decoInputExtent.reset();
+            workspace()->updateClientInputId(this, oldInputId);
+        }
         return;
     }
 
@@ -1021,6 +1025,7 @@ void X11Client::updateInputWindow()
             XCB_EVENT_MASK_POINTER_MOTION
         };
         m_decoInputExtent.create(bounds, XCB_WINDOW_CLASS_INPUT_ONLY, mask, values);
+        workspace()->updateClientInputId(this, XCB_WINDOW_NONE);
         if (mapping_state == Mapped)
             m_decoInputExtent.map();
     } else {
@@ -1103,7 +1108,11 @@ void X11Client::destroyDecoration()
             emit geometryShapeChanged(this, oldgeom);
         }
     }
-    m_decoInputExtent.reset();
+    if (m_decoInputExtent.isValid()) {
+        const xcb_window_t oldInputId = m_decoInputExtent;
+        m_decoInputExtent.reset();
+        workspace()->updateClientInputId(this, oldInputId);
+    }
 }
 
 void X11Client::layoutDecorationRects(QRect &left, QRect &top, QRect &right, QRect &bottom) const
@@ -40,6 +40,8 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <xcb/xfixes.h>
 
 #include <algorithm>
+#include <cerrno>
+#include <fcntl.h>
 #include <unistd.h>
 
 #include <xwayland_logging.h>
@@ -49,15 +51,39 @@ namespace KWin
 namespace Xwl
 {
 
-// in Bytes: equals 64KB
+// in Bytes: equals 64KB, lower bound of the chunk size
 static const uint32_t s_incrChunkSize = 63 * 1024;
+// in Bytes: upper bound of the chunk size, also limits the time spent per event loop iteration
+static const uint32_t s_maxIncrChunkSize = 1024 * 1024;
+// number of chunks read ahead from a Wayland source before waiting for the X client
+static const int s_maxPendingChunks = 4;
+
+static int incrChunkSize()
+{
+    // the maximum request length is given in four byte units, with BIG-REQUESTS
+    // it is the extended length; leave room for the ChangeProperty request itself
+    const uint64_t maxRequestLength = uint64_t(xcb_get_maximum_request_length(kwinApp()->x11Connection())) * 4;
+    const uint64_t available = maxRequestLength > 1024 ? maxRequestLength - 1024 : 0;
+    return qBound(uint64_t(s_incrChunkSize), available, uint64_t(s_maxIncrChunkSize));
+}
 
 Transfer::Transfer(xcb_atom_t selection, qint32 fd, xcb_timestamp_t timestamp, QObject *parent)
     : QObject(parent)
     , m_atom(selection)
     , m_fd(fd)
     , m_timestamp(timestamp)
+    , m_chunkSize(incrChunkSize())
 {
+    // the fd is polled through a socket notifier, reads and writes must not block the event loop
+    const int flags = fcntl(m_fd, F_GETFL);
+    if (flags != -1) {
+        fcntl(m_fd, F_SETFL, flags | O_NONBLOCK);
+    }
+#ifdef F_SETPIPE_SZ
+    // a pipe holds 64KB by default, let it take a whole chunk so that it can be moved
+    // with a single read or write; may fail beyond the system limit, which is fine
+    fcntl(m_fd, F_SETPIPE_SZ, m_chunkSize);
+#endif
 }
 
 void Transfer::createSocketNotifier(QSocketNotifier::Type type)
@@ -153,7 +179,7 @@ void TransferWltoX::startIncr()
                                   XCB_CW_EVENT_MASK, mask);
 
     // spec says to make the available space larger
-    const uint32_t chunkSpace = 1024 + s_incrChunkSize;
+    const uint32_t chunkSpace = 1024 + chunkSize();
     xcb_change_property(xcbConn,
                         XCB_PROP_MODE_REPLACE,
                         m_request->requestor,
@@ -165,68 +191,118 @@ void TransferWltoX::startIncr()
     setIncr(true);
     // first data will be flushed after the property has been deleted
     // again by the requestor
-    m_flushPropertyOnDelete = true;
     m_propertyIsSet = true;
     Q_EMIT selectionNotify(m_request, true);
 }
 
-void TransferWltoX::readWlSource()
+void TransferWltoX::endIncr()
 {
-    if (m_chunks.size() == 0 ||
-            m_chunks.last().second == s_incrChunkSize) {
-        // append new chunk
-        auto next = QPair<QByteArray, int>();
-        next.first.resize(s_incrChunkSize);
-        next.second = 0;
-        m_chunks.append(next);
-    }
+    xcb_connection_t *xcbConn = kwinApp()->x11Connection();
 
-    const auto oldLen = m_chunks.last().second;
-    const auto avail = s_incrChunkSize - m_chunks.last().second;
-    Q_ASSERT(avail > 0);
+    uint32_t mask[] = {0};
+    xcb_change_window_attributes (xcbConn,
+                                  m_request->requestor,
+                                  XCB_CW_EVENT_MASK, mask);
 
-    ssize_t readLen = read(fd(), m_chunks.last().first.data() + oldLen, avail);
-    if (readLen == -1) {
-        qCWarning(KWIN_XWL) << "Error reading in Wl data.";
+    // a zero-length property marks the end of the incremental transfer
+    xcb_change_property(xcbConn,
+                        XCB_PROP_MODE_REPLACE,
+                        m_request->requestor,
+                        m_request->property,
+                        m_request->target,
+                        8, 0, nullptr);
+    xcb_flush(xcbConn);
+    endTransfer();
+}
 
-        // TODO: cleanup X side?
-        endTransfer();
-        return;
-    }
-    m_chunks.last().second = oldLen + readLen;
+bool TransferWltoX::hasCompleteChunk() const
+{
+    // a chunk is complete when it is full, the last one is shrunk at the fd end
+    return !m_chunks.isEmpty() &&
+            m_chunks.first().second == m_chunks.first().first.size();
+}
 
-    if (readLen == 0) {
-        // at the fd end - complete transfer now
-        m_chunks.last().first.resize(m_chunks.last().second);
+void TransferWltoX::readWlSource()
+{
+    // Reads at most until the current chunk is full. A large transfer returns to the
+    // event loop in between, so it can't starve the processing of other events.
+    while (true) {
+        if (m_chunks.isEmpty() ||
+                m_chunks.last().second == chunkSize()) {
+            // append new chunk
+            auto next = QPair<QByteArray, int>();
+            next.first.resize(chunkSize());
+            next.second = 0;
+            m_chunks.append(next);
+        }
 
-        if (incr()) {
-            // incremental transfer is to be completed now
-            m_flushPropertyOnDelete = true;
-            if (!m_propertyIsSet) {
-                // flush if target's property is not set at the moment
-                flushSourceData();
+        const auto oldLen = m_chunks.last().second;
+        const auto avail = chunkSize() - oldLen;
+        Q_ASSERT(avail > 0);
+
+        const ssize_t readLen = read(fd(), m_chunks.last().first.data() + oldLen, avail);
+        if (readLen == -1) {
+            if (errno == EINTR) {
+                continue;
             }
-            clearSocketNotifier();
-        } else {
-            // non incremental transfer is to be completed now,
-            // data can be transferred to X client via a single property set
-            flushSourceData();
-            Q_EMIT selectionNotify(m_request, true);
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                // pipe drained for now
+                break;
+            }
+            qCWarning(KWIN_XWL) << "Error reading in Wl data.";
+
+            // TODO: cleanup X side?
             endTransfer();
+            return;
         }
-    } else if (m_chunks.last().second == s_incrChunkSize) {
-        // first chunk full, but not yet at fd end -> go incremental
-        if (incr()) {
-            m_flushPropertyOnDelete = true;
-            if (!m_propertyIsSet) {
-                // flush if target's property is not set at the moment
+        m_chunks.last().second = oldLen + readLen;
+
+        if (readLen == 0) {
+            // at the fd end - complete transfer now
+            m_chunks.last().first.resize(m_chunks.last().second);
+            clearSocketNotifier();
+
+            if (incr()) {
+                if (m_chunks.last().second == 0) {
+                    // nothing read since the last full chunk
+                    m_chunks.removeLast();
+                }
+                // incremental transfer is to be completed now
+                if (!m_propertyIsSet) {
+                    // flush if target's property is not set at the moment
+                    if (hasCompleteChunk()) {
+                        flushSourceData();
+                    } else {
+                        endIncr();
+                    }
+                }
+            } else {
+                // non incremental transfer is to be completed now,
+                // data can be transferred to X client via a single property set
                 flushSourceData();
+                Q_EMIT selectionNotify(m_request, true);
+                endTransfer();
             }
-        } else {
-            // starting incremental transfer
-            startIncr();
+            return;
+        }
+        if (m_chunks.last().second == chunkSize()) {
+            // chunk full, but not yet at fd end -> go incremental
+            if (incr()) {
+                if (!m_propertyIsSet) {
+                    // flush if target's property is not set at the moment
+                    flushSourceData();
+                }
+            } else {
+                // starting incremental transfer
+                startIncr();
+            }
+            break;
         }
     }
+    if (m_chunks.size() > s_maxPendingChunks) {
+        // the X client is slower than the source, wait for it to catch up
+        socketNotifier()->setEnabled(false);
+    }
     resetTimeout();
 }
 
@@ -250,29 +326,17 @@ void TransferWltoX::handlePropertyDelete()
     }
     m_propertyIsSet = false;
 
-    if (m_flushPropertyOnDelete) {
-        if (!socketNotifier() && m_chunks.isEmpty()) {
-            // transfer complete
-            xcb_connection_t *xcbConn = kwinApp()->x11Connection();
-
-            uint32_t mask[] = {0};
-            xcb_change_window_attributes (xcbConn,
-                                          m_request->requestor,
-                                          XCB_CW_EVENT_MASK, mask);
-
-            xcb_change_property(xcbConn,
-                                XCB_PROP_MODE_REPLACE,
-                                m_request->requestor,
-                                m_request->property,
-                                m_request->target,
-                                8, 0, nullptr);
-            xcb_flush(xcbConn);
-            m_flushPropertyOnDelete = false;
-            endTransfer();
-        } else {
-            flushSourceData();
+    if (hasCompleteChunk()) {
+        flushSourceData();
+        if (socketNotifier()) {
+            socketNotifier()->setEnabled(true);
         }
+    } else if (!socketNotifier()) {
+        // transfer complete
+        Q_ASSERT(m_chunks.isEmpty());
+        endIncr();
     }
+    // otherwise the next chunk is flushed as soon as it has been read
 }
 
 TransferXtoWl::TransferXtoWl(xcb_atom_t selection, xcb_atom_t target, qint32 fd,
@@ -555,11 +619,17 @@ void TransferXtoWl::dataSourceWrite()
 {
     QByteArray property = m_receiver->data();
 
-    ssize_t len = write(fd(), property.constData(), property.size());
+    // A large property is written across several event loop iterations,
+    // so it can't starve the processing of other events.
+    ssize_t len = write(fd(), property.constData(), qMin(property.size(), chunkSize()));
     if (len == -1) {
-        qCWarning(KWIN_XWL) << "X11 to Wayland write error on fd:" << fd();
-        endTransfer();
-        return;
+        if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+            qCWarning(KWIN_XWL) << "X11 to Wayland write error on fd:" << fd();
+            endTransfer();
+            return;
+        }
+        // try again once the pipe has room
+        len = 0;
     }
 
     m_receiver->partRead(len);
@@ -95,12 +95,21 @@ protected:
     QSocketNotifier *socketNotifier() const {
         return m_notifier;
     }
+    /**
+     * The amount of data moved in one go, derived from the maximum request
+     * length of the X server. Also the most a transfer reads or writes per
+     * event loop iteration.
+     */
+    int chunkSize() const {
+        return m_chunkSize;
+    }
 private:
     void closeFd();
 
     xcb_atom_t m_atom;
     qint32 m_fd;
     xcb_timestamp_t m_timestamp = XCB_CURRENT_TIME;
+    int m_chunkSize;
 
     QSocketNotifier *m_notifier = nullptr;
     bool m_incr = false;
@@ -131,19 +140,20 @@ Q_SIGNALS:
 
 private:
     void startIncr();
+    void endIncr();
     void readWlSource();
     int flushSourceData();
+    bool hasCompleteChunk() const;
     void handlePropertyDelete();
 
     xcb_selection_request_event_t *m_request = nullptr;
 
-    /* contains all received data portioned in chunks
-     * TODO: explain second QPair component
+    /* contains all received data portioned in chunks,
+     * the second component is the number of bytes read into the chunk so far
      */
     QVector<QPair<QByteArray, int> > m_chunks;
 
     bool m_propertyIsSet = false;
-    bool m_flushPropertyOnDelete = false;
 
     Q_DISABLE_COPY(TransferWltoX)
 };